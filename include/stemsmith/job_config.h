@@ -37,6 +37,68 @@ struct model_profile
 std::optional<model_profile> lookup_profile(model_profile_id id);
 std::optional<model_profile> lookup_profile(std::string_view key);
 
+/**
+ * @brief Per-job quality level.
+ *
+ * `standard` is the historical behaviour and `max` widens the crossfade between segments and
+ * averages an extra time-shifted pass (Demucs' shift trick), roughly doubling compute. `draft`
+ * narrows the crossfade, which only saves the overlapped frames when a track is split into
+ * segments (segment parallelism, batching or silence skipping); on the serial path it runs
+ * exactly the same work as `standard`.
+ */
+enum class job_quality
+{
+    draft,
+    standard,
+    max
+};
+
+std::optional<job_quality> lookup_quality(std::string_view key);
+std::string_view quality_key(job_quality quality);
+
+/**
+ * @brief How inputs that are not at 44.1 kHz are resampled.
+ *
+ * `best` uses libsamplerate's best sinc converter. `medium` and `fast` use a polyphase resampler
+ * for rational ratios such as 48 or 96 kHz (libsamplerate's medium/fastest sinc otherwise),
+ * trading passband width and stopband attenuation for a large speed-up.
+ */
+enum class resample_quality
+{
+    best,
+    medium,
+    fast
+};
+
+std::optional<resample_quality> lookup_resample_quality(std::string_view key);
+std::string_view resample_quality_key(resample_quality quality);
+
+/**
+ * @brief Sample encoding of the stem files a job writes.
+ *
+ * `wav` keeps the separated 32-bit float samples. `wav_pcm16`, `wav_pcm24` and `flac` (24-bit,
+ * lossless) quantise them with TPDF dither, which cuts the output to a half, three quarters or
+ * roughly 40% of the float size.
+ */
+enum class output_format
+{
+    wav,
+    wav_pcm16,
+    wav_pcm24,
+    flac
+};
+
+std::optional<output_format> lookup_output_format(std::string_view key);
+std::string_view output_format_key(output_format format);
+
+struct output_encoding
+{
+    output_format format{output_format::wav};
+    unsigned flac_level{5}; // 0 (fastest) .. 8 (smallest), as with the reference encoder
+};
+
+inline constexpr unsigned max_flac_level = 8;
+
 /**
  * @brief Default configuration for separation jobs.
  */
@@ -44,6 +106,10 @@ struct job_template
 {
     model_profile_id profile{model_profile_id::balanced_six_stem};
     std::vector<std::string> stems_filter{}; // optional subset, empty -> all
+    job_quality quality{job_quality::standard};
+    std::size_t threads{0}; // compute thread budget for the job, 0 -> runtime default
+    std::optional<resample_quality> resampler{}; // nullopt -> runtime default
+    output_encoding output{};
 
     [[nodiscard]] std::vector<std::string> resolved_stems() const;
     static std::expected<job_template, std::string> from_json_string(const std::string& text);
@@ -7,11 +7,13 @@
  */
 #pragma once
 
+#include <atomic>
 #include <expected>
 #include <filesystem>
 #include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
@@ -48,6 +50,10 @@ struct job_request
     std::filesystem::path input_path;
     std::optional<model_profile_id> profile{};
     std::optional<std::vector<std::string>> stems{};
+    std::optional<job_quality> quality{};
+    std::optional<std::size_t> threads{}; // compute thread budget, e.g. high for interactive, low for backfill
+    std::optional<resample_quality> resampler{};
+    std::optional<output_encoding> output{}; // stem file encoding, e.g. FLAC to save disk and egress
     std::optional<std::filesystem::path> output_subdir{};
     job_observer observer{};
 };
@@ -61,6 +67,18 @@ struct model_handle
     bool was_cached{false};
 };
 
+/**
+ * @brief Counters of the content-addressed result cache.
+ */
+struct result_cache_stats
+{
+    std::uint64_t hits{};
+    std::uint64_t misses{};
+    std::uint64_t evictions{};
+    std::uint64_t entries{};
+    std::uint64_t bytes{}; // stem bytes currently held by the cache
+};
+
 using weight_progress_callback =
     std::function<void(model_profile_id profile, std::size_t bytes_downloaded, std::size_t total_bytes)>;
 
@@ -73,9 +91,61 @@ struct runtime_config
         weight_progress_callback on_progress{};
     };
 
+    /**
+     * @brief Models to load before the service reports itself ready.
+     *
+     * Each listed profile is downloaded (if needed) and loaded into `sessions_per_profile` pooled
+     * sessions, so the first jobs do not pay for model loading. With `background` set,
+     * ::stemsmith::service::create returns immediately and ::stemsmith::service::ready flips once
+     * warm-up finished.
+     */
+    struct warmup_config
+    {
+        std::vector<model_profile_id> profiles{};
+        std::size_t sessions_per_profile{0}; // 0 -> one session per worker
+        bool background{false};
+    };
+
+    /**
+     * @brief Cache of finished stems keyed by the input file and the job's model settings.
+     *
+     * Resubmitting identical audio with the same profile, stems, quality and output format completes
+     * immediately from the cache. Least recently used entries are evicted beyond `max_bytes`.
+     */
+    struct result_cache_config
+    {
+        std::filesystem::path root{}; // empty -> disabled
+        std::uint64_t max_bytes{std::uint64_t{4} << 30};
+    };
+
+    /**
+     * @brief Splits each job into decode, inference and encode stages.
+     *
+     * `worker_count` jobs run inference at once. With `decode_ahead` set, that many extra job
+     * threads decode queued inputs while the models are busy. With `encode_threads` set, stems are
+     * written concurrently by a shared pool of that many threads after the job has released its
+     * inference slot.
+     */
+    struct pipeline_config
+    {
+        std::size_t decode_ahead{0};   // jobs decoded ahead of a free inference slot; 0 -> none
+        std::size_t encode_threads{0}; // shared stem writers; 0 -> job thread writes serially
+    };
+
     cache_config cache{};
+    warmup_config warmup{};
+    result_cache_config results{};
+    pipeline_config pipeline{};
     std::filesystem::path output_root;
-    std::size_t worker_count{std::thread::hardware_concurrency()};
+    std::size_t worker_count{0}; // jobs separated at once; 0 -> usable CPUs (cpuset and cgroup cpu.max quota)
+    std::size_t segment_parallelism{1}; // >1 splits long tracks into overlapping segments run on parallel sessions
+    bool streaming{false}; // decode, separate and write segment by segment with bounded memory
+    std::size_t compute_threads{0}; // threads shared by all jobs' inference; 0 -> hardware concurrency
+    std::size_t threads_per_job{0}; // default per-job budget; 0 -> fair share of compute_threads
+    bool numa_pinning{false};       // pin jobs and compute threads to NUMA nodes with node-local weights
+    double silence_threshold_db{0.0}; // segments quieter than this (dBFS, e.g. -60) skip inference; 0 -> off
+    resample_quality resampler{resample_quality::best}; // for jobs that do not pick a resampler tier
+    bool coalesce_jobs{false}; // identical submissions attach to a queued or running job instead of re-running
     std::function<void(const job_descriptor&, const job_event&)> on_job_event{};
 };
 
@@ -99,6 +169,12 @@ public:
     [[nodiscard]] std::expected<void, std::string> purge_models(
         std::optional<model_profile_id> profile = std::nullopt) const;
 
+    // True once the configured warm-up finished successfully (always true without warm-up).
+    [[nodiscard]] bool ready() const noexcept;
+    [[nodiscard]] std::optional<std::string> warmup_error() const;
+    // Hit/miss counters of the result cache, if one is configured.
+    [[nodiscard]] std::optional<result_cache_stats> result_cache_usage() const;
+
     service(const service&) = delete;
     service& operator=(const service&) = delete;
     service(service&&) = delete;
@@ -108,8 +184,14 @@ public:
 private:
     service(std::shared_ptr<model_cache> cache, std::unique_ptr<job_runner> runner);
 
+    std::expected<void, std::string> warm_up(const runtime_config::warmup_config& warmup, std::size_t worker_count);
+
     std::shared_ptr<model_cache> cache_;
     std::unique_ptr<job_runner> runner_;
+    std::atomic_bool ready_{true};
+    mutable std::mutex warmup_mutex_;
+    std::optional<std::string> warmup_error_;
+    std::thread warmup_thread_;
 };
 
 } // namespace stemsmith
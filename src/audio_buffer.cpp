@@ -0,0 +1,114 @@
+#include "audio_buffer.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace stemsmith
+{
+
+namespace
+{
+void interleave_stereo(const float* left, const float* right, float* out, std::size_t frames)
+{
+    std::size_t frame = 0;
+#if defined(__SSE2__)
+    for (; frame + 4 <= frames; frame += 4)
+    {
+        const __m128 l = _mm_loadu_ps(left + frame);
+        const __m128 r = _mm_loadu_ps(right + frame);
+        _mm_storeu_ps(out + 2 * frame, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 2 * frame + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif defined(__ARM_NEON)
+    for (; frame + 4 <= frames; frame += 4)
+    {
+        const float32x4x2_t lr{{vld1q_f32(left + frame), vld1q_f32(right + frame)}};
+        vst2q_f32(out + 2 * frame, lr);
+    }
+#endif
+    for (; frame < frames; ++frame)
+    {
+        out[2 * frame] = left[frame];
+        out[2 * frame + 1] = right[frame];
+    }
+}
+} // namespace
+
+void interleave(std::span<const float> planar, std::size_t channels, std::span<float> interleaved)
+{
+    if (channels == 0)
+    {
+        return;
+    }
+
+    const auto frames = std::min(planar.size(), interleaved.size()) / channels;
+    if (channels == 2)
+    {
+        interleave_stereo(planar.data(), planar.data() + frames, interleaved.data(), frames);
+        return;
+    }
+
+    for (std::size_t ch = 0; ch < channels; ++ch)
+    {
+        const auto* block = planar.data() + ch * frames;
+        for (std::size_t frame = 0; frame < frames; ++frame)
+        {
+            interleaved[frame * channels + ch] = block[frame];
+        }
+    }
+}
+
+void interleave(std::span<const float> planar,
+                std::size_t channels,
+                std::size_t first_frame,
+                std::size_t frame_count,
+                std::span<float> interleaved)
+{
+    if (channels == 0)
+    {
+        return;
+    }
+
+    const auto frames = planar.size() / channels;
+    if (first_frame >= frames)
+    {
+        return;
+    }
+    const auto count = std::min({frame_count, frames - first_frame, interleaved.size() / channels});
+    if (channels == 2)
+    {
+        interleave_stereo(planar.data() + first_frame, planar.data() + frames + first_frame, interleaved.data(), count);
+        return;
+    }
+
+    for (std::size_t ch = 0; ch < channels; ++ch)
+    {
+        const auto* block = planar.data() + ch * frames + first_frame;
+        for (std::size_t frame = 0; frame < count; ++frame)
+        {
+            interleaved[frame * channels + ch] = block[frame];
+        }
+    }
+}
+
+audio_buffer to_interleaved(audio_buffer buffer)
+{
+    if (buffer.layout == sample_layout::interleaved)
+    {
+        return buffer;
+    }
+
+    std::vector<float> interleaved(buffer.samples.size());
+    interleave(buffer.samples, buffer.channels, interleaved);
+    buffer.samples = std::move(interleaved);
+    buffer.layout = sample_layout::interleaved;
+    return buffer;
+}
+
+} // namespace stemsmith
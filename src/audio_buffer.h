@@ -1,16 +1,31 @@
 #pragma once
+#include <cstddef>
+#include <span>
 #include <vector>
 
 namespace stemsmith
 {
 /**
- * @brief Represents an audio buffer with interleaved PCM samples.
+ * @brief How the samples of an audio_buffer are arranged in memory.
+ *
+ * Interleaved stores one frame after another (L R L R ...); planar stores one contiguous block per
+ * channel (L L ... R R ...), which is how Demucs lays out its output tensor.
+ */
+enum class sample_layout
+{
+    interleaved,
+    planar,
+};
+
+/**
+ * @brief Represents an audio buffer with PCM samples in either interleaved or planar layout.
  */
 struct audio_buffer
 {
     int sample_rate{};
     std::size_t channels{};
-    std::vector<float> samples; // interleaved PCM data in [-1, 1]
+    std::vector<float> samples; // PCM data in [-1, 1], arranged according to `layout`
+    sample_layout layout{sample_layout::interleaved};
 
     [[nodiscard]] std::size_t frame_count() const noexcept
     {
@@ -21,5 +36,31 @@ struct audio_buffer
     {
         return samples.empty();
     }
+
+    // Position of (frame, channel) within `samples` for the buffer's layout.
+    [[nodiscard]] std::size_t index(std::size_t frame, std::size_t channel) const noexcept
+    {
+        return layout == sample_layout::planar ? channel * frame_count() + frame : frame * channels + channel;
+    }
 };
+
+/**
+ * @brief Interleaves planar channel blocks into `interleaved`; stereo uses SIMD where available.
+ */
+void interleave(std::span<const float> planar, std::size_t channels, std::span<float> interleaved);
+
+/**
+ * @brief Interleaves frames [`first_frame`, `first_frame` + `frame_count`) of planar channel blocks,
+ * each `planar.size() / channels` long, into `interleaved` (clamped to the frames that fit).
+ */
+void interleave(std::span<const float> planar,
+                std::size_t channels,
+                std::size_t first_frame,
+                std::size_t frame_count,
+                std::span<float> interleaved);
+
+/**
+ * @brief Returns `buffer` in interleaved layout, converting only when it is planar.
+ */
+[[nodiscard]] audio_buffer to_interleaved(audio_buffer buffer);
 } // namespace stemsmith
@@ -1,31 +1,49 @@
 #include "audio_io.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <exception>
 #include <expected>
 #include <filesystem>
 #include <iterator>
 #include <libnyquist/Common.h>
 #include <libnyquist/Decoders.h>
-#include <libnyquist/Encoders.h>
 #include <memory>
+#include <optional>
 #include <samplerate.h>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "dsp.hpp"
+#include "mapped_file.h"
+#include "resampler.h"
+#include "wav_format.h"
 
 namespace
 {
 using stemsmith::audio_buffer;
-using stemsmith::audio_format;
 
 constexpr int TARGET_NUM_CHANNELS = 2;
 constexpr int TARGET_SAMPLE_RATE = demucscpp::SUPPORTED_SAMPLE_RATE;
+constexpr std::size_t kMinWriteSamples = 32;
+constexpr std::size_t kWriteBlockFrames = 16384;
 
-std::expected<std::vector<float>, std::string> ensure_supported_channels(const nqr::AudioData& data)
+constexpr std::pair<std::string_view, stemsmith::input_format> kInputExtensions[] = {
+    {".wav", stemsmith::input_format::wav},
+    {".flac", stemsmith::input_format::flac},
+    {".mp3", stemsmith::input_format::mp3},
+    {".ogg", stemsmith::input_format::ogg},
+    {".opus", stemsmith::input_format::ogg},
+};
+
+std::expected<std::vector<float>, std::string> ensure_supported_channels(nqr::AudioData& data)
 {
     if (data.channelCount == TARGET_NUM_CHANNELS)
     {
-        return data.samples;
+        return std::move(data.samples);
     }
 
     if (data.channelCount == 1)
@@ -44,7 +62,9 @@ std::expected<std::vector<float>, std::string> ensure_supported_channels(const n
     return std::unexpected("Only mono or stereo inputs are supported");
 }
 
-std::expected<std::vector<float>, std::string> resample_if_needed(const std::vector<float>& samples, int source_rate)
+std::expected<std::vector<float>, std::string> resample_if_needed(std::vector<float> samples,
+                                                                  int source_rate,
+                                                                  stemsmith::resample_quality quality)
 {
     if (source_rate == TARGET_SAMPLE_RATE || samples.empty())
     {
@@ -56,13 +76,22 @@ std::expected<std::vector<float>, std::string> resample_if_needed(const std::vec
         return std::unexpected("Invalid sample rate");
     }
 
-    SRC_DATA request{};
-    request.data_in = samples.data();
-
     const auto input_frames = samples.size() / TARGET_NUM_CHANNELS;
     const double ratio = static_cast<double>(TARGET_SAMPLE_RATE) / static_cast<double>(source_rate);
     const auto max_output_frames = static_cast<std::size_t>(std::ceil(input_frames * ratio)) + 8;
 
+    if (stemsmith::polyphase_resampler::supports(source_rate, TARGET_SAMPLE_RATE, quality))
+    {
+        stemsmith::polyphase_resampler resampler(source_rate, TARGET_SAMPLE_RATE, quality, TARGET_NUM_CHANNELS);
+        std::vector<float> output;
+        output.reserve(max_output_frames * TARGET_NUM_CHANNELS);
+        resampler.process(samples, true, output);
+        return output;
+    }
+
+    SRC_DATA request{};
+    request.data_in = samples.data();
+
     std::vector<float> output(max_output_frames * TARGET_NUM_CHANNELS);
 
     request.data_out = output.data();
@@ -71,7 +100,8 @@ std::expected<std::vector<float>, std::string> resample_if_needed(const std::vec
     request.output_frames = static_cast<long>(max_output_frames);
     request.end_of_input = 1;
 
-    if (const int result = src_simple(&request, SRC_SINC_BEST_QUALITY, TARGET_NUM_CHANNELS); result != 0)
+    if (const int result = src_simple(&request, stemsmith::libsamplerate_converter(quality), TARGET_NUM_CHANNELS);
+        result != 0)
     {
         return std::unexpected(src_strerror(result));
     }
@@ -79,39 +109,120 @@ std::expected<std::vector<float>, std::string> resample_if_needed(const std::vec
     output.resize(static_cast<std::size_t>(request.output_frames_gen) * TARGET_NUM_CHANNELS);
     return output;
 }
+
+// Decodes plain PCM/float WAV (including WAVE_FORMAT_EXTENSIBLE and RF64) from a mapping of the file
+// straight into interleaved stereo at the source rate. nullopt hands the file to libnyquist.
+std::optional<audio_buffer> load_native_wav(const std::filesystem::path& path)
+{
+    const auto mapped = stemsmith::mapped_file::open(path);
+    if (!mapped)
+    {
+        return std::nullopt;
+    }
+    const auto layout = stemsmith::parse_wav_header(mapped->bytes());
+    if (!layout || !stemsmith::is_native_wav(layout->format) || layout->data_bytes == 0)
+    {
+        return std::nullopt;
+    }
+
+    const auto frames = static_cast<std::size_t>(layout->data_bytes / layout->format.block_align());
+    audio_buffer decoded;
+    decoded.sample_rate = layout->format.sample_rate;
+    decoded.channels = TARGET_NUM_CHANNELS;
+    decoded.samples.resize(frames * TARGET_NUM_CHANNELS);
+    stemsmith::decode_to_stereo(
+        mapped->bytes().data() + layout->data_offset, layout->format, frames, decoded.samples.data());
+    return decoded;
+}
 } // namespace
 
 namespace stemsmith
 {
-std::expected<audio_buffer, std::string> load_audio_file(const std::filesystem::path& path)
+std::optional<input_format> input_format_for(const std::filesystem::path& path)
 {
-    if (!std::filesystem::exists(path))
+    std::string extension = path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const auto& [suffix, format] : kInputExtensions)
     {
-        return std::unexpected("Audio file does not exist: " + path.string());
+        if (extension == suffix)
+        {
+            return format;
+        }
     }
+    return std::nullopt;
+}
 
-    const auto file_data = std::make_shared<nqr::AudioData>();
-
-    nqr::NyquistIO loader;
-    loader.Load(file_data.get(), path.string());
+std::optional<input_format> sniff_input_format(std::span<const unsigned char> header)
+{
+    const auto starts_with = [&](std::size_t offset, std::string_view magic)
+    {
+        return header.size() >= offset + magic.size() &&
+               std::memcmp(header.data() + offset, magic.data(), magic.size()) == 0;
+    };
 
-    if (file_data->samples.empty())
+    if ((starts_with(0, "RIFF") || starts_with(0, "RF64") || starts_with(0, "BW64")) && starts_with(8, "WAVE"))
     {
-        return std::unexpected("Failed to load audio");
+        return input_format::wav;
     }
+    if (starts_with(0, "fLaC"))
+    {
+        return input_format::flac;
+    }
+    if (starts_with(0, "OggS"))
+    {
+        return input_format::ogg;
+    }
+    // An ID3v2 tag, else the 11-bit sync word of the first MPEG audio frame.
+    if (starts_with(0, "ID3") || (header.size() >= 2 && header[0] == 0xFF && (header[1] & 0xE0) == 0xE0))
+    {
+        return input_format::mp3;
+    }
+    return std::nullopt;
+}
 
-    if (file_data->channelCount <= 0)
+std::expected<audio_buffer, std::string> load_audio_file(const std::filesystem::path& path, resample_quality quality)
+{
+    if (!std::filesystem::exists(path))
     {
-        return std::unexpected("Input file has no channels");
+        return std::unexpected("Audio file does not exist: " + path.string());
     }
 
-    auto samples = ensure_supported_channels(*file_data);
-    if (!samples)
+    auto decoded = load_native_wav(path);
+    if (!decoded)
     {
-        return std::unexpected(samples.error());
+        const auto file_data = std::make_shared<nqr::AudioData>();
+
+        try
+        {
+            nqr::NyquistIO loader;
+            loader.Load(file_data.get(), path.string());
+        }
+        catch (const std::exception& ex)
+        {
+            return std::unexpected("Failed to decode " + path.filename().string() + ": " + ex.what());
+        }
+
+        if (file_data->samples.empty())
+        {
+            return std::unexpected("Failed to load audio");
+        }
+
+        if (file_data->channelCount <= 0)
+        {
+            return std::unexpected("Input file has no channels");
+        }
+
+        auto samples = ensure_supported_channels(*file_data);
+        if (!samples)
+        {
+            return std::unexpected(samples.error());
+        }
+        decoded.emplace();
+        decoded->sample_rate = file_data->sampleRate;
+        decoded->samples = std::move(samples.value());
     }
 
-    const auto resampled = resample_if_needed(*samples, file_data->sampleRate);
+    auto resampled = resample_if_needed(std::move(decoded->samples), decoded->sample_rate, quality);
     if (!resampled)
     {
         return std::unexpected(resampled.error());
@@ -120,50 +231,151 @@ std::expected<audio_buffer, std::string> load_audio_file(const std::filesystem::
     audio_buffer buffer;
     buffer.sample_rate = TARGET_SAMPLE_RATE;
     buffer.channels = TARGET_NUM_CHANNELS;
-    buffer.samples = resampled.value();
+    buffer.samples = std::move(resampled.value());
 
     return buffer;
 }
 
-std::expected<void, std::string> write_audio_file(const std::filesystem::path& path,
-                                                  const audio_buffer& buffer,
-                                                  audio_format format)
+std::string stem_file_name(std::string_view stem, output_format format)
 {
-    if (format != audio_format::wav)
+    return std::string{stem} + (format == output_format::flac ? ".flac" : ".wav");
+}
+
+stem_file_writer::stem_file_writer(std::variant<wav_stream_writer, flac_stream_writer> writer,
+                                   std::filesystem::path path,
+                                   std::filesystem::path partial_path)
+    : writer_(std::move(writer))
+    , path_(std::move(path))
+    , partial_path_(std::move(partial_path))
+{
+}
+
+stem_file_writer::stem_file_writer(stem_file_writer&& other) noexcept
+    : writer_(std::move(other.writer_))
+    , path_(std::move(other.path_))
+    , partial_path_(std::exchange(other.partial_path_, {}))
+{
+}
+
+stem_file_writer& stem_file_writer::operator=(stem_file_writer&& other) noexcept
+{
+    if (this != &other)
     {
-        return std::unexpected("Only WAV outputs are supported");
+        remove_partial();
+        writer_ = std::move(other.writer_);
+        path_ = std::move(other.path_);
+        partial_path_ = std::exchange(other.partial_path_, {});
     }
+    return *this;
+}
 
-    if (buffer.channels != TARGET_NUM_CHANNELS)
+stem_file_writer::~stem_file_writer()
+{
+    remove_partial();
+}
+
+void stem_file_writer::remove_partial() noexcept
+{
+    if (!partial_path_.empty())
     {
-        return std::unexpected("Audio writer expects stereo PCM data");
+        std::error_code ec;
+        std::filesystem::remove(partial_path_, ec);
+        partial_path_.clear();
     }
+}
 
-    if (const auto parent = path.parent_path(); !parent.empty())
+std::expected<stem_file_writer, std::string> stem_file_writer::create(const std::filesystem::path& path,
+                                                                      int sample_rate,
+                                                                      std::size_t channels,
+                                                                      const output_encoding& encoding)
+{
+    // Same directory as `path`, so finalize() is a rename within one filesystem.
+    auto partial_path = path.parent_path() / ("." + path.filename().string() + ".partial");
+    if (encoding.format == output_format::flac)
     {
-        std::error_code ec;
-        std::filesystem::create_directories(parent, ec);
-        if (ec)
+        auto writer = flac_stream_writer::create(partial_path, sample_rate, channels, encoding.flac_level);
+        if (!writer)
         {
-            return std::unexpected("Failed to create output directory: " + ec.message());
+            return std::unexpected(writer.error());
         }
+        return stem_file_writer{std::move(*writer), path, std::move(partial_path)};
     }
 
-    const auto file_data = std::make_shared<nqr::AudioData>();
-    assert(file_data);
-    file_data->sampleRate = buffer.sample_rate;
-    file_data->channelCount = static_cast<int>(buffer.channels);
-    file_data->samples = buffer.samples;
+    auto writer = wav_stream_writer::create(partial_path, sample_rate, channels, encoding.format);
+    if (!writer)
+    {
+        return std::unexpected(writer.error());
+    }
+    return stem_file_writer{std::move(*writer), path, std::move(partial_path)};
+}
 
-    const int status = encode_wav_to_disk({file_data->channelCount, nqr::PCM_FLT, nqr::DITHER_TRIANGLE},
-                                          file_data.get(),
-                                          path.string());
+std::expected<void, std::string> stem_file_writer::append(std::span<const float> interleaved)
+{
+    return std::visit([&](auto& writer) { return writer.append(interleaved); }, writer_);
+}
 
-    if (status != nqr::EncoderError::NoError)
+std::expected<void, std::string> stem_file_writer::finalize()
+{
+    if (auto status = std::visit([](auto& writer) { return writer.finalize(); }, writer_); !status)
     {
-        return std::unexpected("Failed to write audio: " + std::to_string(status));
+        return status;
     }
 
+    std::error_code ec;
+    std::filesystem::rename(partial_path_, path_, ec);
+    if (ec)
+    {
+        return std::unexpected("Failed to write audio: cannot replace " + path_.string() + ": " + ec.message());
+    }
+    partial_path_.clear();
     return {};
 }
+
+std::expected<void, std::string> write_audio_file(const std::filesystem::path& path,
+                                                  const audio_buffer& buffer,
+                                                  const output_encoding& encoding)
+{
+    if (buffer.channels != TARGET_NUM_CHANNELS)
+    {
+        return std::unexpected("Audio writer expects stereo PCM data");
+    }
+
+    // The encoder this replaced refused buffers this small; keep rejecting them.
+    if (buffer.samples.size() < kMinWriteSamples)
+    {
+        return std::unexpected("Failed to write audio: insufficient sample data");
+    }
+
+    // Float WAV goes to disk as it is; the integer formats and FLAC are dithered by their writers.
+    auto writer = stem_file_writer::create(path, buffer.sample_rate, buffer.channels, encoding);
+    if (!writer)
+    {
+        return std::unexpected(writer.error());
+    }
+
+    if (buffer.layout == sample_layout::interleaved)
+    {
+        if (auto status = writer->append(buffer.samples); !status)
+        {
+            return status;
+        }
+    }
+    else
+    {
+        // Interleave planar stems a block at a time instead of materialising a second full copy.
+        const auto frames = buffer.frame_count();
+        std::vector<float> block(std::min(frames, kWriteBlockFrames) * buffer.channels);
+        for (std::size_t first = 0; first < frames; first += kWriteBlockFrames)
+        {
+            const auto count = std::min(kWriteBlockFrames, frames - first);
+            interleave(buffer.samples, buffer.channels, first, count, block);
+            if (auto status = writer->append({block.data(), count * buffer.channels}); !status)
+            {
+                return status;
+            }
+        }
+    }
+
+    return writer->finalize();
+}
 } // namespace stemsmith
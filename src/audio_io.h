@@ -2,21 +2,81 @@
 
 #include <expected>
 #include <filesystem>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <variant>
 
 #include "audio_buffer.h"
+#include "audio_stream.h"
+#include "flac_writer.h"
+#include "stemsmith/job_config.h"
 
 namespace stemsmith
 {
 
-enum class audio_format
+/**
+ * @brief Containers load_audio_file() can decode; Opus streams are Ogg containers.
+ */
+enum class input_format
 {
-    wav
+    wav,
+    flac,
+    mp3,
+    ogg,
 };
 
-[[nodiscard]] std::expected<audio_buffer, std::string> load_audio_file(const std::filesystem::path& path);
+// Format implied by the extension of `path` (case-insensitive); nullopt when it cannot be decoded.
+[[nodiscard]] std::optional<input_format> input_format_for(const std::filesystem::path& path);
+
+// Format identified by the leading bytes of a file; nullopt when no supported signature matches.
+[[nodiscard]] std::optional<input_format> sniff_input_format(std::span<const unsigned char> header);
+
+// Decodes `path` to interleaved stereo at 44.1 kHz, resampling other rates with the given tier.
+[[nodiscard]] std::expected<audio_buffer, std::string> load_audio_file(
+    const std::filesystem::path& path,
+    resample_quality quality = resample_quality::best);
+
+// File name of a stem in `format`, e.g. "vocals.flac".
+[[nodiscard]] std::string stem_file_name(std::string_view stem, output_format format);
+
+/**
+ * @brief Appends interleaved float frames to a stem file in the job's output encoding.
+ *
+ * Frames go to a hidden temporary file next to `path`, which finalize() renames over `path`. A stem
+ * that is hardlinked elsewhere (into the result cache or another job's directory) is therefore
+ * replaced rather than overwritten, and readers never see a half-written stem. The temporary file is
+ * removed when a writer is dropped before finalize().
+ */
+class stem_file_writer
+{
+public:
+    [[nodiscard]] static std::expected<stem_file_writer, std::string> create(const std::filesystem::path& path,
+                                                                             int sample_rate,
+                                                                             std::size_t channels,
+                                                                             const output_encoding& encoding);
+
+    stem_file_writer(stem_file_writer&& other) noexcept;
+    stem_file_writer& operator=(stem_file_writer&& other) noexcept;
+    ~stem_file_writer();
+
+    [[nodiscard]] std::expected<void, std::string> append(std::span<const float> interleaved);
+    [[nodiscard]] std::expected<void, std::string> finalize();
+
+private:
+    stem_file_writer(std::variant<wav_stream_writer, flac_stream_writer> writer,
+                     std::filesystem::path path,
+                     std::filesystem::path partial_path);
+
+    void remove_partial() noexcept;
+
+    std::variant<wav_stream_writer, flac_stream_writer> writer_;
+    std::filesystem::path path_;
+    std::filesystem::path partial_path_; // empty once renamed into place or moved from
+};
 
 [[nodiscard]] std::expected<void, std::string> write_audio_file(const std::filesystem::path& path,
                                                                 const audio_buffer& buffer,
-                                                                audio_format format = audio_format::wav);
+                                                                const output_encoding& encoding = {});
 } // namespace stemsmith
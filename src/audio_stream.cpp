@@ -0,0 +1,322 @@
+#include "audio_stream.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <samplerate.h>
+
+#include "audio_io.h"
+#include "dsp.hpp"
+#include "mapped_file.h"
+
+namespace
+{
+constexpr std::size_t kTargetChannels = 2;
+constexpr int kTargetSampleRate = demucscpp::SUPPORTED_SAMPLE_RATE;
+constexpr std::size_t kDecodeChunkFrames = 16384;
+
+void write_u16(std::ostream& out, std::uint16_t value)
+{
+    const std::array<char, 2> bytes{static_cast<char>(value & 0xFF), static_cast<char>((value >> 8) & 0xFF)};
+    out.write(bytes.data(), bytes.size());
+}
+
+void write_u32(std::ostream& out, std::uint32_t value)
+{
+    const std::array<char, 4> bytes{static_cast<char>(value & 0xFF),
+                                    static_cast<char>((value >> 8) & 0xFF),
+                                    static_cast<char>((value >> 16) & 0xFF),
+                                    static_cast<char>((value >> 24) & 0xFF)};
+    out.write(bytes.data(), bytes.size());
+}
+} // namespace
+
+namespace stemsmith
+{
+
+void audio_stream_reader::resampler_deleter::operator()(SRC_STATE_tag* state) const
+{
+    src_delete(state);
+}
+
+audio_stream_reader::audio_stream_reader(audio_stream_reader&&) noexcept = default;
+audio_stream_reader& audio_stream_reader::operator=(audio_stream_reader&&) noexcept = default;
+audio_stream_reader::~audio_stream_reader() = default;
+
+std::expected<audio_stream_reader, std::string> audio_stream_reader::open(const std::filesystem::path& path,
+                                                                          resample_quality quality)
+{
+    if (!std::filesystem::exists(path))
+    {
+        return std::unexpected("Audio file does not exist: " + path.string());
+    }
+
+    // Only the header pages of the mapping are touched; samples are then read through the stream.
+    std::optional<wav_layout> layout;
+    if (const auto mapped = mapped_file::open(path))
+    {
+        layout = parse_wav_header(mapped->bytes());
+    }
+
+    audio_stream_reader reader;
+    if (!layout || !is_native_wav(layout->format) || layout->data_bytes == 0)
+    {
+        // Compressed or exotic inputs are decoded in one go; only WAV gets bounded memory.
+        auto decoded = load_audio_file(path, quality);
+        if (!decoded)
+        {
+            return std::unexpected(decoded.error());
+        }
+        reader.decoded_ = std::move(decoded.value());
+        reader.frames_hint_ = reader.decoded_.frame_count();
+        return reader;
+    }
+
+    reader.file_.open(path, std::ios::binary);
+    reader.file_.seekg(static_cast<std::streamoff>(layout->data_offset));
+    if (!reader.file_)
+    {
+        return std::unexpected("Failed to open audio file: " + path.string());
+    }
+    reader.format_ = layout->format;
+    reader.remaining_bytes_ = layout->data_bytes;
+
+    const auto source_frames = reader.remaining_bytes_ / reader.format_.block_align();
+    reader.frames_hint_ = static_cast<std::size_t>(static_cast<double>(source_frames) * kTargetSampleRate /
+                                                   static_cast<double>(reader.format_.sample_rate));
+
+    if (polyphase_resampler::supports(reader.format_.sample_rate, kTargetSampleRate, quality))
+    {
+        reader.polyphase_.emplace(reader.format_.sample_rate, kTargetSampleRate, quality, kTargetChannels);
+    }
+    else if (reader.format_.sample_rate != kTargetSampleRate)
+    {
+        int error = 0;
+        reader.resampler_.reset(
+            src_new(libsamplerate_converter(quality), static_cast<int>(kTargetChannels), &error));
+        if (!reader.resampler_)
+        {
+            return std::unexpected(src_strerror(error));
+        }
+    }
+
+    return reader;
+}
+
+std::expected<std::size_t, std::string> audio_stream_reader::decode(std::vector<float>& out, std::size_t frames)
+{
+    const auto block_align = format_.block_align();
+    const auto wanted = std::min<std::uint64_t>(frames * block_align, remaining_bytes_);
+
+    raw_.resize(static_cast<std::size_t>(wanted));
+    if (!file_.read(reinterpret_cast<char*>(raw_.data()), static_cast<std::streamsize>(raw_.size())))
+    {
+        return std::unexpected("Failed to read audio data");
+    }
+    remaining_bytes_ -= wanted;
+
+    const auto decoded_frames = raw_.size() / block_align;
+    const auto base = out.size();
+    out.resize(base + decoded_frames * kTargetChannels);
+    decode_to_stereo(raw_.data(), format_, decoded_frames, out.data() + base);
+    return decoded_frames;
+}
+
+std::expected<void, std::string> audio_stream_reader::read(audio_buffer& buffer, std::size_t frames)
+{
+    buffer.sample_rate = kTargetSampleRate;
+    buffer.channels = kTargetChannels;
+    buffer.samples.clear();
+
+    if (!decoded_.empty())
+    {
+        const auto available = decoded_.frame_count() - decoded_offset_;
+        const auto count = std::min(frames, available);
+        const auto begin = decoded_.samples.begin() + static_cast<std::ptrdiff_t>(decoded_offset_ * kTargetChannels);
+        buffer.samples.assign(begin, begin + static_cast<std::ptrdiff_t>(count * kTargetChannels));
+        decoded_offset_ += count;
+        return {};
+    }
+
+    if (polyphase_)
+    {
+        std::vector<float> source;
+        while (pending_.size() - pending_offset_ * kTargetChannels < frames * kTargetChannels && !flushed_)
+        {
+            source.clear();
+            auto decoded = decode(source, kDecodeChunkFrames);
+            if (!decoded)
+            {
+                return std::unexpected(decoded.error());
+            }
+            flushed_ = decoded.value() == 0;
+            const auto consumed = static_cast<std::ptrdiff_t>(pending_offset_ * kTargetChannels);
+            pending_.erase(pending_.begin(), pending_.begin() + consumed);
+            pending_offset_ = 0;
+            polyphase_->process(source, flushed_, pending_);
+        }
+        const auto count = std::min(frames, pending_.size() / kTargetChannels - pending_offset_);
+        const auto begin = pending_.begin() + static_cast<std::ptrdiff_t>(pending_offset_ * kTargetChannels);
+        buffer.samples.assign(begin, begin + static_cast<std::ptrdiff_t>(count * kTargetChannels));
+        pending_offset_ += count;
+        return {};
+    }
+
+    if (!resampler_)
+    {
+        if (auto decoded = decode(buffer.samples, frames); !decoded)
+        {
+            return std::unexpected(decoded.error());
+        }
+        return {};
+    }
+
+    const double ratio = static_cast<double>(kTargetSampleRate) / static_cast<double>(format_.sample_rate);
+    buffer.samples.resize(frames * kTargetChannels);
+    std::size_t produced = 0;
+    while (produced < frames && !flushed_)
+    {
+        if (pending_offset_ * kTargetChannels >= pending_.size() && !source_exhausted_)
+        {
+            pending_.clear();
+            pending_offset_ = 0;
+            auto decoded = decode(pending_, kDecodeChunkFrames);
+            if (!decoded)
+            {
+                return std::unexpected(decoded.error());
+            }
+            source_exhausted_ = decoded.value() == 0;
+        }
+
+        SRC_DATA request{};
+        request.data_in = pending_.data() + pending_offset_ * kTargetChannels;
+        request.input_frames = static_cast<long>(pending_.size() / kTargetChannels - pending_offset_);
+        request.data_out = buffer.samples.data() + produced * kTargetChannels;
+        request.output_frames = static_cast<long>(frames - produced);
+        request.end_of_input = source_exhausted_ ? 1 : 0;
+        request.src_ratio = ratio;
+
+        if (const int result = src_process(resampler_.get(), &request); result != 0)
+        {
+            return std::unexpected(src_strerror(result));
+        }
+
+        pending_offset_ += static_cast<std::size_t>(request.input_frames_used);
+        produced += static_cast<std::size_t>(request.output_frames_gen);
+        if (source_exhausted_ && request.output_frames_gen == 0)
+        {
+            flushed_ = true;
+        }
+    }
+
+    buffer.samples.resize(produced * kTargetChannels);
+    return {};
+}
+
+std::expected<wav_stream_writer, std::string> wav_stream_writer::create(const std::filesystem::path& path,
+                                                                        int sample_rate,
+                                                                        std::size_t channels,
+                                                                        output_format format)
+{
+    if (format == output_format::flac)
+    {
+        return std::unexpected("WAV writer cannot encode FLAC");
+    }
+
+    if (const auto parent = path.parent_path(); !parent.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(parent, ec);
+        if (ec)
+        {
+            return std::unexpected("Failed to create output directory: " + ec.message());
+        }
+    }
+
+    wav_stream_writer writer;
+    writer.path_ = path;
+    writer.file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!writer.file_)
+    {
+        return std::unexpected("Failed to write audio: cannot open " + path.string());
+    }
+
+    // 32-bit float, or dithered 16/24-bit PCM; the RIFF and data sizes are patched in finalize().
+    const std::uint16_t bits = format == output_format::wav_pcm16 ? 16 : format == output_format::wav_pcm24 ? 24 : 32;
+    if (bits < 32)
+    {
+        writer.quantizer_.emplace(bits);
+    }
+    writer.sample_bytes_ = bits / 8;
+    const auto block_align = static_cast<std::uint16_t>(channels * writer.sample_bytes_);
+    writer.file_.write("RIFF", 4);
+    write_u32(writer.file_, 0);
+    writer.file_.write("WAVEfmt ", 8);
+    write_u32(writer.file_, 16);
+    write_u16(writer.file_, bits < 32 ? wav_format_pcm : wav_format_float);
+    write_u16(writer.file_, static_cast<std::uint16_t>(channels));
+    write_u32(writer.file_, static_cast<std::uint32_t>(sample_rate));
+    write_u32(writer.file_, static_cast<std::uint32_t>(sample_rate) * block_align);
+    write_u16(writer.file_, block_align);
+    write_u16(writer.file_, bits);
+    writer.file_.write("data", 4);
+    write_u32(writer.file_, 0);
+
+    if (!writer.file_)
+    {
+        return std::unexpected("Failed to write audio: " + path.string());
+    }
+    return writer;
+}
+
+std::expected<void, std::string> wav_stream_writer::append(std::span<const float> interleaved)
+{
+    const auto bytes = interleaved.size() * sample_bytes_;
+    if (data_bytes_ + bytes > std::numeric_limits<std::uint32_t>::max() - 36)
+    {
+        return std::unexpected("Failed to write audio: output exceeds the 4 GiB WAV limit");
+    }
+
+    const auto* data = reinterpret_cast<const char*>(interleaved.data());
+    if (quantizer_)
+    {
+        // Little-endian 16 or 24-bit samples.
+        encoded_.resize(bytes);
+        auto* out = encoded_.data();
+        for (const auto sample : interleaved)
+        {
+            const auto value = static_cast<std::uint32_t>((*quantizer_)(sample));
+            for (std::size_t b = 0; b < sample_bytes_; ++b)
+            {
+                *out++ = static_cast<char>(value >> (8 * b));
+            }
+        }
+        data = encoded_.data();
+    }
+
+    file_.write(data, static_cast<std::streamsize>(bytes));
+    if (!file_)
+    {
+        return std::unexpected("Failed to write audio: " + path_.string());
+    }
+    data_bytes_ += bytes;
+    return {};
+}
+
+std::expected<void, std::string> wav_stream_writer::finalize()
+{
+    file_.seekp(4);
+    write_u32(file_, static_cast<std::uint32_t>(36 + data_bytes_));
+    file_.seekp(40);
+    write_u32(file_, static_cast<std::uint32_t>(data_bytes_));
+    file_.close();
+    if (file_.fail())
+    {
+        return std::unexpected("Failed to write audio: " + path_.string());
+    }
+    return {};
+}
+
+} // namespace stemsmith
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "audio_buffer.h"
+#include "dither.h"
+#include "resampler.h"
+#include "wav_format.h"
+
+struct SRC_STATE_tag;
+
+namespace stemsmith
+{
+
+/**
+ * @brief Pulls stereo frames at the Demucs sample rate from a file, one bounded chunk at a time.
+ *
+ * PCM (16/24/32-bit integer) and 32-bit float WAV and RF64 files are decoded incrementally and resampled
+ * with a streaming libsamplerate state (or a polyphase_resampler for the faster tiers), so memory
+ * does not grow with track length. Other formats fall back to decoding the whole file up front.
+ */
+class audio_stream_reader
+{
+public:
+    [[nodiscard]] static std::expected<audio_stream_reader, std::string> open(
+        const std::filesystem::path& path,
+        resample_quality quality = resample_quality::best);
+
+    audio_stream_reader(audio_stream_reader&&) noexcept;
+    audio_stream_reader& operator=(audio_stream_reader&&) noexcept;
+    ~audio_stream_reader();
+
+    // Fills `buffer` with up to `frames` frames; returns fewer only at the end of the stream.
+    [[nodiscard]] std::expected<void, std::string> read(audio_buffer& buffer, std::size_t frames);
+
+    // Expected number of output frames, used for progress reporting.
+    [[nodiscard]] std::size_t frames_hint() const noexcept
+    {
+        return frames_hint_;
+    }
+
+private:
+    audio_stream_reader() = default;
+
+    [[nodiscard]] std::expected<std::size_t, std::string> decode(std::vector<float>& out, std::size_t frames);
+
+    std::ifstream file_;
+    wav_format format_{};
+    std::uint64_t remaining_bytes_{};
+    std::vector<unsigned char> raw_; // reused read buffer for undecoded source bytes
+    std::size_t frames_hint_{};
+
+    audio_buffer decoded_; // fallback for formats without an incremental decoder
+    std::size_t decoded_offset_{};
+
+    struct resampler_deleter
+    {
+        void operator()(SRC_STATE_tag* state) const;
+    };
+    std::unique_ptr<SRC_STATE_tag, resampler_deleter> resampler_;
+    std::optional<polyphase_resampler> polyphase_; // replaces resampler_ for the medium and fast tiers
+    std::vector<float> pending_; // decoded source frames not yet consumed by resampler_, or polyphase_ output
+    std::size_t pending_offset_{};
+    bool source_exhausted_{false};
+    bool flushed_{false};
+};
+
+/**
+ * @brief Appends interleaved float frames to a WAV file and patches the header sizes on finalize.
+ *
+ * Frames are stored as 32-bit float by default; the PCM formats quantise them with TPDF dither.
+ */
+class wav_stream_writer
+{
+public:
+    [[nodiscard]] static std::expected<wav_stream_writer, std::string> create(
+        const std::filesystem::path& path,
+        int sample_rate,
+        std::size_t channels,
+        output_format format = output_format::wav);
+
+    [[nodiscard]] std::expected<void, std::string> append(std::span<const float> interleaved);
+    [[nodiscard]] std::expected<void, std::string> finalize();
+
+private:
+    wav_stream_writer() = default;
+
+    std::ofstream file_;
+    std::filesystem::path path_;
+    std::uint64_t data_bytes_{};
+    std::size_t sample_bytes_{sizeof(float)};
+    std::optional<tpdf_quantizer> quantizer_; // integer formats only
+    std::vector<char> encoded_;               // reused buffer of quantised bytes
+};
+
+} // namespace stemsmith
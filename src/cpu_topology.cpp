@@ -0,0 +1,299 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace stemsmith
+{
+
+namespace
+{
+std::optional<std::string> read_first_line(const std::filesystem::path& path)
+{
+    std::ifstream in(path);
+    std::string line;
+    if (!in || !std::getline(in, line))
+    {
+        return std::nullopt;
+    }
+    return line;
+}
+
+std::filesystem::path under(const std::filesystem::path& root, std::string_view absolute)
+{
+    return root / std::filesystem::path{absolute}.relative_path();
+}
+
+std::vector<int> allowed_cpus(const std::filesystem::path& root)
+{
+    std::ifstream status(under(root, "/proc/self/status"));
+    std::string line;
+    constexpr std::string_view key = "Cpus_allowed_list:";
+    while (std::getline(status, line))
+    {
+        if (line.starts_with(key))
+        {
+            return parse_cpu_list(std::string_view{line}.substr(key.size()));
+        }
+    }
+    return {};
+}
+
+// The tightest cpu.max between the process' cgroup and the cgroup root (limits nest).
+std::optional<double> cgroup_quota(const std::filesystem::path& root)
+{
+    std::string relative;
+    {
+        std::ifstream cgroups(under(root, "/proc/self/cgroup"));
+        std::string line;
+        while (std::getline(cgroups, line))
+        {
+            if (line.starts_with("0::"))
+            {
+                relative = line.substr(3);
+                break;
+            }
+        }
+    }
+
+    const auto mount = under(root, "/sys/fs/cgroup");
+    auto group = std::filesystem::path{relative}.relative_path();
+    std::optional<double> quota;
+    while (true)
+    {
+        if (const auto line = read_first_line(mount / group / "cpu.max"))
+        {
+            if (const auto cpus = parse_cpu_max(*line); cpus && (!quota || *cpus < *quota))
+            {
+                quota = cpus;
+            }
+        }
+        if (group.empty())
+        {
+            break;
+        }
+        group = group.parent_path();
+    }
+    return quota;
+}
+
+std::vector<numa_node> numa_nodes(const std::filesystem::path& root, const std::vector<int>& allowed)
+{
+    std::vector<numa_node> nodes;
+    std::error_code ec;
+    const auto node_root = under(root, "/sys/devices/system/node");
+    for (const auto& entry : std::filesystem::directory_iterator(node_root, ec))
+    {
+        const auto name = entry.path().filename().string();
+        int id = 0;
+        if (!name.starts_with("node") ||
+            std::from_chars(name.data() + 4, name.data() + name.size(), id).ec != std::errc{})
+        {
+            continue;
+        }
+
+        const auto list = read_first_line(entry.path() / "cpulist");
+        if (!list)
+        {
+            continue;
+        }
+
+        numa_node node{id, {}};
+        for (const auto cpu : parse_cpu_list(*list))
+        {
+            if (allowed.empty() || std::ranges::binary_search(allowed, cpu))
+            {
+                node.cpus.push_back(cpu);
+            }
+        }
+        if (!node.cpus.empty())
+        {
+            nodes.push_back(std::move(node));
+        }
+    }
+    std::ranges::sort(nodes, {}, &numa_node::id);
+    return nodes;
+}
+} // namespace
+
+std::size_t cpu_topology::usable_threads() const noexcept
+{
+    auto threads = allowed_cpus.empty() ? std::max(1U, std::thread::hardware_concurrency()) : allowed_cpus.size();
+    if (cpu_quota)
+    {
+        threads = std::min(threads, static_cast<std::size_t>(std::ceil(*cpu_quota)));
+    }
+    return std::max<std::size_t>(1, threads);
+}
+
+std::size_t cpu_topology::node_index_of(int cpu) const noexcept
+{
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        if (std::ranges::binary_search(nodes[i].cpus, cpu))
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+cpu_topology detect_cpu_topology(const std::filesystem::path& root)
+{
+    cpu_topology topology;
+    topology.allowed_cpus = allowed_cpus(root);
+    topology.cpu_quota = cgroup_quota(root);
+    topology.nodes = numa_nodes(root, topology.allowed_cpus);
+    return topology;
+}
+
+const cpu_topology& system_cpu_topology()
+{
+    static const cpu_topology topology = detect_cpu_topology();
+    return topology;
+}
+
+std::vector<int> parse_cpu_list(std::string_view text)
+{
+    std::vector<int> cpus;
+    while (!text.empty())
+    {
+        const auto comma = text.find(',');
+        auto range = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+
+        while (!range.empty() && std::isspace(static_cast<unsigned char>(range.front())))
+        {
+            range.remove_prefix(1);
+        }
+        while (!range.empty() && std::isspace(static_cast<unsigned char>(range.back())))
+        {
+            range.remove_suffix(1);
+        }
+
+        int first = 0;
+        const auto* end = range.data() + range.size();
+        const auto [next, ec] = std::from_chars(range.data(), end, first);
+        if (ec != std::errc{})
+        {
+            continue;
+        }
+        int last = first;
+        if (next != end && *next == '-' && std::from_chars(next + 1, end, last).ec != std::errc{})
+        {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    std::ranges::sort(cpus);
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::optional<double> parse_cpu_max(std::string_view text)
+{
+    const auto space = text.find(' ');
+    if (space == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+
+    const auto quota_text = text.substr(0, space);
+    const auto period_text = text.substr(space + 1);
+    long quota = 0;
+    long period = 0;
+    if (std::from_chars(quota_text.data(), quota_text.data() + quota_text.size(), quota).ec != std::errc{} ||
+        std::from_chars(period_text.data(), period_text.data() + period_text.size(), period).ec != std::errc{} ||
+        quota <= 0 || period <= 0)
+    {
+        return std::nullopt; // "max" or malformed: no limit
+    }
+    return static_cast<double>(quota) / static_cast<double>(period);
+}
+
+bool pin_current_thread(std::span<const int> cpus)
+{
+#ifdef __linux__
+    if (cpus.empty())
+    {
+        return false;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    // No portable affinity API; pinning is a no-op and callers keep running unpinned.
+    (void)cpus;
+    return false;
+#endif
+}
+
+thread_affinity_scope::thread_affinity_scope(std::span<const int> cpus)
+{
+#ifdef __linux__
+    if (cpus.empty())
+    {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &set))
+        {
+            previous_.push_back(cpu);
+        }
+    }
+    if (!pin_current_thread(cpus))
+    {
+        previous_.clear();
+    }
+#else
+    (void)cpus;
+#endif
+}
+
+thread_affinity_scope::~thread_affinity_scope()
+{
+    if (!previous_.empty())
+    {
+        pin_current_thread(previous_);
+    }
+}
+
+std::size_t current_node_index()
+{
+#ifdef __linux__
+    const auto cpu = sched_getcpu();
+    return cpu < 0 ? 0 : system_cpu_topology().node_index_of(cpu);
+#else
+    return 0;
+#endif
+}
+
+} // namespace stemsmith
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace stemsmith
+{
+
+/**
+ * @brief CPUs of one NUMA node that this process may run on.
+ */
+struct numa_node
+{
+    int id{};
+    std::vector<int> cpus;
+};
+
+/**
+ * @brief The CPU resources actually available to the process.
+ *
+ * `std::thread::hardware_concurrency()` reports every CPU on the host. Inside a container the
+ * cpuset (affinity mask) and the cgroup v2 `cpu.max` quota are usually far smaller, and on
+ * multi-socket hosts the allowed CPUs span several NUMA nodes.
+ */
+struct cpu_topology
+{
+    std::vector<int> allowed_cpus;   // affinity mask / cpuset of the process
+    std::optional<double> cpu_quota; // cgroup v2 cpu.max as a number of CPUs, if limited
+    std::vector<numa_node> nodes;    // nodes with at least one allowed CPU
+
+    // Threads worth running: the allowed CPUs, further capped by the quota (rounded up).
+    [[nodiscard]] std::size_t usable_threads() const noexcept;
+
+    // Index into `nodes` of the node that owns `cpu`; 0 when unknown.
+    [[nodiscard]] std::size_t node_index_of(int cpu) const noexcept;
+};
+
+// Reads /proc and /sys below `root`; a different root is only useful for tests. Off Linux the files are
+// absent, so the topology is empty and usable_threads() falls back to hardware_concurrency().
+[[nodiscard]] cpu_topology detect_cpu_topology(const std::filesystem::path& root = "/");
+
+// Cached topology of the running process, detected on first use.
+[[nodiscard]] const cpu_topology& system_cpu_topology();
+
+// Parses a kernel CPU list such as "0-3,8,10-11".
+[[nodiscard]] std::vector<int> parse_cpu_list(std::string_view text);
+
+// Parses cgroup v2 cpu.max ("<quota> <period>" or "max <period>") into a number of CPUs.
+[[nodiscard]] std::optional<double> parse_cpu_max(std::string_view text);
+
+// Restricts the calling thread (and threads it creates later) to `cpus`; false if the kernel refused.
+// A no-op returning false off Linux.
+bool pin_current_thread(std::span<const int> cpus);
+
+/**
+ * @brief Pins the calling thread to `cpus` and restores its previous affinity on destruction.
+ */
+class thread_affinity_scope
+{
+public:
+    explicit thread_affinity_scope(std::span<const int> cpus);
+    ~thread_affinity_scope();
+
+    thread_affinity_scope(const thread_affinity_scope&) = delete;
+    thread_affinity_scope& operator=(const thread_affinity_scope&) = delete;
+
+private:
+    std::vector<int> previous_;
+};
+
+// Index into system_cpu_topology().nodes of the node the calling thread currently runs on.
+[[nodiscard]] std::size_t current_node_index();
+
+} // namespace stemsmith
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace stemsmith
+{
+
+/**
+ * @brief Quantises float samples to `bits`-bit integers with triangular (TPDF) dither of ±1 LSB.
+ *
+ * The noise comes from a xorshift generator with a fixed seed, so the same stem always encodes to
+ * the same bytes and cached results stay byte-identical to fresh ones.
+ */
+class tpdf_quantizer
+{
+public:
+    explicit tpdf_quantizer(int bits) noexcept
+        : scale_(std::ldexp(1.0f, bits - 1))
+        , max_(static_cast<long>((std::int64_t{1} << (bits - 1)) - 1))
+        , min_(-static_cast<long>(std::int64_t{1} << (bits - 1)))
+    {
+    }
+
+    [[nodiscard]] std::int32_t operator()(float sample) noexcept
+    {
+        if (sample == 0.0f)
+        {
+            return 0; // digital silence stays silent, so silent stems still compress to almost nothing
+        }
+        const float noise = uniform() - uniform(); // triangular on (-1, 1) LSB
+        return static_cast<std::int32_t>(std::clamp(std::lrint(sample * scale_ + noise), min_, max_));
+    }
+
+private:
+    float uniform() noexcept
+    {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return static_cast<float>(state_ >> 40) * 0x1p-24f;
+    }
+
+    float scale_;
+    long max_;
+    long min_;
+    std::uint64_t state_{0x9E3779B97F4A7C15ULL};
+};
+
+} // namespace stemsmith
@@ -0,0 +1,808 @@
+#include "flac_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <utility>
+
+namespace stemsmith
+{
+
+namespace
+{
+constexpr unsigned kBitsPerSample = 24;
+constexpr int kCoefficientPrecision = 15;
+// Levinson-Durbin stops once the prediction error falls below this fraction of the signal energy.
+constexpr double kMinRelativeLpcError = 1e-10;
+constexpr unsigned kMaxRiceParameter = 30;
+constexpr std::size_t kStreamInfoOffset = 8; // after "fLaC" and the metadata block header
+constexpr std::size_t kStreamInfoBytes = 34;
+
+struct level_settings
+{
+    std::size_t block_size;
+    unsigned max_fixed_order;
+    unsigned max_lpc_order;
+    unsigned max_partition_order;
+    bool stereo_search;  // try left/side, side/right and mid/side besides independent channels
+    bool exhaustive_lpc; // evaluate every LPC order instead of the estimated best one
+};
+
+// Mirrors the reference encoder's presets closely enough that `-0` .. `-8` mean the same trade-off.
+constexpr std::array<level_settings, 9> kLevels{{
+    {1152, 2, 0, 3, false, false},
+    {1152, 2, 0, 3, true, false},
+    {1152, 4, 0, 3, true, false},
+    {4096, 4, 6, 4, true, false},
+    {4096, 4, 8, 4, true, false},
+    {4096, 4, 8, 5, true, false},
+    {4096, 4, 8, 6, true, false},
+    {4096, 4, 12, 6, true, false},
+    {4096, 4, 12, 6, true, true},
+}};
+
+// MSB-first bit packer appending whole bytes to `out`.
+class bit_writer
+{
+public:
+    explicit bit_writer(std::vector<unsigned char>& out) : out_(out) {}
+
+    void put(std::uint64_t value, unsigned bits)
+    {
+        // At most 7 bits are pending, so up to 32 new ones always fit the accumulator.
+        acc_ = (acc_ << bits) | (value & ((std::uint64_t{1} << bits) - 1));
+        pending_ += bits;
+        while (pending_ >= 8)
+        {
+            pending_ -= 8;
+            out_.push_back(static_cast<unsigned char>(acc_ >> pending_));
+        }
+        acc_ &= (std::uint64_t{1} << pending_) - 1;
+    }
+
+    void put_signed(std::int64_t value, unsigned bits)
+    {
+        put(static_cast<std::uint64_t>(value), bits);
+    }
+
+    void put_rice(std::uint64_t value, unsigned parameter)
+    {
+        // Unary quotient (zeros closed by a one), then the low `parameter` bits.
+        auto quotient = value >> parameter;
+        for (; quotient >= 32; quotient -= 32)
+        {
+            put(0, 32);
+        }
+        put(1, static_cast<unsigned>(quotient) + 1);
+        if (parameter > 0)
+        {
+            put(value, parameter);
+        }
+    }
+
+    void align()
+    {
+        if (pending_ > 0)
+        {
+            put(0, 8 - pending_);
+        }
+    }
+
+private:
+    std::vector<unsigned char>& out_;
+    std::uint64_t acc_{};
+    unsigned pending_{};
+};
+
+std::uint8_t crc8(std::span<const unsigned char> bytes)
+{
+    std::uint8_t crc = 0;
+    for (const auto byte : bytes)
+    {
+        crc ^= byte;
+        for (int i = 0; i < 8; ++i)
+        {
+            crc = static_cast<std::uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+const std::array<std::uint16_t, 256>& crc16_table()
+{
+    static const auto table = []
+    {
+        std::array<std::uint16_t, 256> entries{};
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            auto crc = static_cast<std::uint16_t>(i << 8);
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = static_cast<std::uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+    return table;
+}
+
+std::uint16_t crc16(std::span<const unsigned char> bytes)
+{
+    const auto& table = crc16_table();
+    std::uint16_t crc = 0;
+    for (const auto byte : bytes)
+    {
+        crc = static_cast<std::uint16_t>((crc << 8) ^ table[(crc >> 8) ^ byte]);
+    }
+    return crc;
+}
+
+unsigned sample_rate_code(int sample_rate)
+{
+    switch (sample_rate)
+    {
+    case 88200:
+        return 0b0001;
+    case 44100:
+        return 0b1001;
+    case 48000:
+        return 0b1010;
+    case 96000:
+        return 0b1011;
+    default:
+        return 0b0000; // taken from STREAMINFO
+    }
+}
+
+void put_utf8(bit_writer& out, std::uint32_t value)
+{
+    if (value < 0x80)
+    {
+        return out.put(value, 8);
+    }
+    // Lead byte carries the length in its high bits, each continuation byte six payload bits.
+    unsigned continuation = value < 0x800       ? 1
+                            : value < 0x10000   ? 2
+                            : value < 0x200000  ? 3
+                            : value < 0x4000000 ? 4
+                                                : 5;
+    const auto lead_mask = static_cast<std::uint32_t>(0xFF00 >> (continuation + 1)) & 0xFF;
+    out.put(lead_mask | (value >> (6 * continuation)), 8);
+    while (continuation-- > 0)
+    {
+        out.put(0x80 | ((value >> (6 * continuation)) & 0x3F), 8);
+    }
+}
+
+std::uint64_t zigzag(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+struct subframe_plan
+{
+    enum class kind
+    {
+        constant,
+        verbatim,
+        fixed,
+        lpc
+    };
+
+    kind type{kind::verbatim};
+    unsigned order{};
+    int shift{};
+    std::array<std::int32_t, 32> coefficients{};
+    std::vector<std::uint64_t> residual; // zigzag-coded residual of samples order..n
+    unsigned partition_order{};
+    std::vector<unsigned> rice_parameters;
+    std::uint64_t bits{std::numeric_limits<std::uint64_t>::max()};
+};
+} // namespace
+
+struct flac_encoder_scratch
+{
+    std::vector<std::int32_t> mid;
+    std::vector<std::int32_t> side;
+    std::vector<subframe_plan> best; // left, right, mid, side for stereo; one per channel otherwise
+    subframe_plan candidate;
+    std::vector<double> windowed;
+    std::vector<std::uint64_t> partition_sums;
+};
+
+namespace
+{
+// Picks the partition order and per-partition Rice parameters for `plan.residual` and sets
+// `plan.bits` to the subframe's total size given `header_bits` for everything before the residual.
+void plan_rice(subframe_plan& plan,
+               std::size_t block,
+               unsigned max_partition_order,
+               std::uint64_t header_bits,
+               std::vector<std::uint64_t>& sums)
+{
+    // Largest usable order: partitions must divide the block and the first must outlast the warm-up.
+    unsigned top = 0;
+    while (top < max_partition_order && (block % (std::size_t{2} << top)) == 0 &&
+           (block >> (top + 1)) > plan.order)
+    {
+        ++top;
+    }
+
+    // Sums at the finest order, merged pairwise for the coarser ones.
+    const std::size_t finest = std::size_t{1} << top;
+    sums.assign(finest, 0);
+    const auto partition_size = block >> top;
+    for (std::size_t p = 0, i = 0; p < finest; ++p)
+    {
+        const auto end = (p + 1) * partition_size - plan.order;
+        for (; i < end; ++i)
+        {
+            sums[p] += plan.residual[i];
+        }
+    }
+
+    plan.bits = std::numeric_limits<std::uint64_t>::max();
+    std::array<unsigned, 64> parameters{};
+    for (int order = static_cast<int>(top); order >= 0; --order)
+    {
+        const std::size_t partitions = std::size_t{1} << order;
+        const auto samples = block >> order;
+        std::uint64_t bits = 6; // coding method and partition order
+        unsigned widest = 0;
+        for (std::size_t p = 0; p < partitions; ++p)
+        {
+            const auto count = samples - (p == 0 ? plan.order : 0);
+            const auto sum = sums[p];
+            // Near-optimal parameter from the mean, refined against its neighbours.
+            unsigned guess = count > 0 && sum > count ? std::bit_width(sum / count) - 1 : 0;
+            std::uint64_t best_bits = std::numeric_limits<std::uint64_t>::max();
+            unsigned best = 0;
+            for (unsigned k = guess > 0 ? guess - 1 : 0; k <= std::min(guess + 1, kMaxRiceParameter); ++k)
+            {
+                const auto cost = count * (k + 1) + (sum >> k);
+                if (cost < best_bits)
+                {
+                    best_bits = cost;
+                    best = k;
+                }
+            }
+            parameters[p] = best;
+            widest = std::max(widest, best);
+            bits += best_bits;
+        }
+        bits += partitions * (widest > 14 ? 5 : 4);
+        if (header_bits + bits < plan.bits)
+        {
+            plan.bits = header_bits + bits;
+            plan.partition_order = static_cast<unsigned>(order);
+            const auto used = parameters.begin() + static_cast<std::ptrdiff_t>(partitions);
+            plan.rice_parameters.assign(parameters.begin(), used);
+        }
+
+        for (std::size_t p = 0; p < partitions / 2; ++p)
+        {
+            sums[p] = sums[2 * p] + sums[2 * p + 1];
+        }
+    }
+}
+
+void fixed_residual(std::span<const std::int32_t> x, unsigned order, std::vector<std::uint64_t>& out)
+{
+    out.resize(x.size() - order);
+    for (std::size_t i = order; i < x.size(); ++i)
+    {
+        const std::int64_t s0 = x[i];
+        std::int64_t r = s0;
+        switch (order)
+        {
+        case 1:
+            r = s0 - x[i - 1];
+            break;
+        case 2:
+            r = s0 - 2 * std::int64_t{x[i - 1]} + x[i - 2];
+            break;
+        case 3:
+            r = s0 - 3 * std::int64_t{x[i - 1]} + 3 * std::int64_t{x[i - 2]} - x[i - 3];
+            break;
+        case 4:
+            r = s0 - 4 * std::int64_t{x[i - 1]} + 6 * std::int64_t{x[i - 2]} - 4 * std::int64_t{x[i - 3]} +
+                x[i - 4];
+            break;
+        default:
+            break;
+        }
+        out[i - order] = zigzag(r);
+    }
+}
+
+// Computes the quantised-LPC residual; false when a residual leaves the 32-bit range decoders use.
+bool lpc_residual(std::span<const std::int32_t> x, const subframe_plan& plan, std::vector<std::uint64_t>& out)
+{
+    out.resize(x.size() - plan.order);
+    for (std::size_t i = plan.order; i < x.size(); ++i)
+    {
+        std::int64_t prediction = 0;
+        for (unsigned j = 0; j < plan.order; ++j)
+        {
+            prediction += std::int64_t{plan.coefficients[j]} * x[i - 1 - j];
+        }
+        const auto r = std::int64_t{x[i]} - (prediction >> plan.shift);
+        if (r > std::numeric_limits<std::int32_t>::max() || r < std::numeric_limits<std::int32_t>::min())
+        {
+            return false;
+        }
+        out[i - plan.order] = zigzag(r);
+    }
+    return true;
+}
+
+// Quantises `lpc` (predicting x[i] from x[i-1-j]) to kCoefficientPrecision-bit integers plus a shift.
+bool quantize_coefficients(std::span<const double> lpc, subframe_plan& plan)
+{
+    double max = 0.0;
+    for (const auto c : lpc)
+    {
+        max = std::max(max, std::abs(c));
+    }
+    if (max <= 0.0)
+    {
+        return false;
+    }
+
+    int exponent = 0;
+    std::frexp(max, &exponent);
+    const int shift = std::min(15, kCoefficientPrecision - 1 - exponent);
+    if (shift < 0)
+    {
+        return false; // negative shifts are not decodable by common decoders
+    }
+
+    const auto limit = std::int32_t{1} << (kCoefficientPrecision - 1);
+    double carried = 0.0;
+    for (std::size_t j = 0; j < lpc.size(); ++j)
+    {
+        // Carry the rounding error forward so the quantised filter stays close in aggregate.
+        carried += lpc[j] * static_cast<double>(1 << shift);
+        const auto q = std::clamp(static_cast<std::int32_t>(std::lround(carried)), -limit, limit - 1);
+        carried -= q;
+        plan.coefficients[j] = q;
+    }
+    plan.order = static_cast<unsigned>(lpc.size());
+    plan.shift = shift;
+    return true;
+}
+
+void analyse_subframe(std::span<const std::int32_t> x,
+                      unsigned bps,
+                      const level_settings& settings,
+                      flac_encoder_scratch& scratch,
+                      subframe_plan& best)
+{
+    const auto n = x.size();
+    best.bits = 8 + std::uint64_t{bps} * n;
+    best.type = subframe_plan::kind::verbatim;
+    best.order = 0;
+
+    if (std::ranges::all_of(x, [&](std::int32_t s) { return s == x[0]; }))
+    {
+        best.type = subframe_plan::kind::constant;
+        best.bits = 8 + bps;
+        return;
+    }
+
+    auto& candidate = scratch.candidate;
+    const auto consider = [&]
+    {
+        if (candidate.bits < best.bits)
+        {
+            std::swap(candidate, best);
+        }
+    };
+
+    // Fixed predictors are successive differences, so one pass yields every order's residual
+    // magnitude; the smallest is coded.
+    const auto max_fixed = static_cast<unsigned>(std::min<std::size_t>(settings.max_fixed_order, n - 1));
+    std::array<std::uint64_t, 5> magnitudes{};
+    std::array<std::int64_t, 5> previous{};
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        std::int64_t difference = x[i];
+        for (unsigned order = 0; order <= max_fixed; ++order)
+        {
+            if (i >= order)
+            {
+                magnitudes[order] += static_cast<std::uint64_t>(difference < 0 ? -difference : difference);
+            }
+            const auto next = difference - previous[order];
+            previous[order] = difference;
+            difference = next;
+        }
+    }
+    const auto fixed_order = static_cast<unsigned>(
+        std::ranges::min_element(magnitudes.begin(), magnitudes.begin() + max_fixed + 1) - magnitudes.begin());
+    candidate.type = subframe_plan::kind::fixed;
+    candidate.order = fixed_order;
+    fixed_residual(x, fixed_order, candidate.residual);
+    const auto fixed_header_bits = 8 + std::uint64_t{bps} * fixed_order;
+    plan_rice(candidate, n, settings.max_partition_order, fixed_header_bits, scratch.partition_sums);
+    consider();
+
+    const auto max_order = std::min<std::size_t>(settings.max_lpc_order, n > 1 ? n - 1 : 0);
+    if (max_order == 0)
+    {
+        return;
+    }
+
+    // Tukey(0.5)-windowed autocorrelation, then Levinson-Durbin for every order up to max_order.
+    auto& w = scratch.windowed;
+    w.resize(n);
+    const auto taper = static_cast<double>(n) / 4.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const auto edge = static_cast<double>(std::min(i, n - 1 - i));
+        const auto gain = edge >= taper ? 1.0 : 0.5 * (1.0 - std::cos(std::numbers::pi * edge / taper));
+        w[i] = gain * x[i];
+    }
+    std::array<double, 33> autoc{};
+    for (std::size_t lag = 0; lag <= max_order; ++lag)
+    {
+        double sum = 0.0;
+        for (std::size_t i = lag; i < n; ++i)
+        {
+            sum += w[i] * w[i - lag];
+        }
+        autoc[lag] = sum;
+    }
+    if (autoc[0] <= 0.0)
+    {
+        return;
+    }
+
+    std::array<std::array<double, 32>, 32> coefficients{};
+    std::array<double, 32> errors{};
+    std::array<double, 32> lpc{};
+    double error = autoc[0] * (1.0 + 1e-9); // a hair of regularisation keeps the recursion stable
+    const auto min_error = autoc[0] * kMinRelativeLpcError;
+    std::size_t orders = 0;
+    for (std::size_t i = 0; i < max_order; ++i)
+    {
+        // Once the error has (nearly) vanished the next reflection divides by rounding noise, so
+        // stop and let the orders found so far, or the fixed/verbatim subframes, cover the block.
+        if (error <= min_error)
+        {
+            break;
+        }
+        double reflection = -autoc[i + 1];
+        for (std::size_t j = 0; j < i; ++j)
+        {
+            reflection -= lpc[j] * autoc[i - j];
+        }
+        reflection /= error;
+        if (!std::isfinite(reflection) || std::abs(reflection) >= 1.0)
+        {
+            break; // an unstable filter; numerically the recursion has broken down
+        }
+        lpc[i] = reflection;
+        for (std::size_t j = 0; j < i / 2; ++j)
+        {
+            const auto tmp = lpc[j];
+            lpc[j] += reflection * lpc[i - 1 - j];
+            lpc[i - 1 - j] += reflection * tmp;
+        }
+        if (i % 2 == 1)
+        {
+            lpc[i / 2] += lpc[i / 2] * reflection;
+        }
+        error *= 1.0 - reflection * reflection;
+        for (std::size_t j = 0; j <= i; ++j)
+        {
+            coefficients[i][j] = -lpc[j];
+        }
+        errors[i] = std::max(error, min_error);
+        orders = i + 1;
+    }
+    if (orders == 0)
+    {
+        return;
+    }
+
+    // Cheap order estimate from the prediction error unless every order is tried.
+    std::size_t first = 1;
+    std::size_t last = orders;
+    if (!settings.exhaustive_lpc)
+    {
+        double best_estimate = std::numeric_limits<double>::max();
+        for (std::size_t order = 1; order <= orders; ++order)
+        {
+            const auto per_sample = std::max(0.0, 0.5 * std::log2(errors[order - 1] / static_cast<double>(n)));
+            const auto estimate = per_sample * static_cast<double>(n - order) +
+                                  static_cast<double>(order * (bps + kCoefficientPrecision));
+            if (estimate < best_estimate)
+            {
+                best_estimate = estimate;
+                first = last = order;
+            }
+        }
+    }
+
+    for (auto order = first; order <= last; ++order)
+    {
+        candidate.type = subframe_plan::kind::lpc;
+        if (!quantize_coefficients({coefficients[order - 1].data(), order}, candidate) ||
+            !lpc_residual(x, candidate, candidate.residual))
+        {
+            continue;
+        }
+        const auto header_bits = 8 + std::uint64_t{bps} * order + 4 + 5 + kCoefficientPrecision * order;
+        plan_rice(candidate, n, settings.max_partition_order, header_bits, scratch.partition_sums);
+        consider();
+    }
+}
+
+void write_subframe(bit_writer& out, std::span<const std::int32_t> x, unsigned bps, const subframe_plan& plan)
+{
+    switch (plan.type)
+    {
+    case subframe_plan::kind::constant:
+        out.put(0b00000000, 8);
+        out.put_signed(x[0], bps);
+        return;
+    case subframe_plan::kind::verbatim:
+        out.put(0b00000010, 8);
+        for (const auto s : x)
+        {
+            out.put_signed(s, bps);
+        }
+        return;
+    case subframe_plan::kind::fixed:
+        out.put((0b001000 | plan.order) << 1, 8);
+        break;
+    case subframe_plan::kind::lpc:
+        out.put((0b100000 | (plan.order - 1)) << 1, 8);
+        break;
+    }
+
+    for (unsigned i = 0; i < plan.order; ++i)
+    {
+        out.put_signed(x[i], bps);
+    }
+    if (plan.type == subframe_plan::kind::lpc)
+    {
+        out.put(kCoefficientPrecision - 1, 4);
+        out.put_signed(plan.shift, 5);
+        for (unsigned j = 0; j < plan.order; ++j)
+        {
+            out.put_signed(plan.coefficients[j], kCoefficientPrecision);
+        }
+    }
+
+    const bool wide = std::ranges::any_of(plan.rice_parameters, [](unsigned k) { return k > 14; });
+    out.put(wide ? 1 : 0, 2);
+    out.put(plan.partition_order, 4);
+    const auto samples = x.size() >> plan.partition_order;
+    std::size_t i = 0;
+    for (std::size_t p = 0; p < plan.rice_parameters.size(); ++p)
+    {
+        const auto k = plan.rice_parameters[p];
+        out.put(k, wide ? 5 : 4);
+        const auto end = (p + 1) * samples - plan.order;
+        for (; i < end; ++i)
+        {
+            out.put_rice(plan.residual[i], k);
+        }
+    }
+}
+
+// Big-endian, as every FLAC metadata field is.
+void put_be(std::ostream& out, std::uint64_t value, std::size_t bytes)
+{
+    while (bytes-- > 0)
+    {
+        out.put(static_cast<char>(value >> (8 * bytes)));
+    }
+}
+} // namespace
+
+flac_stream_writer::flac_stream_writer(flac_stream_writer&&) noexcept = default;
+flac_stream_writer& flac_stream_writer::operator=(flac_stream_writer&&) noexcept = default;
+flac_stream_writer::~flac_stream_writer() = default;
+
+std::expected<flac_stream_writer, std::string> flac_stream_writer::create(const std::filesystem::path& path,
+                                                                          int sample_rate,
+                                                                          std::size_t channels,
+                                                                          unsigned level)
+{
+    if (channels == 0 || channels > 8 || sample_rate <= 0 || sample_rate >= (1 << 20))
+    {
+        return std::unexpected("Failed to write audio: FLAC supports 1-8 channels below 1 MHz");
+    }
+
+    if (const auto parent = path.parent_path(); !parent.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(parent, ec);
+        if (ec)
+        {
+            return std::unexpected("Failed to create output directory: " + ec.message());
+        }
+    }
+
+    flac_stream_writer writer;
+    writer.path_ = path;
+    writer.sample_rate_ = sample_rate;
+    writer.channels_ = channels;
+    writer.level_ = std::min<unsigned>(level, kLevels.size() - 1);
+    writer.block_size_ = kLevels[writer.level_].block_size;
+    writer.block_.resize(channels * writer.block_size_);
+    writer.scratch_ = std::make_unique<flac_encoder_scratch>();
+    writer.scratch_->best.resize(std::max<std::size_t>(channels, 4));
+    writer.file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!writer.file_)
+    {
+        return std::unexpected("Failed to write audio: cannot open " + path.string());
+    }
+
+    // Marker plus a single (last) STREAMINFO block, rewritten with the real totals in finalize().
+    writer.file_.write("fLaC", 4);
+    const std::array<char, 4> header{static_cast<char>(0x80), 0, 0, static_cast<char>(kStreamInfoBytes)};
+    writer.file_.write(header.data(), header.size());
+    const std::array<char, kStreamInfoBytes> placeholder{};
+    writer.file_.write(placeholder.data(), placeholder.size());
+    if (!writer.file_)
+    {
+        return std::unexpected("Failed to write audio: " + path.string());
+    }
+    return writer;
+}
+
+std::expected<void, std::string> flac_stream_writer::append(std::span<const float> interleaved)
+{
+    const auto frames = interleaved.size() / channels_;
+    for (std::size_t f = 0; f < frames; ++f)
+    {
+        for (std::size_t ch = 0; ch < channels_; ++ch)
+        {
+            block_[ch * block_size_ + block_fill_] = quantizer_(interleaved[f * channels_ + ch]);
+        }
+        if (++block_fill_ == block_size_)
+        {
+            if (auto status = encode_block(block_size_); !status)
+            {
+                return status;
+            }
+            block_fill_ = 0;
+        }
+    }
+    return {};
+}
+
+std::expected<void, std::string> flac_stream_writer::encode_block(std::size_t frames)
+{
+    const auto& settings = kLevels[level_];
+    auto& scratch = *scratch_;
+    const auto channel = [&](std::size_t ch)
+    { return std::span<const std::int32_t>{block_.data() + ch * block_size_, frames}; };
+
+    // Channel assignment: 0..7 independent, 8 left/side, 9 side/right, 10 mid/side.
+    unsigned assignment = static_cast<unsigned>(channels_ - 1);
+    std::array<std::span<const std::int32_t>, 8> sources{};
+    std::array<unsigned, 8> depths{};
+    std::array<const subframe_plan*, 8> plans{};
+    if (channels_ == 2 && settings.stereo_search)
+    {
+        scratch.mid.resize(frames);
+        scratch.side.resize(frames);
+        const auto left = channel(0);
+        const auto right = channel(1);
+        for (std::size_t i = 0; i < frames; ++i)
+        {
+            scratch.mid[i] = (left[i] + right[i]) >> 1;
+            scratch.side[i] = left[i] - right[i];
+        }
+        const std::array<std::span<const std::int32_t>, 4> signals{
+            left, right, std::span<const std::int32_t>{scratch.mid}, std::span<const std::int32_t>{scratch.side}};
+        for (std::size_t s = 0; s < 4; ++s)
+        {
+            analyse_subframe(signals[s], kBitsPerSample + (s == 3 ? 1 : 0), settings, scratch, scratch.best[s]);
+        }
+
+        // Pairs of (first, second) signal indices for assignments 1 (independent), 8, 9 and 10.
+        constexpr std::array<std::array<std::size_t, 2>, 4> pairs{{{0, 1}, {0, 3}, {3, 1}, {2, 3}}};
+        constexpr std::array<unsigned, 4> codes{1, 8, 9, 10};
+        std::size_t chosen = 0;
+        for (std::size_t c = 1; c < pairs.size(); ++c)
+        {
+            const auto cost = scratch.best[pairs[c][0]].bits + scratch.best[pairs[c][1]].bits;
+            if (cost < scratch.best[pairs[chosen][0]].bits + scratch.best[pairs[chosen][1]].bits)
+            {
+                chosen = c;
+            }
+        }
+        assignment = codes[chosen];
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            const auto s = pairs[chosen][i];
+            sources[i] = signals[s];
+            depths[i] = kBitsPerSample + (s == 3 ? 1 : 0);
+            plans[i] = &scratch.best[s];
+        }
+    }
+    else
+    {
+        for (std::size_t ch = 0; ch < channels_; ++ch)
+        {
+            sources[ch] = channel(ch);
+            depths[ch] = kBitsPerSample;
+            analyse_subframe(sources[ch], kBitsPerSample, settings, scratch, scratch.best[ch]);
+            plans[ch] = &scratch.best[ch];
+        }
+    }
+
+    frame_.clear();
+    bit_writer out(frame_);
+    out.put(0b11111111111110, 14); // sync code
+    out.put(0, 1);                 // reserved
+    out.put(0, 1);                 // fixed block size
+    out.put(0b0111, 4);            // block size - 1 follows as 16 bits
+    out.put(sample_rate_code(sample_rate_), 4);
+    out.put(assignment, 4);
+    out.put(0b110, 3); // 24 bits per sample
+    out.put(0, 1);
+    put_utf8(out, frame_number_);
+    out.put(frames - 1, 16);
+    out.put(crc8(frame_), 8);
+
+    for (std::size_t ch = 0; ch < channels_; ++ch)
+    {
+        write_subframe(out, sources[ch], depths[ch], *plans[ch]);
+    }
+    out.align();
+    out.put(crc16(frame_), 16);
+
+    file_.write(reinterpret_cast<const char*>(frame_.data()), static_cast<std::streamsize>(frame_.size()));
+    if (!file_)
+    {
+        return std::unexpected("Failed to write audio: " + path_.string());
+    }
+    const auto bytes = static_cast<std::uint32_t>(frame_.size());
+    min_frame_bytes_ = std::min(min_frame_bytes_, bytes);
+    max_frame_bytes_ = std::max(max_frame_bytes_, bytes);
+    total_frames_ += frames;
+    ++frame_number_;
+    return {};
+}
+
+std::expected<void, std::string> flac_stream_writer::finalize()
+{
+    if (block_fill_ > 0)
+    {
+        if (auto status = encode_block(block_fill_); !status)
+        {
+            return status;
+        }
+        block_fill_ = 0;
+    }
+
+    file_.seekp(static_cast<std::streamoff>(kStreamInfoOffset));
+    put_be(file_, block_size_, 2); // minimum block size
+    put_be(file_, block_size_, 2); // maximum block size
+    put_be(file_, total_frames_ > 0 ? min_frame_bytes_ : 0, 3);
+    put_be(file_, max_frame_bytes_, 3);
+    // 20-bit rate, 3-bit channels - 1, 5-bit bits per sample - 1, 36-bit total frames; the MD5 stays zero.
+    put_be(file_,
+           (static_cast<std::uint64_t>(sample_rate_) << 44) | (static_cast<std::uint64_t>(channels_ - 1) << 41) |
+               (std::uint64_t{kBitsPerSample - 1} << 36) | (total_frames_ & 0xFFFFFFFFFULL),
+           8);
+    file_.close();
+    if (file_.fail())
+    {
+        return std::unexpected("Failed to write audio: " + path_.string());
+    }
+    return {};
+}
+
+} // namespace stemsmith
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "dither.h"
+
+namespace stemsmith
+{
+
+struct flac_encoder_scratch;
+
+/**
+ * @brief Appends interleaved float frames to a 24-bit FLAC file, one block at a time.
+ *
+ * Samples are dithered to 24 bits and each block picks the cheapest of constant, verbatim, fixed
+ * and LPC subframes (and of left/right, left/side, side/right and mid/side for stereo), with
+ * Rice-coded residuals. `level` 0-8 trades encode time for size like the reference encoder's
+ * presets. STREAMINFO is rewritten on finalize; its MD5 is left unset, which decoders accept.
+ */
+class flac_stream_writer
+{
+public:
+    [[nodiscard]] static std::expected<flac_stream_writer, std::string> create(const std::filesystem::path& path,
+                                                                               int sample_rate,
+                                                                               std::size_t channels,
+                                                                               unsigned level);
+
+    [[nodiscard]] std::expected<void, std::string> append(std::span<const float> interleaved);
+    [[nodiscard]] std::expected<void, std::string> finalize();
+
+    flac_stream_writer(flac_stream_writer&&) noexcept;
+    flac_stream_writer& operator=(flac_stream_writer&&) noexcept;
+    ~flac_stream_writer();
+
+private:
+    flac_stream_writer() = default;
+
+    [[nodiscard]] std::expected<void, std::string> encode_block(std::size_t frames);
+
+    std::ofstream file_;
+    std::filesystem::path path_;
+    int sample_rate_{};
+    std::size_t channels_{};
+    unsigned level_{};
+    std::size_t block_size_{};
+    tpdf_quantizer quantizer_{24};
+    std::vector<std::int32_t> block_; // planar, block_size_ frames per channel
+    std::size_t block_fill_{};
+    std::unique_ptr<flac_encoder_scratch> scratch_; // subframe search buffers reused across blocks
+    std::vector<unsigned char> frame_;
+    std::uint64_t total_frames_{};
+    std::uint32_t frame_number_{};
+    std::uint32_t min_frame_bytes_{0xFFFFFF};
+    std::uint32_t max_frame_bytes_{};
+};
+
+} // namespace stemsmith
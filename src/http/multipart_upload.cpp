@@ -0,0 +1,335 @@
+#include "multipart_upload.h"
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace stemsmith::http
+{
+
+namespace
+{
+constexpr std::size_t kMaxHeaderBytes = 16 * 1024;
+constexpr std::string_view kHeaderEnd = "\r\n\r\n";
+constexpr std::string_view kLineEnd = "\r\n";
+
+std::string lowercase(std::string_view value)
+{
+    std::string lowered{value};
+    std::ranges::transform(lowered, lowered.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lowered;
+}
+
+std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+std::string_view unquote(std::string_view value)
+{
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+    {
+        value = value.substr(1, value.size() - 2);
+    }
+    return value;
+}
+
+// Value of `key` in a `type; key=value; key="value"` header, if present.
+std::optional<std::string> header_param(std::string_view header, std::string_view key)
+{
+    while (!header.empty())
+    {
+        const auto end = header.find(';');
+        const auto param = trim(header.substr(0, end));
+        header = end == std::string_view::npos ? std::string_view{} : header.substr(end + 1);
+        const auto eq = param.find('=');
+        if (eq != std::string_view::npos && lowercase(trim(param.substr(0, eq))) == key)
+        {
+            return std::string{unquote(trim(param.substr(eq + 1)))};
+        }
+    }
+    return std::nullopt;
+}
+
+upload_error malformed(std::string message)
+{
+    return {upload_error::kind::malformed, std::move(message)};
+}
+} // namespace
+
+multipart_upload::multipart_upload(std::string_view boundary,
+                                   file_opener open_file,
+                                   std::uint64_t max_file_bytes,
+                                   std::size_t max_field_bytes)
+    : delimiter_("\r\n--" + std::string{boundary})
+    , open_file_(std::move(open_file))
+    , max_file_bytes_(max_file_bytes)
+    , max_field_bytes_(max_field_bytes)
+{
+}
+
+multipart_upload::~multipart_upload() = default;
+
+std::optional<std::string> multipart_upload::boundary_from(std::string_view content_type)
+{
+    auto boundary = header_param(content_type, "boundary");
+    if (!boundary || boundary->empty())
+    {
+        return std::nullopt;
+    }
+    return boundary;
+}
+
+std::expected<void, upload_error> multipart_upload::feed(std::string_view bytes)
+{
+    pending_.append(bytes);
+    while (true)
+    {
+        switch (state_)
+        {
+        case state::preamble:
+        {
+            const auto first = std::string_view{delimiter_}.substr(kLineEnd.size());
+            const auto pos = pending_.find(first);
+            if (pos == std::string::npos)
+            {
+                if (pending_.size() >= first.size())
+                {
+                    pending_.erase(0, pending_.size() - first.size() + 1);
+                }
+                return {};
+            }
+            pending_.erase(0, pos + first.size());
+            state_ = state::delimiter;
+            break;
+        }
+        case state::delimiter:
+            if (pending_.size() < 2)
+            {
+                return {};
+            }
+            if (pending_.starts_with("--"))
+            {
+                pending_.clear();
+                state_ = state::done;
+                return {};
+            }
+            if (!pending_.starts_with(kLineEnd))
+            {
+                return std::unexpected(malformed("malformed multipart boundary"));
+            }
+            pending_.erase(0, kLineEnd.size());
+            state_ = state::headers;
+            break;
+        case state::headers:
+        {
+            const auto pos = pending_.find(kHeaderEnd);
+            if (pos == std::string::npos)
+            {
+                if (pending_.size() > kMaxHeaderBytes)
+                {
+                    return std::unexpected(malformed("multipart part headers too large"));
+                }
+                return {};
+            }
+            if (auto begun = begin_part(std::string_view{pending_}.substr(0, pos)); !begun)
+            {
+                return begun;
+            }
+            pending_.erase(0, pos + kHeaderEnd.size());
+            state_ = state::body;
+            break;
+        }
+        case state::body:
+        {
+            const auto pos = pending_.find(delimiter_);
+            if (pos == std::string::npos)
+            {
+                // Keep just enough to recognise a delimiter split across slices.
+                const auto keep = delimiter_.size() - 1;
+                if (pending_.size() > keep)
+                {
+                    const auto ready = pending_.size() - keep;
+                    if (auto emitted = emit(std::string_view{pending_}.substr(0, ready)); !emitted)
+                    {
+                        return emitted;
+                    }
+                    pending_.erase(0, ready);
+                }
+                return {};
+            }
+            if (auto emitted = emit(std::string_view{pending_}.substr(0, pos)); !emitted)
+            {
+                return emitted;
+            }
+            pending_.erase(0, pos + delimiter_.size());
+            if (auto ended = end_part(); !ended)
+            {
+                return ended;
+            }
+            state_ = state::delimiter;
+            break;
+        }
+        case state::done:
+            pending_.clear(); // epilogue
+            return {};
+        }
+    }
+}
+
+std::expected<void, upload_error> multipart_upload::finish()
+{
+    if (state_ != state::done)
+    {
+        return std::unexpected(malformed("multipart body truncated"));
+    }
+    if (file_.is_open())
+    {
+        file_.close();
+        if (!file_)
+        {
+            return std::unexpected(upload_error{upload_error::kind::io, "failed to save upload"});
+        }
+    }
+    return {};
+}
+
+void multipart_upload::discard()
+{
+    if (file_.is_open())
+    {
+        file_.close();
+    }
+    if (file_path_)
+    {
+        std::error_code ec;
+        std::filesystem::remove(*file_path_, ec);
+    }
+}
+
+const std::string* multipart_upload::field(const std::string& name) const
+{
+    const auto it = fields_.find(name);
+    return it == fields_.end() ? nullptr : &it->second;
+}
+
+std::expected<void, upload_error> multipart_upload::begin_part(std::string_view headers)
+{
+    std::optional<std::string> name;
+    file_info info;
+    while (!headers.empty())
+    {
+        const auto end = headers.find(kLineEnd);
+        const auto line = headers.substr(0, end);
+        headers = end == std::string_view::npos ? std::string_view{} : headers.substr(end + kLineEnd.size());
+
+        const auto colon = line.find(':');
+        if (colon == std::string_view::npos)
+        {
+            continue;
+        }
+        const auto header = lowercase(trim(line.substr(0, colon)));
+        const auto value = trim(line.substr(colon + 1));
+        if (header == "content-disposition")
+        {
+            name = header_param(value, "name");
+            info.filename = header_param(value, "filename").value_or("");
+        }
+        else if (header == "content-type")
+        {
+            info.content_type = std::string{value};
+        }
+    }
+
+    if (!name || name->empty())
+    {
+        return std::unexpected(malformed("multipart part without a name"));
+    }
+
+    in_file_ = *name == "file";
+    if (!in_file_)
+    {
+        field_name_ = std::move(*name);
+        fields_[field_name_].clear();
+        return {};
+    }
+
+    if (file_path_)
+    {
+        return std::unexpected(malformed("only one file part is allowed"));
+    }
+    auto path = open_file_(info);
+    if (!path)
+    {
+        return std::unexpected(path.error());
+    }
+    file_path_ = std::move(*path);
+    file_.open(*file_path_, std::ios::binary | std::ios::trunc);
+    if (!file_)
+    {
+        return std::unexpected(upload_error{upload_error::kind::io, "failed to save upload"});
+    }
+    return {};
+}
+
+std::expected<void, upload_error> multipart_upload::emit(std::string_view bytes)
+{
+    if (bytes.empty())
+    {
+        return {};
+    }
+
+    if (!in_file_)
+    {
+        auto& value = fields_[field_name_];
+        if (value.size() + bytes.size() > max_field_bytes_)
+        {
+            return std::unexpected(upload_error{upload_error::kind::too_large, field_name_ + " part too large"});
+        }
+        value.append(bytes);
+        return {};
+    }
+
+    if (file_bytes_ + bytes.size() > max_file_bytes_)
+    {
+        return std::unexpected(upload_error{upload_error::kind::too_large, "file too large"});
+    }
+    const auto head = std::min(bytes.size(), head_.size() - head_bytes_);
+    std::copy_n(bytes.data(), head, head_.data() + head_bytes_);
+    head_bytes_ += head;
+
+    file_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file_)
+    {
+        return std::unexpected(upload_error{upload_error::kind::io, "failed to save upload"});
+    }
+    file_bytes_ += bytes.size();
+    return {};
+}
+
+std::expected<void, upload_error> multipart_upload::end_part()
+{
+    if (in_file_)
+    {
+        in_file_ = false;
+        if (!file_.flush())
+        {
+            return std::unexpected(upload_error{upload_error::kind::io, "failed to save upload"});
+        }
+    }
+    return {};
+}
+
+} // namespace stemsmith::http
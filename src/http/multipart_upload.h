@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace stemsmith::http
+{
+
+struct upload_error
+{
+    enum class kind
+    {
+        malformed, // not a well-formed multipart body, or a rejected part
+        too_large, // the file part exceeds its cap
+        io,        // the upload could not be written
+    };
+
+    kind reason{kind::malformed};
+    std::string message;
+};
+
+/**
+ * @brief Incremental multipart/form-data reader that streams the `file` part straight to disk.
+ *
+ * The body is fed in slices of any size. Between slices only a tail as long as the boundary is kept,
+ * so memory does not grow with the file part; the other parts (e.g. `config`) are small and are kept
+ * in memory up to `max_field_bytes`. When the file part's headers arrive, `open_file` validates them
+ * and names the destination, so a rejected upload never touches the disk. The server feeds it from
+ * Crow's body sink as the request is read.
+ */
+class multipart_upload
+{
+public:
+    struct file_info
+    {
+        std::string filename;
+        std::string content_type;
+    };
+
+    using file_opener = std::function<std::expected<std::filesystem::path, upload_error>(const file_info&)>;
+
+    static constexpr std::size_t head_size = 16; // leading file bytes kept for format sniffing
+
+    multipart_upload(std::string_view boundary,
+                     file_opener open_file,
+                     std::uint64_t max_file_bytes,
+                     std::size_t max_field_bytes = 1 << 20);
+    ~multipart_upload();
+
+    multipart_upload(const multipart_upload&) = delete;
+    multipart_upload& operator=(const multipart_upload&) = delete;
+
+    // Boundary parameter of a multipart/form-data Content-Type; nullopt when absent.
+    [[nodiscard]] static std::optional<std::string> boundary_from(std::string_view content_type);
+
+    [[nodiscard]] std::expected<void, upload_error> feed(std::string_view bytes);
+    // Checks that the closing boundary was seen and flushes the file part.
+    [[nodiscard]] std::expected<void, upload_error> finish();
+    // Removes a partially or fully written file part.
+    void discard();
+
+    [[nodiscard]] const std::optional<std::filesystem::path>& file_path() const noexcept
+    {
+        return file_path_;
+    }
+    [[nodiscard]] std::uint64_t file_bytes() const noexcept
+    {
+        return file_bytes_;
+    }
+    [[nodiscard]] std::string_view file_head() const noexcept
+    {
+        return {head_.data(), head_bytes_};
+    }
+    [[nodiscard]] const std::string* field(const std::string& name) const;
+
+private:
+    enum class state
+    {
+        preamble,
+        delimiter,
+        headers,
+        body,
+        done,
+    };
+
+    [[nodiscard]] std::expected<void, upload_error> begin_part(std::string_view headers);
+    [[nodiscard]] std::expected<void, upload_error> emit(std::string_view bytes);
+    [[nodiscard]] std::expected<void, upload_error> end_part();
+
+    std::string delimiter_; // "\r\n--" + boundary; the first one in the body has no leading CRLF
+    file_opener open_file_;
+    std::uint64_t max_file_bytes_;
+    std::size_t max_field_bytes_;
+
+    state state_{state::preamble};
+    std::string pending_;
+    bool in_file_{false};
+    std::string field_name_;
+    std::unordered_map<std::string, std::string> fields_;
+
+    std::optional<std::filesystem::path> file_path_;
+    std::ofstream file_;
+    std::uint64_t file_bytes_{0};
+    std::array<char, head_size> head_{};
+    std::size_t head_bytes_{0};
+};
+
+} // namespace stemsmith::http
@@ -1,15 +1,26 @@
 #include "server.h"
 
 #include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <expected>
 #include <filesystem>
 #include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <miniz/miniz.h>
 #include <nlohmann/json.hpp>
 #include <optional>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "audio_io.h"
+#include "cpu_topology.h"
+#include "multipart_upload.h"
+
 namespace stemsmith::http
 {
 
@@ -33,16 +44,199 @@ constexpr std::string_view to_string(job_status status)
     return "unknown";
 }
 
-std::expected<std::string, std::string> make_zip(const std::filesystem::path& root)
+// Server-owned directories under the output root; job output_subdirs may not reach into them.
+constexpr std::string_view kUploadsDir = "uploads";
+constexpr std::string_view kArchivesDir = "archives";
+
+std::filesystem::path server_dir(const config& cfg, std::string_view name)
+{
+    return cfg.output_root.empty() ? std::filesystem::path("build") / name : cfg.output_root / name;
+}
+
+// True when `subdir` stays below the output root and outside the server's own directories.
+bool output_subdir_allowed(const std::filesystem::path& subdir)
+{
+    const auto normal = subdir.lexically_normal();
+    if (normal.empty() || normal.has_root_path())
+    {
+        return false;
+    }
+    std::string first = normal.begin()->string();
+    std::ranges::transform(first, first.begin(), [](unsigned char c) { return std::tolower(c); });
+    return first != ".." && first != kUploadsDir && first != kArchivesDir;
+}
+
+constexpr std::size_t kUploadSliceBytes = 64 * 1024;
+// Room for the config part (capped at 1 MiB by multipart_upload), part headers and boundaries.
+constexpr std::uint64_t kMaxFormOverheadBytes = (1 << 20) + 64 * 1024;
+
+// Declared Content-Length of a request, if present and well-formed.
+std::optional<std::uint64_t> content_length(const crow::request& req)
+{
+    const auto& header = req.get_header_value("Content-Length");
+    std::uint64_t length = 0;
+    if (header.empty() ||
+        std::from_chars(header.data(), header.data() + header.size(), length).ec != std::errc{})
+    {
+        return std::nullopt;
+    }
+    return length;
+}
+
+crow::status status_for(const upload_error& error)
+{
+    switch (error.reason)
+    {
+    case upload_error::kind::malformed:
+        return crow::status::BAD_REQUEST;
+    case upload_error::kind::too_large:
+        return crow::status::PAYLOAD_TOO_LARGE;
+    case upload_error::kind::io:
+        return crow::status::INTERNAL_SERVER_ERROR;
+    }
+    return crow::status::BAD_REQUEST;
+}
+
+// Whether a part's (lowercased) Content-Type names the uploaded container; octet-stream always passes.
+bool content_type_matches(const std::string& content_type, input_format format)
+{
+    const auto contains = [&](std::initializer_list<std::string_view> types)
+    {
+        return std::ranges::any_of(types,
+                                   [&](std::string_view type) { return content_type.find(type) != std::string::npos; });
+    };
+
+    if (contains({"application/octet-stream"}))
+    {
+        return true;
+    }
+    switch (format)
+    {
+    case input_format::wav:
+        return contains({"audio/wav", "audio/x-wav", "audio/wave", "audio/vnd.wave"});
+    case input_format::flac:
+        return contains({"audio/flac", "audio/x-flac"});
+    case input_format::mp3:
+        return contains({"audio/mpeg", "audio/mp3"});
+    case input_format::ogg:
+        return contains({"audio/ogg", "audio/opus", "application/ogg"});
+    }
+    return false;
+}
+
+// A POST /jobs body being parsed into the uploads directory. The file part is validated from its headers
+// and written as it is parsed; unless the upload ends up in a job, the file is removed with it.
+struct pending_upload
+{
+    pending_upload(std::string_view boundary,
+                   job_registry& registry,
+                   std::filesystem::path uploads_root,
+                   std::uint64_t max_file_bytes)
+        : upload(
+              boundary,
+              [this, &registry, uploads_root = std::move(uploads_root)](
+                  const multipart_upload::file_info& info) -> std::expected<std::filesystem::path, upload_error>
+              {
+                  format = input_format_for(info.filename);
+                  if (info.filename.empty() || !format)
+                  {
+                      return std::unexpected(
+                          upload_error{upload_error::kind::malformed, "WAV, FLAC, MP3, OGG or Opus input required"});
+                  }
+
+                  if (!info.content_type.empty())
+                  {
+                      std::string lowered = info.content_type;
+                      std::ranges::transform(lowered,
+                                             lowered.begin(),
+                                             [](unsigned char c) { return std::tolower(c); });
+                      if (!content_type_matches(lowered, *format))
+                      {
+                          return std::unexpected(
+                              upload_error{upload_error::kind::malformed, "content-type does not match file type"});
+                      }
+                  }
+
+                  std::error_code ec;
+                  std::filesystem::create_directories(uploads_root, ec);
+                  if (ec)
+                  {
+                      return std::unexpected(upload_error{upload_error::kind::io, "failed to prepare upload dir"});
+                  }
+
+                  // libnyquist picks its decoder by extension, so store it lowercased.
+                  job_id = registry.next_id();
+                  auto path =
+                      uploads_root / (job_id + "-" + std::filesystem::path(info.filename).filename().string());
+                  std::string extension = path.extension().string();
+                  std::ranges::transform(extension,
+                                         extension.begin(),
+                                         [](unsigned char c) { return std::tolower(c); });
+                  return path.replace_extension(extension);
+              },
+              max_file_bytes)
+    {
+    }
+
+    ~pending_upload()
+    {
+        if (!submitted)
+        {
+            upload.discard();
+        }
+    }
+
+    pending_upload(const pending_upload&) = delete;
+    pending_upload& operator=(const pending_upload&) = delete;
+
+    // After the first error the rest of the body is dropped and the partial file removed.
+    void feed(std::string_view bytes)
+    {
+        if (error)
+        {
+            return;
+        }
+        if (auto fed = upload.feed(bytes); !fed)
+        {
+            error = std::move(fed.error());
+            upload.discard();
+        }
+    }
+
+    multipart_upload upload;
+    std::string job_id;
+    std::optional<input_format> format;
+    std::optional<upload_error> error;
+    bool submitted{false}; // the file belongs to a job now
+};
+
+// Crow body sink that feeds POST /jobs bodies to their upload as they are read off the socket.
+struct upload_sink
+{
+    std::shared_ptr<pending_upload> pending;
+
+    void operator()(const char* data, std::size_t size) const
+    {
+        pending->feed({data, size});
+    }
+};
+
+// Archives every file under `root` into `target` at miniz `level` (0 stores entries uncompressed). The
+// archive is written next to `target` and renamed into place, so readers never see a partial file.
+std::expected<void, std::string> make_zip(const std::filesystem::path& root,
+                                          const std::filesystem::path& target,
+                                          int level)
 {
     if (!std::filesystem::exists(root) || !std::filesystem::is_directory(root))
     {
         return std::unexpected("Output path not found");
     }
 
+    auto partial = target;
+    partial += ".part";
     mz_zip_archive zip{};
     mz_zip_zero_struct(&zip);
-    if (!mz_zip_writer_init_heap(&zip, 0, 0))
+    if (!mz_zip_writer_init_file(&zip, partial.string().c_str(), 0))
     {
         return std::unexpected("Failed to init zip writer");
     }
@@ -65,31 +259,194 @@ std::expected<std::string, std::string> make_zip(const std::filesystem::path& ro
                                     entry.path().string().c_str(),
                                     nullptr,
                                     0,
-                                    MZ_DEFAULT_COMPRESSION))
+                                    static_cast<mz_uint>(std::clamp(level, 0, 9))))
         {
             mz_zip_writer_end(&zip);
+            std::error_code ec;
+            std::filesystem::remove(partial, ec);
             return std::unexpected("Failed to add file to zip");
         }
     }
 
-    void* buffer = nullptr;
-    size_t size = 0;
-    if (!mz_zip_writer_finalize_heap_archive(&zip, &buffer, &size))
+    const bool finalized = mz_zip_writer_finalize_archive(&zip);
+    mz_zip_writer_end(&zip);
+    std::error_code ec;
+    if (!finalized)
     {
-        mz_zip_writer_end(&zip);
+        std::filesystem::remove(partial, ec);
         return std::unexpected("Failed to finalize zip archive");
     }
 
-    mz_zip_writer_end(&zip);
+    std::filesystem::rename(partial, target, ec);
+    if (ec)
+    {
+        std::filesystem::remove(partial, ec);
+        return std::unexpected("Failed to store zip archive");
+    }
+    return {};
+}
 
-    std::string out(static_cast<const char*>(buffer), size);
-    mz_free(buffer);
-    return out;
+constexpr std::uint64_t kMaxRangeBytes = 8 * 1024 * 1024;
+
+struct byte_range
+{
+    std::uint64_t first{0};
+    std::uint64_t last{0}; // inclusive
+};
+
+// Single `bytes=` range of a Range header against a `size`-byte file. nullopt means "send the whole file"
+// (no header, a syntax error or several ranges, all of which RFC 9110 lets a server ignore); an error means
+// the range cannot be satisfied.
+std::expected<std::optional<byte_range>, std::string> parse_range(std::string_view header, std::uint64_t size)
+{
+    constexpr std::string_view kUnit = "bytes=";
+    if (!header.starts_with(kUnit) || header.find(',') != std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+    header.remove_prefix(kUnit.size());
+    const auto dash = header.find('-');
+    if (dash == std::string_view::npos)
+    {
+        return std::nullopt;
+    }
+
+    const auto parse_number = [](std::string_view digits) -> std::optional<std::uint64_t>
+    {
+        std::uint64_t value = 0;
+        const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (digits.empty() || ec != std::errc{} || end != digits.data() + digits.size())
+        {
+            return std::nullopt;
+        }
+        return value;
+    };
+
+    const auto first = header.substr(0, dash);
+    const auto last = header.substr(dash + 1);
+    byte_range range;
+    if (first.empty())
+    {
+        // Suffix range: the final N bytes.
+        const auto suffix = parse_number(last);
+        if (!suffix)
+        {
+            return std::nullopt;
+        }
+        if (*suffix == 0 || size == 0)
+        {
+            return std::unexpected("unsatisfiable range");
+        }
+        range.first = size - std::min(*suffix, size);
+        range.last = size - 1;
+    }
+    else
+    {
+        const auto start = parse_number(first);
+        const auto end = last.empty() ? std::optional{std::numeric_limits<std::uint64_t>::max()} : parse_number(last);
+        if (!start || !end || *end < *start)
+        {
+            return std::nullopt;
+        }
+        if (*start >= size)
+        {
+            return std::unexpected("unsatisfiable range");
+        }
+        range.first = *start;
+        range.last = std::min(*end, size - 1);
+    }
+
+    // Bounded so a range request never buffers more than this; clients ask again for the rest.
+    range.last = std::min(range.last, range.first + kMaxRangeBytes - 1);
+    return range;
+}
+
+// Strong validator from the stem's size and modification time; stems are never rewritten in place.
+std::string entity_tag(std::uint64_t size, std::filesystem::file_time_type modified)
+{
+    const auto ticks = static_cast<std::uint64_t>(modified.time_since_epoch().count());
+    char buffer[2 * 16 + 4] = {'"'};
+    auto* end = std::to_chars(buffer + 1, std::end(buffer), size, 16).ptr;
+    *end++ = '-';
+    end = std::to_chars(end, std::end(buffer), ticks, 16).ptr;
+    *end++ = '"';
+    return {buffer, end};
+}
+
+// Whether an If-None-Match list names `etag` (weak comparison, as RFC 9110 requires for this header).
+bool none_match_hits(std::string_view header, std::string_view etag)
+{
+    while (!header.empty())
+    {
+        const auto comma = header.find(',');
+        auto tag = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+        while (!tag.empty() && tag.front() == ' ')
+        {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && tag.back() == ' ')
+        {
+            tag.remove_suffix(1);
+        }
+        if (tag.starts_with("W/"))
+        {
+            tag.remove_prefix(2);
+        }
+        if (tag == "*" || tag == etag)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Stem file in `output_dir` called `name`, with or without its extension; nullopt for anything else.
+std::optional<std::filesystem::path> find_stem(const std::filesystem::path& output_dir, const std::string& name)
+{
+    if (name.empty() || name.front() == '.' || name.find_first_of("/\\") != std::string::npos)
+    {
+        return std::nullopt;
+    }
+
+    std::error_code ec;
+    std::optional<std::filesystem::path> match;
+    for (const auto& entry : std::filesystem::directory_iterator(output_dir, ec))
+    {
+        if (!entry.is_regular_file(ec))
+        {
+            continue;
+        }
+        if (entry.path().filename() == name)
+        {
+            return entry.path();
+        }
+        if (!match && entry.path().stem() == name)
+        {
+            match = entry.path();
+        }
+    }
+    return match;
+}
+
+std::string stem_content_type(const std::filesystem::path& path)
+{
+    const auto format = input_format_for(path);
+    if (format == input_format::wav)
+    {
+        return "audio/wav";
+    }
+    if (format == input_format::flac)
+    {
+        return "audio/flac";
+    }
+    return "application/octet-stream";
 }
 
 std::size_t compute_worker_count(const std::optional<std::size_t>& worker_count)
 {
-    const auto hw_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    // The cpuset and cgroup quota, not the host's CPU count: containers usually get a fraction of it.
+    const auto hw_threads = system_cpu_topology().usable_threads();
     const auto default_workers = std::max<std::size_t>(std::size_t{1}, hw_threads / 2);
     const auto desired = worker_count ? *worker_count : default_workers;
     return std::clamp(desired, std::size_t{1}, hw_threads);
@@ -103,12 +460,27 @@ std::string job_registry::next_id()
 
 void job_registry::add(const std::string& id, job_handle handle, std::filesystem::path upload_path)
 {
-    std::lock_guard lock(mutex_);
     job_state state;
     state.last_event.id = handle.id();
     state.last_event.status = job_status::queued;
+
+    // Jobs served from the result cache finish inside submit, before they could be registered.
+    if (const auto future = handle.result();
+        future.valid() && future.wait_for(std::chrono::seconds{0}) == std::future_status::ready)
+    {
+        const auto& result = future.get();
+        state.last_event.status = result.status;
+        state.last_event.progress = 1.0f;
+        state.last_event.error = result.error;
+        state.output_dir = result.output_dir;
+        std::error_code ec;
+        std::filesystem::remove(upload_path, ec);
+        upload_path.clear();
+    }
+
     state.handle = std::move(handle);
     state.upload_path = std::move(upload_path);
+    std::lock_guard lock(mutex_);
     jobs_.emplace(id, std::move(state));
 }
 
@@ -149,7 +521,132 @@ std::optional<job_state> job_registry::get(const std::string& id) const
     return std::nullopt;
 }
 
-server::server(config cfg) : config_(std::move(cfg)) {}
+archive_store::archive_store(std::filesystem::path root, int zip_level, std::uint64_t max_bytes)
+    : root_(std::move(root))
+    , zip_level_(zip_level)
+    , max_bytes_(max_bytes)
+{
+}
+
+archive_store::~archive_store()
+{
+    std::error_code ec;
+    for (const auto& [id, entry] : slots_)
+    {
+        if (!entry->path.empty())
+        {
+            std::filesystem::remove(entry->path, ec);
+        }
+    }
+    std::filesystem::remove(root_, ec); // only if nothing else lives there
+}
+
+std::expected<std::filesystem::path, std::string> archive_store::get(const std::string& id,
+                                                                     const std::filesystem::path& output_dir)
+{
+    std::shared_ptr<slot> entry;
+    {
+        std::lock_guard lock(mutex_);
+        auto& current = slots_[id];
+        if (!current)
+        {
+            current = std::make_shared<slot>();
+        }
+        current->last_use = ++clock_;
+        entry = current;
+    }
+
+    // Serialised per job so concurrent first downloads build its archive once without blocking other jobs.
+    std::lock_guard build(entry->build_mutex);
+    {
+        std::lock_guard lock(mutex_);
+        if (!entry->path.empty() && std::filesystem::exists(entry->path))
+        {
+            return entry->path;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(root_, ec);
+    if (ec)
+    {
+        return std::unexpected("Failed to prepare archive dir");
+    }
+    const auto target = root_ / ("job-" + id + ".zip");
+    if (auto zipped = make_zip(output_dir, target, zip_level_); !zipped)
+    {
+        return std::unexpected(zipped.error());
+    }
+    const auto size = std::filesystem::file_size(target, ec);
+
+    std::lock_guard lock(mutex_);
+    slots_[id] = entry; // re-registers the slot if it was evicted while building
+    bytes_ -= entry->bytes;
+    entry->path = target;
+    entry->bytes = ec ? 0 : size;
+    bytes_ += entry->bytes;
+    evict_over_budget(id);
+    return target;
+}
+
+void archive_store::evict(const std::string& id)
+{
+    std::lock_guard lock(mutex_);
+    drop(id);
+}
+
+std::uint64_t archive_store::bytes() const
+{
+    std::lock_guard lock(mutex_);
+    return bytes_;
+}
+
+void archive_store::drop(const std::string& id)
+{
+    const auto it = slots_.find(id);
+    if (it == slots_.end())
+    {
+        return;
+    }
+    if (!it->second->path.empty())
+    {
+        std::error_code ec;
+        std::filesystem::remove(it->second->path, ec);
+        it->second->path.clear();
+    }
+    bytes_ -= it->second->bytes;
+    it->second->bytes = 0;
+    slots_.erase(it);
+}
+
+void archive_store::evict_over_budget(const std::string& keep)
+{
+    // The archive just built is kept even when it alone exceeds the budget; it is about to be served.
+    while (bytes_ > max_bytes_)
+    {
+        const std::string* oldest = nullptr;
+        std::uint64_t oldest_use = std::numeric_limits<std::uint64_t>::max();
+        for (const auto& [id, entry] : slots_)
+        {
+            if (id != keep && !entry->path.empty() && entry->last_use < oldest_use)
+            {
+                oldest = &id;
+                oldest_use = entry->last_use;
+            }
+        }
+        if (!oldest)
+        {
+            return;
+        }
+        drop(std::string{*oldest});
+    }
+}
+
+server::server(config cfg)
+    : config_(std::move(cfg))
+    , archives_(server_dir(config_, kArchivesDir), config_.zip_level, config_.archive_cache_bytes)
+{
+}
 
 server::~server()
 {
@@ -188,6 +685,24 @@ void server::run()
     runtime.cache.root = config_.cache_root.empty() ? "build/model_cache" : config_.cache_root;
     runtime.output_root = config_.output_root.empty() ? "build/output" : config_.output_root;
     runtime.worker_count = compute_worker_count(config_.worker_count);
+    runtime.warmup.profiles = config_.warmup_profiles;
+    runtime.warmup.sessions_per_profile = config_.warmup_sessions;
+    runtime.warmup.background = true;
+    runtime.segment_parallelism = std::max<std::size_t>(1, config_.segment_parallelism);
+    runtime.streaming = config_.streaming;
+    runtime.compute_threads = config_.compute_threads;
+    runtime.threads_per_job = config_.threads_per_job;
+    runtime.resampler = config_.resampler;
+    runtime.numa_pinning = config_.numa_pinning;
+    runtime.coalesce_jobs = config_.coalesce_jobs;
+    runtime.silence_threshold_db = config_.silence_threshold_db;
+    runtime.pipeline.decode_ahead = config_.decode_ahead;
+    runtime.pipeline.encode_threads = config_.encode_threads;
+    if (config_.result_cache_bytes > 0)
+    {
+        runtime.results.root = runtime.cache.root / "results";
+        runtime.results.max_bytes = config_.result_cache_bytes;
+    }
 
     // Use our own signal handling; Crow's default installs SIGINT/SIGTERM hooks.
     app_.signal_clear();
@@ -206,75 +721,157 @@ void server::run()
     app_.bindaddr(config_.bind_address).port(config_.port).multithreaded().run();
 }
 
-crow::response server::handle_post_job(const crow::request& req)
+crow::response server::handle_health() const
+{
+    crow::json::wvalue payload;
+    if (!svc_)
+    {
+        payload["status"] = "unavailable";
+        payload["ready"] = false;
+        return crow::response{crow::status::SERVICE_UNAVAILABLE, payload};
+    }
+
+    if (!svc_->ready())
+    {
+        // Load balancers should only route to nodes whose models are warm.
+        if (const auto error = svc_->warmup_error())
+        {
+            payload["status"] = "failed";
+            payload["error"] = *error;
+        }
+        else
+        {
+            payload["status"] = "warming";
+        }
+        payload["ready"] = false;
+        return crow::response{crow::status::SERVICE_UNAVAILABLE, payload};
+    }
+
+    payload["status"] = "ok";
+    payload["ready"] = true;
+    if (const auto results = svc_->result_cache_usage())
+    {
+        payload["result_cache"]["hits"] = results->hits;
+        payload["result_cache"]["misses"] = results->misses;
+        payload["result_cache"]["evictions"] = results->evictions;
+        payload["result_cache"]["entries"] = results->entries;
+        payload["result_cache"]["bytes"] = results->bytes;
+    }
+    return crow::response{crow::status::OK, payload};
+}
+
+std::optional<crow::response> server::check_post_job(const crow::request& req) const
 {
     if (!submit_override_ && !svc_)
     {
         return crow::response{crow::status::SERVICE_UNAVAILABLE, R"({"error":"service not ready"})"};
     }
 
-    if (const auto content_type = req.get_header_value("Content-Type");
-        content_type.find("multipart/form-data") == std::string::npos)
+    if (content_length(req).value_or(0) > config_.max_upload_bytes + kMaxFormOverheadBytes)
+    {
+        return crow::response{crow::status::PAYLOAD_TOO_LARGE, R"({"error":"file too large"})"};
+    }
+
+    const auto content_type = req.get_header_value("Content-Type");
+    if (content_type.find("multipart/form-data") == std::string::npos)
     {
         return crow::response{crow::status::BAD_REQUEST, R"({"error":"multipart/form-data required"})"};
     }
+    if (!multipart_upload::boundary_from(content_type))
+    {
+        return crow::response{crow::status::BAD_REQUEST, R"({"error":"multipart boundary required"})"};
+    }
+    return std::nullopt;
+}
 
-    crow::multipart::message msg(req);
-    auto it = msg.part_map.find("file");
-    if (it == msg.part_map.end())
+bool server::begin_post_job(crow::request& req, crow::response& res)
+{
+    if (req.method != crow::HTTPMethod::Post || req.url != "/jobs")
     {
-        return crow::response{crow::status::BAD_REQUEST, R"({"error":"file field required"})"};
+        return true;
     }
 
-    const auto& [headers, header_body] = it->second;
-    const auto& [_, params] = crow::multipart::get_header_object(headers, "Content-Disposition");
+    // Runs before Crow reads the body: a rejected upload is answered without reading it, and an accepted
+    // one is parsed to disk as it arrives instead of being buffered in the request.
+    if (auto rejected = check_post_job(req))
+    {
+        res = std::move(*rejected);
+        return false;
+    }
+    const auto boundary = multipart_upload::boundary_from(req.get_header_value("Content-Type"));
+    req.body_sink = upload_sink{std::make_shared<pending_upload>(
+        *boundary, registry_, server_dir(config_, kUploadsDir), config_.max_upload_bytes)};
+    return true;
+}
 
-    std::string filename;
-    if (const auto name_it = params.find("filename"); name_it != params.end())
+crow::response server::handle_post_job(const crow::request& req)
+{
+    if (auto rejected = check_post_job(req))
     {
-        filename = name_it->second;
+        return std::move(*rejected);
     }
 
-    auto ends_with = [](const std::string& value, const std::string& suffix)
+    std::shared_ptr<pending_upload> pending;
+    if (const auto* sink = req.body_sink.target<upload_sink>())
     {
-        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+        pending = sink->pending;
+    }
+    else
+    {
+        // Not routed through begin_post_job, so the body was buffered; parse it in slices.
+        if (req.body.size() > config_.max_upload_bytes + kMaxFormOverheadBytes)
+        {
+            return crow::response{crow::status::PAYLOAD_TOO_LARGE, R"({"error":"file too large"})"};
+        }
+        const auto boundary = multipart_upload::boundary_from(req.get_header_value("Content-Type"));
+        pending = std::make_shared<pending_upload>(
+            *boundary, registry_, server_dir(config_, kUploadsDir), config_.max_upload_bytes);
+        const std::string_view request_body = req.body;
+        for (std::size_t offset = 0; offset < request_body.size() && !pending->error; offset += kUploadSliceBytes)
+        {
+            pending->feed(request_body.substr(offset, kUploadSliceBytes));
+        }
+    }
+    auto& upload = pending->upload;
+
+    const auto reject = [&](crow::status status, const std::string& message)
+    {
+        upload.discard();
+        crow::json::wvalue body;
+        body["error"] = message;
+        return crow::response{status, body};
     };
 
-    if (filename.empty() || !(ends_with(filename, ".wav") || ends_with(filename, ".WAV")))
+    if (pending->error)
+    {
+        return reject(status_for(*pending->error), pending->error->message);
+    }
+    if (const auto finished = upload.finish(); !finished)
     {
-        return crow::response{crow::status::BAD_REQUEST, R"({"error":"WAV input required"})"};
+        return reject(status_for(finished.error()), finished.error().message);
     }
 
-    if (const auto& content_type_part = crow::multipart::get_header_object(headers, "Content-Type").value;
-        !content_type_part.empty())
+    if (!upload.file_path())
     {
-        std::string lowered = content_type_part;
-        std::ranges::transform(lowered, lowered.begin(), [](unsigned char c) { return std::tolower(c); });
-        const bool is_wav =
-            lowered.find("audio/wav") != std::string::npos || lowered.find("audio/x-wav") != std::string::npos ||
-            lowered.find("audio/wave") != std::string::npos || lowered.find("audio/vnd.wave") != std::string::npos;
-        if (const bool is_octet_stream = lowered.find("application/octet-stream") != std::string::npos;
-            !is_wav && !is_octet_stream)
-        {
-            return crow::response{crow::status::BAD_REQUEST, R"({"error":"WAV content-type required"})"};
-        }
+        return reject(crow::status::BAD_REQUEST, "file field required");
     }
 
-    if (constexpr std::size_t kMaxUploadBytes = 100 * 1024 * 1024; header_body.size() > kMaxUploadBytes)
+    // Checked up front so a mislabelled upload fails here instead of in the job's decode stage.
+    const auto head = upload.file_head();
+    if (sniff_input_format({reinterpret_cast<const unsigned char*>(head.data()), head.size()}) != pending->format)
     {
-        return crow::response{crow::status::PAYLOAD_TOO_LARGE, R"({"error":"file too large"})"};
+        return reject(crow::status::BAD_REQUEST, "file content does not match file type");
     }
+    const auto job_id = pending->job_id;
 
     job_template template_config{};
     std::optional<std::filesystem::path> output_subdir_override{};
-    if (const auto cfg_it = msg.part_map.find("config"); cfg_it != msg.part_map.end())
+    if (const auto* config_json = upload.field("config"))
     {
-        const auto cfg_result = job_template::from_json_string(cfg_it->second.body);
+        const auto cfg_result = job_template::from_json_string(*config_json);
         if (!cfg_result)
         {
-            crow::json::wvalue body;
-            body["error"] = cfg_result.error();
-            return crow::response{crow::status::BAD_REQUEST, body};
+            return reject(crow::status::BAD_REQUEST, cfg_result.error());
         }
 
         template_config = cfg_result.value();
@@ -282,47 +879,39 @@ crow::response server::handle_post_job(const crow::request& req)
         // Optional: allow output_subdir in config JSON.
         try
         {
-            if (const auto json = nlohmann::json::parse(cfg_it->second.body); json.contains("output_subdir"))
+            if (const auto json = nlohmann::json::parse(*config_json); json.contains("output_subdir"))
             {
                 if (!json["output_subdir"].is_string())
                 {
-                    crow::json::wvalue body;
-                    body["error"] = "output_subdir must be a string";
-                    return crow::response{crow::status::BAD_REQUEST, body};
+                    return reject(crow::status::BAD_REQUEST, "output_subdir must be a string");
                 }
                 output_subdir_override = std::filesystem::path(json["output_subdir"].get<std::string>());
+                if (!output_subdir_allowed(*output_subdir_override))
+                {
+                    return reject(crow::status::BAD_REQUEST,
+                                  "output_subdir must stay inside the output root and outside uploads/ and archives/");
+                }
             }
         }
         catch (const std::exception& ex)
         {
-            crow::json::wvalue body;
-            body["error"] = std::string{"Invalid config JSON: "} + ex.what();
-            return crow::response{crow::status::BAD_REQUEST, body};
+            return reject(crow::status::BAD_REQUEST, std::string{"Invalid config JSON: "} + ex.what());
         }
     }
 
-    const auto job_id = registry_.next_id();
-    const auto uploads_root =
-        config_.output_root.empty() ? std::filesystem::path("build/uploads") : config_.output_root / "uploads";
-    std::error_code ec;
-    std::filesystem::create_directories(uploads_root, ec);
-    if (ec)
-    {
-        return crow::response{crow::status::INTERNAL_SERVER_ERROR, R"({"error":"failed to prepare upload dir"})"};
-    }
-
-    const auto target_path = uploads_root / (job_id + "-" + filename);
-    std::ofstream out(target_path, std::ios::binary);
-    out.write(header_body.data(), static_cast<std::streamsize>(header_body.size()));
-    if (!out)
-    {
-        return crow::response{crow::status::INTERNAL_SERVER_ERROR, R"({"error":"failed to save upload"})"};
-    }
+    const auto target_path = *upload.file_path();
 
     // Prepare the job request
     job_request job{};
     job.input_path = target_path;
     job.profile = template_config.profile;
+    job.quality = template_config.quality;
+    if (template_config.threads > 0)
+    {
+        job.threads = template_config.threads;
+    }
+    job.resampler = template_config.resampler;
+    job.output = template_config.output;
 
     if (!template_config.stems_filter.empty())
     {
@@ -341,13 +930,11 @@ crow::response server::handle_post_job(const crow::request& req)
                                          : (svc_ ? svc_->submit(std::move(job)) : std::unexpected("service not ready"));
     if (!handle)
     {
-        std::filesystem::remove(target_path, ec);
-        crow::json::wvalue body;
-        body["error"] = handle.error();
-        return crow::response{crow::status::BAD_REQUEST, body};
+        return reject(crow::status::BAD_REQUEST, handle.error());
     }
 
     // Store the job handle for later status queries
+    pending->submitted = true;
     registry_.add(job_id, *handle, target_path);
 
     crow::json::wvalue body;
@@ -410,7 +997,7 @@ crow::response server::handle_delete_job(const std::string& id)
     return crow::response{crow::status::ACCEPTED, R"({"status":"cancellation requested"})"};
 }
 
-crow::response server::handle_download(const std::string& id) const
+crow::response server::handle_download(const std::string& id)
 {
     const auto state = registry_.get(id);
     if (!state)
@@ -428,35 +1015,110 @@ crow::response server::handle_download(const std::string& id) const
         return crow::response{crow::status::INTERNAL_SERVER_ERROR, R"({"error":"missing output path"})"};
     }
 
-    const auto zip_result = make_zip(state->output_dir);
-    if (!zip_result)
+    if (!std::filesystem::exists(state->output_dir))
+    {
+        // The job's outputs were cleaned up, so its archive goes too.
+        archives_.evict(id);
+        return crow::response{crow::status::NOT_FOUND, R"({"error":"job output removed"})"};
+    }
+
+    const auto archive = archives_.get(id, state->output_dir);
+    if (!archive)
     {
         crow::json::wvalue body;
-        body["error"] = zip_result.error();
+        body["error"] = archive.error();
         return crow::response{crow::status::INTERNAL_SERVER_ERROR, body};
     }
 
+    // Crow streams the file from disk in small chunks, so the archive is never held in memory.
     const auto filename = "job-" + id + ".zip";
-    crow::response resp{crow::status::OK, zip_result.value()};
-    resp.set_header("Content-Type", "application/zip");
+    crow::response resp;
+    resp.set_static_file_info_unsafe(archive->string(), "application/zip");
     resp.set_header("Content-Disposition", "attachment; filename=\"" + filename + "\"");
     return resp;
 }
 
+crow::response server::handle_get_stem(const crow::request& req, const std::string& id, const std::string& name)
+{
+    const auto state = registry_.get(id);
+    if (!state)
+    {
+        return crow::response{crow::status::NOT_FOUND, R"({"error":"job not found"})"};
+    }
+
+    if (state->last_event.status != job_status::completed)
+    {
+        return crow::response{crow::status::CONFLICT, R"({"error":"job not completed"})"};
+    }
+
+    const auto path = find_stem(state->output_dir, name);
+    std::error_code size_ec;
+    std::error_code time_ec;
+    const auto size = path ? std::filesystem::file_size(*path, size_ec) : 0;
+    const auto modified = path ? std::filesystem::last_write_time(*path, time_ec) : std::filesystem::file_time_type{};
+    if (!path || size_ec || time_ec)
+    {
+        return crow::response{crow::status::NOT_FOUND, R"({"error":"stem not found"})"};
+    }
+
+    const auto etag = entity_tag(size, modified);
+    crow::response resp;
+    if (none_match_hits(req.get_header_value("If-None-Match"), etag))
+    {
+        resp.code = crow::status::NOT_MODIFIED;
+        resp.set_header("ETag", etag);
+        return resp;
+    }
+
+    // A Range is only honoured while the client's copy (If-Range) is still the current one.
+    std::expected<std::optional<byte_range>, std::string> range = std::nullopt;
+    if (const auto if_range = req.get_header_value("If-Range"); if_range.empty() || if_range == etag)
+    {
+        range = parse_range(req.get_header_value("Range"), size);
+    }
+    if (!range)
+    {
+        resp.code = crow::status::RANGE_NOT_SATISFIABLE;
+        resp.set_header("Content-Range", "bytes */" + std::to_string(size));
+        return resp;
+    }
+
+    if (!*range)
+    {
+        // Crow streams the file from disk in small chunks instead of loading it into the body.
+        resp.set_static_file_info_unsafe(path->string(), stem_content_type(*path));
+    }
+    else
+    {
+        const auto [first, last] = **range;
+        resp.body.resize(static_cast<std::size_t>(last - first + 1));
+        std::ifstream in(*path, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(first));
+        if (!in.read(resp.body.data(), static_cast<std::streamsize>(resp.body.size())))
+        {
+            return crow::response{crow::status::INTERNAL_SERVER_ERROR, R"({"error":"failed to read stem"})"};
+        }
+        resp.code = crow::status::PARTIAL_CONTENT;
+        resp.set_header("Content-Type", stem_content_type(*path));
+        resp.set_header("Content-Range",
+                        "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" + std::to_string(size));
+    }
+    resp.set_header("ETag", etag);
+    resp.set_header("Accept-Ranges", "bytes");
+    return resp;
+}
+
 void server::register_routes()
 {
     auto& cors = app_.get_middleware<crow::CORSHandler>().global();
     cors.origin("*")
         .methods(crow::HTTPMethod::GET, crow::HTTPMethod::POST, crow::HTTPMethod::OPTIONS, crow::HTTPMethod::DELETE)
-        .headers("Content-Type");
+        .headers("Content-Type", "Range", "If-None-Match", "If-Range")
+        .expose("Content-Range", "Accept-Ranges", "ETag");
 
-    CROW_ROUTE(app_, "/health")(
-        []
-        {
-            crow::json::wvalue payload;
-            payload["status"] = "ok";
-            return crow::response{crow::status::OK, payload};
-        });
+    app_.headers_handler([this](crow::request& req, crow::response& res) { return begin_post_job(req, res); });
+
+    CROW_ROUTE(app_, "/health")([&] { return handle_health(); });
 
     CROW_ROUTE(app_, "/")(
         []
@@ -485,6 +1147,9 @@ void server::register_routes()
         .methods(crow::HTTPMethod::DELETE)([&](const std::string& job_id) { return handle_delete_job(job_id); });
 
     CROW_ROUTE(app_, "/jobs/<string>/download")([&](const std::string& job_id) { return handle_download(job_id); });
+    CROW_ROUTE(app_, "/jobs/<string>/stems/<string>")(
+        [&](const crow::request& request, const std::string& job_id, const std::string& stem)
+        { return handle_get_stem(request, job_id, stem); });
 }
 
 } // namespace stemsmith::http
@@ -6,12 +6,16 @@
 #include <functional>
 #include <crow/include/crow_all.h>
 // clang-format on
+#include <cstdint>
+#include <expected>
 #include <filesystem>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "stemsmith/job_result.h"
 #include "stemsmith/service.h"
@@ -26,6 +30,22 @@ struct config
     std::filesystem::path cache_root{};
     std::filesystem::path output_root{};
     std::optional<size_t> worker_count{std::nullopt};
+    std::vector<model_profile_id> warmup_profiles{}; // preloaded in the background, gates /health readiness
+    std::size_t warmup_sessions{0};                  // 0 -> one session per worker
+    std::size_t segment_parallelism{1};              // >1 runs segments of long tracks on parallel sessions
+    bool streaming{false};         // bounded-memory, segment-by-segment separation
+    std::size_t compute_threads{0}; // shared inference thread budget; 0 -> HW threads
+    std::size_t threads_per_job{0}; // default per-job budget; 0 -> fair share
+    resample_quality resampler{resample_quality::best}; // default tier for non-44.1 kHz uploads
+    bool numa_pinning{false};       // pin jobs to NUMA nodes, one weight copy per node
+    std::uint64_t result_cache_bytes{0}; // finished stems kept under <cache_root>/results; 0 -> off
+    double silence_threshold_db{0.0};    // silent segments skip inference; 0 -> off
+    std::size_t decode_ahead{0};         // extra job threads decoding while inference is busy
+    std::size_t encode_threads{0};       // stem writers shared by all jobs; 0 -> job thread writes
+    std::uint64_t max_upload_bytes{100 * 1024 * 1024}; // file part of POST /jobs, written to disk as it arrives
+    bool coalesce_jobs{false};           // attach identical uploads to a queued or running job
+    int zip_level{0};                    // download archives: 0 stores stems as-is, 1-9 deflate
+    std::uint64_t archive_cache_bytes{1024ULL * 1024 * 1024}; // download archives kept on disk, LRU beyond
 };
 
 struct job_state
@@ -51,6 +71,50 @@ private:
     std::atomic<std::uint64_t> next_id_{1};
 };
 
+/**
+ * @brief Download archives built by this server, reused across downloads of a job.
+ *
+ * Each job's archive is built once under its own lock, so first downloads of different jobs never
+ * wait on each other. Archives beyond `max_bytes` are evicted least recently used first, and the
+ * store removes the archives it built when it is destroyed; other files under `root` are left alone.
+ */
+class archive_store
+{
+public:
+    archive_store(std::filesystem::path root, int zip_level, std::uint64_t max_bytes);
+    ~archive_store();
+
+    archive_store(const archive_store&) = delete;
+    archive_store& operator=(const archive_store&) = delete;
+
+    // The archive of job `id`'s `output_dir`, built on first use.
+    [[nodiscard]] std::expected<std::filesystem::path, std::string> get(const std::string& id,
+                                                                        const std::filesystem::path& output_dir);
+    // Removes job `id`'s archive, e.g. once its outputs are gone.
+    void evict(const std::string& id);
+    [[nodiscard]] std::uint64_t bytes() const;
+
+private:
+    struct slot
+    {
+        std::mutex build_mutex;     // held while the archive is built
+        std::filesystem::path path; // empty until built; guarded by archive_store::mutex_
+        std::uint64_t bytes{0};
+        std::uint64_t last_use{0};
+    };
+
+    void drop(const std::string& id); // caller holds mutex_
+    void evict_over_budget(const std::string& keep);
+
+    std::filesystem::path root_;
+    int zip_level_;
+    std::uint64_t max_bytes_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<slot>> slots_;
+    std::uint64_t bytes_{0};
+    std::uint64_t clock_{0};
+};
+
 /**
  * @brief HTTP server for StemSmith job submission and status querying.
  */
@@ -71,14 +135,19 @@ public:
 private:
     void run();
     void register_routes();
+    crow::response handle_health() const;
+    [[nodiscard]] std::optional<crow::response> check_post_job(const crow::request& req) const;
+    bool begin_post_job(crow::request& req, crow::response& res);
     crow::response handle_post_job(const crow::request& req);
     crow::response handle_get_job(const std::string& id) const;
     crow::response handle_delete_job(const std::string& id);
-    crow::response handle_download(const std::string& id) const;
+    crow::response handle_download(const std::string& id);
+    crow::response handle_get_stem(const crow::request& req, const std::string& id, const std::string& name);
 
     config config_{};
     std::unique_ptr<service> svc_;
     job_registry registry_;
+    archive_store archives_;
     crow::App<crow::CORSHandler> app_;
     std::thread thread_;
     std::atomic<bool> running_{false};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <csignal>
@@ -10,17 +11,36 @@
 #include <thread>
 #include <vector>
 
+#include "cpu_topology.h"
 #include "server.h"
 
 namespace
 {
+constexpr std::size_t kDefaultEncodeThreads = 6; // one per stem of the largest model
+
 struct options
 {
     std::string bind_address{"0.0.0.0"};
     std::uint16_t port{8345};
     std::filesystem::path cache_root{};
     std::filesystem::path output_root{};
-    std::size_t workers{std::thread::hardware_concurrency()};
+    std::size_t workers{stemsmith::system_cpu_topology().usable_threads()};
+    std::vector<stemsmith::model_profile_id> warmup_profiles{};
+    std::size_t warmup_sessions{0};
+    std::size_t segment_parallelism{1};
+    bool streaming{false};
+    std::size_t compute_threads{0};
+    std::size_t threads_per_job{0};
+    stemsmith::resample_quality resampler{stemsmith::resample_quality::best};
+    bool numa_pinning{false};
+    bool coalesce_jobs{false};
+    std::size_t result_cache_mb{0};
+    double silence_threshold_db{0.0};
+    std::size_t decode_ahead{0};
+    std::size_t encode_threads{kDefaultEncodeThreads};
+    std::size_t max_upload_mb{stemsmith::http::config{}.max_upload_bytes >> 20};
+    int zip_level{stemsmith::http::config{}.zip_level};
+    std::size_t archive_cache_mb{stemsmith::http::config{}.archive_cache_bytes >> 20};
     bool help{false};
 };
 
@@ -40,9 +60,64 @@ std::filesystem::path default_root()
 void print_usage(const char* argv0)
 {
     std::cout << "Usage: " << argv0 << " [--bind-address ADDR] [--port PORT] [--cache-root PATH] [--output-root PATH]\n"
-              << "             [--workers N]\n\n"
-              << "Defaults: bind 0.0.0.0, port 8345, paths under $HOME/.stemsmith (or $STEMSMITH_HOME), workers = HW "
-                 "threads.\n";
+              << "             [--workers N] [--warmup PROFILE[,PROFILE...]] [--warmup-sessions N]\n"
+              << "             [--segment-parallelism N] [--streaming]\n"
+              << "             [--compute-threads N] [--threads-per-job N] [--numa-pin] [--result-cache-mb MB]\n"
+              << "             [--silence-threshold-db DB] [--decode-ahead N] [--encode-threads N]\n"
+              << "             [--resampler best|medium|fast] [--max-upload-mb MB] [--zip-level 0-9]\n"
+              << "             [--archive-cache-mb MB] [--coalesce]\n\n"
+              << "Defaults: bind 0.0.0.0, port 8345, paths under $HOME/.stemsmith (or $STEMSMITH_HOME), workers = "
+                 "usable CPUs.\n"
+              << "--warmup preloads the given model profiles (e.g. balanced-six-stem); /health reports 503 until they "
+                 "are loaded.\n"
+              << "--segment-parallelism splits long tracks into overlapping segments separated on up to N sessions "
+                 "(default 1).\n"
+              << "--streaming separates segment by segment so memory stays flat for hour-long inputs.\n"
+              << "--compute-threads caps the threads all jobs share for inference (default: usable CPUs); each running "
+                 "job gets an equal share.\n"
+              << "--threads-per-job gives every job N compute threads unless its config sets \"threads\".\n"
+              << "--numa-pin pins jobs and compute threads to NUMA nodes and keeps one weight copy per node.\n"
+              << "Thread defaults follow the container's cpuset and cgroup cpu.max quota.\n"
+              << "--result-cache-mb keeps up to MB of finished stems under <cache-root>/results so resubmitted audio "
+                 "completes without separating again (default 0, off).\n"
+              << "--silence-threshold-db skips inference for segments quieter than DB dBFS (e.g. -60) and writes "
+                 "silence for them (default 0, off).\n"
+              << "--decode-ahead runs N extra job threads that decode queued inputs while all workers are separating; "
+                 "--workers still bounds concurrent inference.\n"
+              << "--encode-threads writes stems on a shared pool of N threads after a job leaves inference (default 6, "
+                 "0 writes them one after another on the job thread).\n"
+              << "--resampler picks how non-44.1 kHz uploads are resampled unless a job sets \"resampler\": best "
+                 "(default, libsamplerate), medium or fast (polyphase for 48/96 kHz, much quicker).\n"
+              << "--max-upload-mb caps the audio file of POST /jobs (default 100); uploads are written to disk as they "
+                 "arrive, and a larger Content-Length is refused before the body is read.\n"
+              << "--zip-level compresses download archives with deflate level 1-9 (default 0 stores the stems as-is; "
+                 "audio barely compresses). Each job's archive is built once and reused.\n"
+              << "--archive-cache-mb keeps up to MB of download archives on disk (default 1024); the least recently "
+                 "downloaded are removed beyond that and rebuilt on demand.\n"
+              << "--coalesce attaches an upload to a queued or running job with identical audio and settings instead "
+                 "of separating it again; each upload is hashed in the request handler (default off).\n";
+}
+
+std::optional<std::vector<stemsmith::model_profile_id>> parse_profiles(std::string_view value)
+{
+    std::vector<stemsmith::model_profile_id> profiles;
+    while (!value.empty())
+    {
+        const auto comma = value.find(',');
+        const auto key = value.substr(0, comma);
+        if (!key.empty())
+        {
+            const auto profile = stemsmith::lookup_profile(key);
+            if (!profile)
+            {
+                std::cerr << "Unknown model profile: " << key << "\n";
+                return std::nullopt;
+            }
+            profiles.push_back(profile->id);
+        }
+        value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+    }
+    return profiles;
 }
 
 std::optional<options> parse_args(int argc, char* argv[])
@@ -193,6 +268,395 @@ std::optional<options> parse_args(int argc, char* argv[])
             continue;
         }
 
+        if (auto v = parse_value(arg, "--warmup-sessions"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --warmup-sessions\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.warmup_sessions = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid warmup-sessions value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (arg == "--coalesce")
+        {
+            opts.coalesce_jobs = true;
+            continue;
+        }
+
+        if (arg == "--numa-pin")
+        {
+            opts.numa_pinning = true;
+            continue;
+        }
+
+        if (arg == "--streaming")
+        {
+            opts.streaming = true;
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--threads-per-job"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --threads-per-job\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.threads_per_job = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid threads-per-job value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--decode-ahead"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --decode-ahead\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.decode_ahead = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid decode-ahead value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--zip-level"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --zip-level\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                const auto parsed = std::stoi(value);
+                if (parsed < 0 || parsed > 9)
+                {
+                    std::cerr << "Zip level must be between 0 and 9\n";
+                    return std::nullopt;
+                }
+                opts.zip_level = parsed;
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid zip-level value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--max-upload-mb"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --max-upload-mb\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.max_upload_mb = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid max-upload-mb value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--archive-cache-mb"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --archive-cache-mb\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.archive_cache_mb = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid archive-cache-mb value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--encode-threads"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --encode-threads\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.encode_threads = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid encode-threads value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--silence-threshold-db"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --silence-threshold-db\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.silence_threshold_db = std::stod(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid silence-threshold-db value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            if (opts.silence_threshold_db > 0.0)
+            {
+                std::cerr << "silence-threshold-db must be negative (dBFS) or 0 to disable\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--result-cache-mb"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --result-cache-mb\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.result_cache_mb = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid result-cache-mb value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--compute-threads"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --compute-threads\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                opts.compute_threads = std::stoul(value);
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid compute-threads value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--segment-parallelism"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --segment-parallelism\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            try
+            {
+                const auto parsed = std::stoul(value);
+                opts.segment_parallelism = parsed == 0 ? opts.segment_parallelism : parsed;
+            }
+            catch (const std::exception& ex)
+            {
+                std::cerr << "Invalid segment-parallelism value: " << ex.what() << "\n";
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--resampler"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --resampler\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            const auto resampler = stemsmith::lookup_resample_quality(value);
+            if (!resampler)
+            {
+                std::cerr << "Unknown resampler: " << value << " (expected best, medium or fast)\n";
+                return std::nullopt;
+            }
+            opts.resampler = *resampler;
+            continue;
+        }
+
+        if (auto v = parse_value(arg, "--warmup"))
+        {
+            std::string value;
+            if (v->empty())
+            {
+                if (i + 1 >= argc)
+                {
+                    std::cerr << "Missing value for --warmup\n";
+                    return std::nullopt;
+                }
+                value = argv[++i];
+            }
+            else
+            {
+                value = std::string{*v};
+            }
+            auto profiles = parse_profiles(value);
+            if (!profiles)
+            {
+                return std::nullopt;
+            }
+            opts.warmup_profiles = std::move(*profiles);
+            continue;
+        }
+
         std::cerr << "Unknown argument: " << arg << "\n";
         return std::nullopt;
     }
@@ -246,15 +710,91 @@ int main(int argc, char* argv[])
     cfg.cache_root = parsed->cache_root;
     cfg.output_root = parsed->output_root;
     cfg.worker_count = parsed->workers;
+    cfg.warmup_profiles = parsed->warmup_profiles;
+    cfg.warmup_sessions = parsed->warmup_sessions;
+    cfg.segment_parallelism = parsed->segment_parallelism;
+    cfg.streaming = parsed->streaming;
+    cfg.compute_threads = parsed->compute_threads;
+    cfg.threads_per_job = parsed->threads_per_job;
+    cfg.numa_pinning = parsed->numa_pinning;
+    cfg.coalesce_jobs = parsed->coalesce_jobs;
+    cfg.resampler = parsed->resampler;
+    cfg.result_cache_bytes = std::uint64_t{parsed->result_cache_mb} << 20;
+    cfg.silence_threshold_db = parsed->silence_threshold_db;
+    cfg.decode_ahead = parsed->decode_ahead;
+    cfg.encode_threads = parsed->encode_threads;
+    cfg.max_upload_bytes = std::uint64_t{parsed->max_upload_mb} << 20;
+    cfg.zip_level = parsed->zip_level;
+    cfg.archive_cache_bytes = std::uint64_t{parsed->archive_cache_mb} << 20;
 
     stemsmith::http::server srv(cfg);
     srv.start();
 
-    const auto workers = cfg.worker_count.has_value() ? *cfg.worker_count : std::thread::hardware_concurrency();
+    const auto& topology = stemsmith::system_cpu_topology();
+    const auto workers = cfg.worker_count.value_or(topology.usable_threads());
     std::cout << "stemsmithd listening on " << cfg.bind_address << ":" << cfg.port << "\n";
     std::cout << "cache_root=" << cfg.cache_root << "\n";
     std::cout << "output_root=" << cfg.output_root << "\n";
     std::cout << "workers=" << workers << "\n";
+    if (cfg.compute_threads > 0)
+    {
+        std::cout << "compute_threads=" << cfg.compute_threads << "\n";
+    }
+    std::cout << "usable_cpus=" << topology.usable_threads()
+              << " numa_nodes=" << std::max<std::size_t>(1, topology.nodes.size());
+    if (topology.cpu_quota)
+    {
+        std::cout << " cpu_quota=" << *topology.cpu_quota;
+    }
+    std::cout << (cfg.numa_pinning ? " numa_pinning=on" : "") << "\n";
+    if (cfg.threads_per_job > 0)
+    {
+        std::cout << "threads_per_job=" << cfg.threads_per_job << "\n";
+    }
+    if (cfg.resampler != stemsmith::resample_quality::best)
+    {
+        std::cout << "resampler=" << stemsmith::resample_quality_key(cfg.resampler) << "\n";
+    }
+    if (cfg.silence_threshold_db < 0.0)
+    {
+        std::cout << "silence_threshold_db=" << cfg.silence_threshold_db << "\n";
+    }
+    if (cfg.decode_ahead > 0 || cfg.encode_threads != kDefaultEncodeThreads)
+    {
+        std::cout << "decode_ahead=" << cfg.decode_ahead << " encode_threads=" << cfg.encode_threads << "\n";
+    }
+    if (cfg.max_upload_bytes != stemsmith::http::config{}.max_upload_bytes)
+    {
+        std::cout << "max_upload_mb=" << parsed->max_upload_mb << "\n";
+    }
+    if (cfg.zip_level > 0)
+    {
+        std::cout << "zip_level=" << cfg.zip_level << "\n";
+    }
+    if (cfg.archive_cache_bytes != stemsmith::http::config{}.archive_cache_bytes)
+    {
+        std::cout << "archive_cache_mb=" << parsed->archive_cache_mb << "\n";
+    }
+    if (cfg.result_cache_bytes > 0)
+    {
+        std::cout << "result_cache_mb=" << parsed->result_cache_mb << "\n";
+    }
+    if (cfg.segment_parallelism > 1)
+    {
+        std::cout << "segment_parallelism=" << cfg.segment_parallelism << "\n";
+    }
+    if (cfg.streaming)
+    {
+        std::cout << "streaming=on\n";
+    }
+    if (cfg.coalesce_jobs)
+    {
+        std::cout << "coalesce_jobs=on\n";
+    }
+    if (!cfg.warmup_profiles.empty())
+    {
+        std::cout << "warmup_profiles=" << cfg.warmup_profiles.size() << " (/health reports ready once loaded)\n";
+    }
     std::cout << "Press Ctrl+C to stop\n";
 
     std::signal(SIGINT, signal_handler);
@@ -0,0 +1,114 @@
+#include "inference_batcher.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace stemsmith
+{
+
+inference_batcher::inference_batcher(options opts) : options_(opts)
+{
+    options_.max_batch_size = std::max<std::size_t>(1, options_.max_batch_size);
+}
+
+std::expected<separation_result, std::string> inference_batcher::separate(model_session_pool& pool,
+                                                                          model_profile_id profile,
+                                                                          const audio_buffer& input,
+                                                                          std::span<const std::string_view> stems,
+                                                                          demucscpp::ProgressCallback progress_cb)
+{
+    pending item;
+    item.entry.input = &input;
+    item.entry.stems = stems;
+    item.entry.progress_cb = std::move(progress_cb);
+
+    std::unique_lock lock(mutex_);
+    auto& queue = queues_[profile];
+    queue.waiting.push_back(&item);
+    cv_.notify_all();
+
+    while (!item.done)
+    {
+        if (!item.claimed && !queue.gathering)
+        {
+            lead_batch(lock, pool, profile, queue);
+            continue;
+        }
+        cv_.wait(lock);
+    }
+    lock.unlock();
+
+    if (item.entry.error)
+    {
+        std::rethrow_exception(item.entry.error);
+    }
+    return std::move(item.entry.result);
+}
+
+void inference_batcher::lead_batch(std::unique_lock<std::mutex>& lock,
+                                   model_session_pool& pool,
+                                   model_profile_id profile,
+                                   profile_queue& queue)
+{
+    queue.gathering = true;
+    const auto deadline = std::chrono::steady_clock::now() + options_.max_wait;
+    cv_.wait_until(lock, deadline, [&] { return queue.waiting.size() >= options_.max_batch_size; });
+
+    const auto count = std::min(queue.waiting.size(), options_.max_batch_size);
+    std::vector<pending*> members(queue.waiting.begin(), queue.waiting.begin() + static_cast<std::ptrdiff_t>(count));
+    queue.waiting.erase(queue.waiting.begin(), queue.waiting.begin() + static_cast<std::ptrdiff_t>(count));
+    for (auto* member : members)
+    {
+        member->claimed = true;
+    }
+    // Let the next batch gather while this one runs on its own session.
+    queue.gathering = false;
+    cv_.notify_all();
+    lock.unlock();
+
+    // Entries are moved into a contiguous span for the session and moved back afterwards.
+    std::vector<batch_entry> entries;
+    entries.reserve(members.size());
+    for (auto* member : members)
+    {
+        entries.push_back(std::move(member->entry));
+    }
+
+    if (auto session = pool.acquire(profile); session)
+    {
+        session->get()->separate_batch(entries);
+    }
+    else
+    {
+        for (auto& entry : entries)
+        {
+            entry.result = std::unexpected(session.error());
+        }
+    }
+
+    lock.lock();
+    for (std::size_t i = 0; i < members.size(); ++i)
+    {
+        members[i]->entry = std::move(entries[i]);
+        members[i]->done = true;
+    }
+    ++batch_count_;
+    batched_entries_ += members.size();
+    cv_.notify_all();
+}
+
+std::size_t inference_batcher::batch_count() const
+{
+    std::lock_guard lock(mutex_);
+    return batch_count_;
+}
+
+std::size_t inference_batcher::batched_entries() const
+{
+    std::lock_guard lock(mutex_);
+    return batched_entries_;
+}
+
+} // namespace stemsmith
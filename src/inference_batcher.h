@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <expected>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "model_session.h"
+#include "model_session_pool.h"
+#include "stemsmith/job_config.h"
+
+namespace stemsmith
+{
+
+/**
+ * @brief Coalesces concurrent separate calls of the same profile into batched forward passes.
+ *
+ * Callers block in separate(). A caller whose entry is still waiting becomes the batch leader. It
+ * waits up to `max_wait` for up to `max_batch_size` entries, runs them through its own pooled session
+ * and hands the results back to the waiting callers. Only one leader per profile gathers at a time,
+ * but once it has taken its batch the next one can gather, so batches of one profile run
+ * concurrently on separate sessions. Segments of one long job and jobs on different workers share
+ * batches the same way.
+ */
+class inference_batcher
+{
+public:
+    struct options
+    {
+        std::size_t max_batch_size{1};
+        std::chrono::milliseconds max_wait{5};
+    };
+
+    explicit inference_batcher(options opts);
+
+    inference_batcher(const inference_batcher&) = delete;
+    inference_batcher& operator=(const inference_batcher&) = delete;
+
+    [[nodiscard]] std::expected<separation_result, std::string> separate(model_session_pool& pool,
+                                                                         model_profile_id profile,
+                                                                         const audio_buffer& input,
+                                                                         std::span<const std::string_view> stems,
+                                                                         demucscpp::ProgressCallback progress_cb);
+
+    [[nodiscard]] std::size_t batch_count() const;
+    [[nodiscard]] std::size_t batched_entries() const;
+
+private:
+    struct pending
+    {
+        batch_entry entry;
+        bool claimed{false};
+        bool done{false};
+    };
+
+    struct profile_queue
+    {
+        std::deque<pending*> waiting;
+        bool gathering{false}; // a leader is waiting for its batch to fill
+    };
+
+    void lead_batch(std::unique_lock<std::mutex>& lock,
+                    model_session_pool& pool,
+                    model_profile_id profile,
+                    profile_queue& queue);
+
+    options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<model_profile_id, profile_queue> queues_;
+    std::size_t batch_count_{0};
+    std::size_t batched_entries_{0};
+};
+
+} // namespace stemsmith
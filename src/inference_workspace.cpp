@@ -0,0 +1,105 @@
+#include "inference_workspace.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace stemsmith
+{
+
+namespace
+{
+// Enough for every stem of a six-stem model plus the shifted passes of one segment.
+constexpr std::size_t kMaxPooledBuffers = 16;
+
+std::size_t bytes_of(const std::vector<float>& samples) noexcept
+{
+    return samples.capacity() * sizeof(float);
+}
+} // namespace
+
+inference_workspace::inference_workspace(std::size_t max_pooled_bytes) : max_pooled_bytes_(max_pooled_bytes) {}
+
+Eigen::MatrixXf& inference_workspace::input(Eigen::Index rows, Eigen::Index cols)
+{
+    if (input_.rows() == rows && input_.cols() == cols)
+    {
+        ++stats_.reuses;
+        return input_;
+    }
+
+    input_.resize(rows, cols);
+    ++stats_.allocations;
+    note_footprint();
+    return input_;
+}
+
+std::vector<float> inference_workspace::take(std::size_t size)
+{
+    // Best fit: the smallest pooled buffer that is large enough.
+    auto best = free_.end();
+    for (auto it = free_.begin(); it != free_.end(); ++it)
+    {
+        if (it->capacity() >= size && (best == free_.end() || it->capacity() < best->capacity()))
+        {
+            best = it;
+        }
+    }
+
+    std::vector<float> samples;
+    if (best != free_.end())
+    {
+        samples = std::move(*best);
+        free_.erase(best);
+        pooled_bytes_ -= bytes_of(samples);
+        ++stats_.reuses;
+    }
+    else
+    {
+        samples.reserve(size);
+        ++stats_.allocations;
+    }
+
+    samples.clear();
+    lent_bytes_ += bytes_of(samples);
+    note_footprint();
+    return samples;
+}
+
+void inference_workspace::give_back(std::vector<float>&& samples)
+{
+    if (samples.capacity() == 0)
+    {
+        return;
+    }
+
+    const auto bytes = bytes_of(samples);
+    lent_bytes_ -= std::min(lent_bytes_, bytes);
+    if (bytes > max_pooled_bytes_)
+    {
+        return; // a whole-track buffer; keeping it would pin that much memory on an idle session
+    }
+    while (!free_.empty() && (free_.size() == kMaxPooledBuffers || pooled_bytes_ + bytes > max_pooled_bytes_))
+    {
+        pooled_bytes_ -= bytes_of(free_.front());
+        free_.erase(free_.begin());
+    }
+    pooled_bytes_ += bytes;
+    free_.push_back(std::move(samples));
+    note_footprint();
+}
+
+void inference_workspace::trim()
+{
+    if (static_cast<std::size_t>(input_.size()) * sizeof(float) > max_pooled_bytes_)
+    {
+        input_ = Eigen::MatrixXf{};
+    }
+}
+
+void inference_workspace::note_footprint() noexcept
+{
+    const auto input_bytes = static_cast<std::size_t>(input_.size()) * sizeof(float);
+    stats_.high_water_bytes = std::max(stats_.high_water_bytes, input_bytes + pooled_bytes_ + lent_bytes_);
+}
+
+} // namespace stemsmith
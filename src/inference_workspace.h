@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <vector>
+
+namespace stemsmith
+{
+
+/**
+ * @brief Allocation counters of an inference_workspace.
+ */
+struct workspace_stats
+{
+    std::size_t high_water_bytes{}; // most bytes the workspace owned or had lent out at once
+    std::size_t allocations{};      // requests that had to grow or allocate a buffer
+    std::size_t reuses{};           // requests served from storage kept since an earlier call
+};
+
+/**
+ * @brief Scratch storage a model session reuses across segments and jobs.
+ *
+ * Holds the model input matrix and a free list of sample vectors for stem outputs. Callers hand
+ * stem buffers back once they are merged or written, so steady-state separations of equally sized
+ * segments stop touching the allocator. Pooled buffers are capped at `max_pooled_bytes`, and trim()
+ * drops an input matrix above the cap, so an idle session keeps segment-sized scratch rather than the
+ * buffers of the longest track it ever separated. Not thread-safe; a session is leased to one thread
+ * at a time.
+ */
+class inference_workspace
+{
+public:
+    // Room for the stems of one 30 s segment, shifted pass included.
+    static constexpr std::size_t default_max_pooled_bytes = std::size_t{128} << 20;
+
+    explicit inference_workspace(std::size_t max_pooled_bytes = default_max_pooled_bytes);
+
+    // Returns the input matrix resized to rows x cols; storage is only reallocated when the size changes.
+    [[nodiscard]] Eigen::MatrixXf& input(Eigen::Index rows, Eigen::Index cols);
+
+    // Hands out an empty vector with capacity for at least `size` samples.
+    [[nodiscard]] std::vector<float> take(std::size_t size);
+
+    // Returns a vector's storage to the free list; the oldest entries are dropped beyond the count and
+    // byte caps, and a buffer larger than the byte cap is freed instead.
+    void give_back(std::vector<float>&& samples);
+
+    // Frees the input matrix when it alone exceeds the byte cap; called when a session goes idle.
+    void trim();
+
+    [[nodiscard]] const workspace_stats& stats() const noexcept
+    {
+        return stats_;
+    }
+
+private:
+    void note_footprint() noexcept;
+
+    std::size_t max_pooled_bytes_;
+    Eigen::MatrixXf input_;
+    std::vector<std::vector<float>> free_;
+    std::size_t pooled_bytes_{};
+    std::size_t lent_bytes_{};
+    workspace_stats stats_;
+};
+
+} // namespace stemsmith
@@ -40,6 +40,26 @@ job_catalog::job_catalog(job_template base_config, exists_function exists_provid
 std::expected<std::size_t, std::string> job_catalog::add_file(const std::filesystem::path& path,
                                                               const job_overrides& overrides,
                                                               const std::filesystem::path& output_dir)
+{
+    auto job = describe(path, overrides, output_dir);
+    if (!job)
+    {
+        return std::unexpected(job.error());
+    }
+
+    if (seen_paths_.contains(job->input_path))
+    {
+        return std::unexpected("Input path already enqueued: " + job->input_path.string());
+    }
+
+    seen_paths_.insert(job->input_path);
+    jobs_.push_back(std::move(job).value());
+    return jobs_.size() - 1;
+}
+
+std::expected<job_descriptor, std::string> job_catalog::describe(const std::filesystem::path& path,
+                                                                 const job_overrides& overrides,
+                                                                 const std::filesystem::path& output_dir) const
 {
     if (path.empty())
     {
@@ -53,21 +73,13 @@ std::expected<std::size_t, std::string> job_catalog::add_file(const std::filesys
         return std::unexpected("Input file does not exist: " + normalized.string());
     }
 
-    if (seen_paths_.contains(normalized))
-    {
-        return std::unexpected("Input path already enqueued: " + normalized.string());
-    }
-
     auto config_result = apply_overrides(overrides);
     if (!config_result)
     {
         return std::unexpected(config_result.error());
     }
 
-    auto config = std::move(config_result).value();
-    jobs_.push_back({normalized, std::move(config), output_dir.lexically_normal()});
-    seen_paths_.insert(normalized);
-    return jobs_.size() - 1;
+    return job_descriptor{normalized, std::move(config_result).value(), output_dir.lexically_normal()};
 }
 
 std::filesystem::path job_catalog::normalize(const std::filesystem::path& path)
@@ -108,6 +120,26 @@ std::expected<job_template, std::string> job_catalog::apply_overrides(const job_
         config.stems_filter = std::move(stems);
     }
 
+    if (overrides.quality)
+    {
+        config.quality = *overrides.quality;
+    }
+
+    if (overrides.threads)
+    {
+        config.threads = *overrides.threads;
+    }
+
+    if (overrides.resampler)
+    {
+        config.resampler = *overrides.resampler;
+    }
+
+    if (overrides.output)
+    {
+        config.output = *overrides.output;
+    }
+
     return config;
 }
 
@@ -17,6 +17,10 @@ struct job_overrides
 {
     std::optional<model_profile_id> profile{};
     std::optional<std::vector<std::string>> stems_filter{};
+    std::optional<job_quality> quality{};
+    std::optional<std::size_t> threads{};
+    std::optional<resample_quality> resampler{};
+    std::optional<output_encoding> output{};
 };
 
 /**
@@ -33,6 +37,11 @@ public:
                                                      const job_overrides& overrides,
                                                      const std::filesystem::path& output_dir);
 
+    // The descriptor add_file would record for these arguments, without registering the path.
+    [[nodiscard]] std::expected<job_descriptor, std::string> describe(const std::filesystem::path& path,
+                                                                      const job_overrides& overrides,
+                                                                      const std::filesystem::path& output_dir) const;
+
     [[nodiscard]] const std::vector<job_descriptor>& jobs() const noexcept
     {
         return jobs_;
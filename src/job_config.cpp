@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <initializer_list>
@@ -106,6 +107,105 @@ std::optional<model_profile> lookup_profile(std::string_view key)
     return std::nullopt;
 }
 
+std::optional<job_quality> lookup_quality(std::string_view key)
+{
+    if (key == "draft")
+    {
+        return job_quality::draft;
+    }
+    if (key == "standard")
+    {
+        return job_quality::standard;
+    }
+    if (key == "max")
+    {
+        return job_quality::max;
+    }
+    return std::nullopt;
+}
+
+std::string_view quality_key(job_quality quality)
+{
+    switch (quality)
+    {
+    case job_quality::draft:
+        return "draft";
+    case job_quality::max:
+        return "max";
+    case job_quality::standard:
+        break;
+    }
+    return "standard";
+}
+
+std::optional<resample_quality> lookup_resample_quality(std::string_view key)
+{
+    if (key == "best")
+    {
+        return resample_quality::best;
+    }
+    if (key == "medium")
+    {
+        return resample_quality::medium;
+    }
+    if (key == "fast")
+    {
+        return resample_quality::fast;
+    }
+    return std::nullopt;
+}
+
+std::string_view resample_quality_key(resample_quality quality)
+{
+    switch (quality)
+    {
+    case resample_quality::medium:
+        return "medium";
+    case resample_quality::fast:
+        return "fast";
+    case resample_quality::best:
+        break;
+    }
+    return "best";
+}
+
+std::optional<output_format> lookup_output_format(std::string_view key)
+{
+    if (key == "wav")
+    {
+        return output_format::wav;
+    }
+    if (key == "wav16")
+    {
+        return output_format::wav_pcm16;
+    }
+    if (key == "wav24")
+    {
+        return output_format::wav_pcm24;
+    }
+    if (key == "flac")
+    {
+        return output_format::flac;
+    }
+    return std::nullopt;
+}
+
+std::string_view output_format_key(output_format format)
+{
+    switch (format)
+    {
+    case output_format::wav_pcm16:
+        return "wav16";
+    case output_format::wav_pcm24:
+        return "wav24";
+    case output_format::flac:
+        return "flac";
+    case output_format::wav:
+        break;
+    }
+    return "wav";
+}
+
 std::expected<job_template, std::string> job_template::from_file(const std::filesystem::path& path)
 {
     const auto doc_result = utils::load_json_file(path);
@@ -186,6 +286,72 @@ std::expected<job_template, std::string> job_template::from_json_string(const st
         config.stems_filter = std::move(stems);
     }
 
+    if (doc.contains("quality"))
+    {
+        if (!doc["quality"].is_string())
+        {
+            return std::unexpected("quality must be a string");
+        }
+
+        const auto key = doc["quality"].get<std::string>();
+        const auto quality = lookup_quality(key);
+        if (!quality)
+        {
+            return std::unexpected("Unknown quality: " + key);
+        }
+        config.quality = *quality;
+    }
+
+    if (doc.contains("threads"))
+    {
+        if (!doc["threads"].is_number_unsigned())
+        {
+            return std::unexpected("threads must be a non-negative integer");
+        }
+        config.threads = doc["threads"].get<std::size_t>();
+    }
+
+    if (doc.contains("resampler"))
+    {
+        if (!doc["resampler"].is_string())
+        {
+            return std::unexpected("resampler must be a string");
+        }
+
+        const auto key = doc["resampler"].get<std::string>();
+        const auto resampler = lookup_resample_quality(key);
+        if (!resampler)
+        {
+            return std::unexpected("Unknown resampler: " + key);
+        }
+        config.resampler = *resampler;
+    }
+
+    if (doc.contains("format"))
+    {
+        if (!doc["format"].is_string())
+        {
+            return std::unexpected("format must be a string");
+        }
+
+        const auto key = doc["format"].get<std::string>();
+        const auto format = lookup_output_format(key);
+        if (!format)
+        {
+            return std::unexpected("Unknown format: " + key);
+        }
+        config.output.format = *format;
+    }
+
+    if (doc.contains("flac_level"))
+    {
+        if (!doc["flac_level"].is_number_unsigned() || doc["flac_level"].get<std::uint64_t>() > max_flac_level)
+        {
+            return std::unexpected("flac_level must be an integer from 0 to 8");
+        }
+        config.output.flac_level = doc["flac_level"].get<unsigned>();
+    }
+
     return config;
 }
 
@@ -1,5 +1,6 @@
 #include "job_runner.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 namespace stemsmith
@@ -53,7 +54,9 @@ std::expected<void, std::string> job_handle::cancel(std::string reason) const
         return std::unexpected("Cancellation already requested");
     }
 
-    if (!state_->pool->cancel(state_->job_id, std::move(reason)))
+    const auto cancelled = state_->runner ? state_->runner->cancel(state_->job_id, std::move(reason))
+                                          : state_->pool->cancel(state_->job_id, std::move(reason));
+    if (!cancelled)
     {
         return std::unexpected("Job is no longer cancellable");
     }
@@ -75,21 +78,35 @@ job_runner::job_runner(model_cache& cache,
                        std::filesystem::path output_root,
                        job_template defaults,
                        std::size_t worker_count,
-                       std::function<void(const job_descriptor&, const job_event&)> event_callback)
-    : job_runner(separation_engine(cache, std::move(output_root)),
+                       std::function<void(const job_descriptor&, const job_event&)> event_callback,
+                       engine_options options,
+                       std::shared_ptr<result_cache> results,
+                       bool coalesce)
+    : job_runner(separation_engine(
+                     cache,
+                     std::move(output_root),
+                     load_audio_file,
+                     write_audio_file,
+                     options),
                  std::move(defaults),
                  worker_count,
-                 std::move(event_callback))
+                 std::move(event_callback),
+                 std::move(results),
+                 coalesce)
 {
 }
 
 job_runner::job_runner(separation_engine engine,
                        job_template defaults,
                        std::size_t worker_count,
-                       std::function<void(const job_descriptor&, const job_event&)> event_callback)
+                       std::function<void(const job_descriptor&, const job_event&)> event_callback,
+                       std::shared_ptr<result_cache> results,
+                       bool coalesce)
     : catalog_(std::move(defaults))
     , engine_(std::move(engine))
     , event_callback_(std::move(event_callback))
+    , results_(std::move(results))
+    , coalesce_(coalesce)
     , pool_(
           worker_count,
           [this](const job_descriptor& job, const std::atomic_bool& stop_flag) { process_job(job, stop_flag); },
@@ -112,33 +129,110 @@ std::expected<job_handle, std::string> job_runner::submit(job_request request)
     job_overrides overrides;
     overrides.profile = request.profile;
     overrides.stems_filter = request.stems;
+    overrides.quality = request.quality;
+    overrides.threads = request.threads;
+    overrides.resampler = request.resampler;
+    overrides.output = request.output;
 
     const std::filesystem::path output_dir = request.output_subdir
                                            ? engine_.output_root() / *request.output_subdir
                                            : engine_.fallback_output_dir(request.input_path);
 
-    auto add_result = catalog_.add_file(request.input_path, overrides, output_dir);
-    if (!add_result)
+    auto described = catalog_.describe(request.input_path, overrides, output_dir);
+    if (!described)
     {
-        return std::unexpected(add_result.error());
+        return std::unexpected(described.error());
+    }
+    if (!described->config.resampler)
+    {
+        described->config.resampler = engine_.options().resampler; // the content key depends on the tier
     }
 
-    const auto& job = catalog_.jobs().at(add_result.value());
-    const auto context = std::make_shared<job_context>();
-    context->job = job;
-    context->output_dir = job.output_dir;
-    const auto shared_future = context->promise.get_future().share();
+    // Only the cache and coalescing need the key. Unreadable inputs get none and fail in the engine.
+    std::optional<std::string> content_key;
+    if (results_ || coalesce_)
+    {
+        if (auto key = result_cache::key_for(
+                described->input_path, described->config, output_settings_key(engine_.options())))
+        {
+            content_key = std::move(*key);
+        }
+    }
 
+    if (results_ && content_key)
+    {
+        if (const auto restored = results_->restore(*content_key, described->output_dir); restored && *restored)
+        {
+            return complete_from_cache(*described, request.observer);
+        }
+    }
+
+    const auto context = std::make_shared<job_context>();
+    std::shared_ptr<attached_job> follower;
+    std::shared_future<job_result> follower_future;
+    job_descriptor job;
     {
         std::lock_guard lock(mutex_);
-        contexts_[job.input_path] = context;
+        if (const auto leader = coalesce_ && content_key ? in_flight_.find(*content_key) : in_flight_.end();
+            leader != in_flight_.end())
+        {
+            // Identical audio and settings are already queued or running: share that execution.
+            follower = std::make_shared<attached_job>();
+            follower_future = follower->promise.get_future().share();
+            follower->job = std::move(described).value();
+            follower->job_id = pool_.reserve_id();
+            follower->observer = std::move(request.observer);
+            leader->second->followers.push_back(follower);
+            followers_by_id_[follower->job_id] = leader->second;
+        }
+        else
+        {
+            auto add_result = catalog_.add_file(request.input_path, overrides, output_dir);
+            if (!add_result)
+            {
+                return std::unexpected(add_result.error());
+            }
+
+            job = catalog_.jobs().at(add_result.value());
+            context->job = job;
+            context->output_dir = job.output_dir;
+            context->content_key = content_key;
+            contexts_[job.input_path] = context;
+            if (coalesce_ && content_key)
+            {
+                in_flight_[*content_key] = context;
+            }
+        }
+    }
+    if (follower)
+    {
+        return attach(follower, std::move(follower_future));
     }
 
+    const auto shared_future = context->promise.get_future().share();
+
     const auto job_id = pool_.enqueue(job);
     if (job_id == static_cast<std::size_t>(-1))
     {
-        std::lock_guard lock(mutex_);
-        contexts_.erase(job.input_path);
+        std::vector<std::shared_ptr<attached_job>> followers;
+        {
+            std::lock_guard lock(mutex_);
+            contexts_.erase(job.input_path);
+            catalog_.release(job.input_path);
+            if (content_key)
+            {
+                in_flight_.erase(*content_key);
+            }
+            followers = std::move(context->followers);
+            for (const auto& follower : followers)
+            {
+                followers_by_id_.erase(follower->job_id);
+            }
+        }
+        job_event failed;
+        failed.status = job_status::failed;
+        failed.error = "Worker pool is shut down";
+        settle_followers(followers, {}, failed, failed.error);
         return std::unexpected("Worker pool is shut down");
     }
 
@@ -147,6 +241,7 @@ std::expected<job_handle, std::string> job_runner::submit(job_request request)
     handle_state->job_id = job_id;
     handle_state->future = shared_future;
     handle_state->pool = &pool_;
+    handle_state->runner = this;
 
     std::vector<job_event> pending;
     {
@@ -170,6 +265,54 @@ std::expected<job_handle, std::string> job_runner::submit(job_request request)
     return job_handle(std::move(handle_state));
 }
 
+std::expected<void, std::string> job_runner::warm_up(model_profile_id profile, std::size_t session_count)
+{
+    return engine_.warm_up(profile, session_count);
+}
+
+std::optional<result_cache_stats> job_runner::result_cache_usage() const
+{
+    if (!results_)
+    {
+        return std::nullopt;
+    }
+    return results_->stats();
+}
+
+job_handle job_runner::complete_from_cache(const job_descriptor& job, const job_observer& observer)
+{
+    job_result result;
+    result.input_path = job.input_path;
+    result.status = job_status::completed;
+    result.output_dir = job.output_dir;
+
+    std::promise<job_result> promise;
+    promise.set_value(std::move(result));
+
+    auto handle_state = std::make_shared<job_handle_state>();
+    handle_state->job = job;
+    handle_state->job_id = pool_.reserve_id();
+    handle_state->future = promise.get_future().share();
+    handle_state->pool = &pool_;
+    handle_state->runner = this;
+
+    job_event event;
+    event.id = handle_state->job_id;
+    event.status = job_status::completed;
+    event.progress = 1.0f;
+    event.message = "Restored from result cache";
+    if (event_callback_)
+    {
+        event_callback_(job, event);
+    }
+    if (observer.callback)
+    {
+        observer.callback(job, event);
+    }
+
+    return job_handle(std::move(handle_state));
+}
+
 void job_runner::process_job(const job_descriptor& job, const std::atomic_bool& stop_flag)
 {
     if (stop_flag.load())
@@ -187,7 +330,7 @@ void job_runner::process_job(const job_descriptor& job, const std::atomic_bool&
             evt.status = job_status::running;
             evt.progress = pct;
             evt.message = message;
-            notify_observers(ctx, evt);
+            forward_event(ctx, evt);
         }
 
         if (stop_flag.load())
@@ -215,6 +358,11 @@ void job_runner::process_job(const job_descriptor& job, const std::atomic_bool&
     if (context)
     {
         context->output_dir = result.value();
+        if (results_ && context->content_key)
+        {
+            // Best effort: a failed store only costs a future re-separation.
+            (void)results_->store(*context->content_key, result.value());
+        }
     }
 }
 
@@ -222,6 +370,10 @@ void job_runner::handle_event(const job_event& event)
 {
     std::shared_ptr<job_context> context;
     std::filesystem::path input_path;
+    std::vector<std::shared_ptr<attached_job>> followers;
+    bool detached = false;
+    const bool terminal = event.status == job_status::completed || event.status == job_status::failed ||
+                          event.status == job_status::cancelled;
 
     {
         std::lock_guard lock(mutex_);
@@ -238,12 +390,25 @@ void job_runner::handle_event(const job_event& event)
             context = ctx_it->second;
         }
 
-        if (event.status == job_status::completed || event.status == job_status::failed ||
-            event.status == job_status::cancelled)
+        if (terminal)
         {
             paths_by_id_.erase(path_it);
             contexts_.erase(input_path);
             catalog_.release(input_path);
+            if (context)
+            {
+                if (context->content_key)
+                {
+                    in_flight_.erase(*context->content_key);
+                }
+                followers = std::move(context->followers);
+                context->followers.clear();
+                for (const auto& follower : followers)
+                {
+                    followers_by_id_.erase(follower->job_id);
+                }
+                detached = context->detached;
+            }
         }
     }
 
@@ -252,40 +417,173 @@ void job_runner::handle_event(const job_event& event)
         return;
     }
 
-    notify_observers(context, event);
+    if (!terminal)
+    {
+        forward_event(context, event);
+        return;
+    }
 
-    switch (event.status)
+    const auto output_dir = context->output_dir.value_or(std::filesystem::path{});
+    std::optional<std::string> error;
+    if (event.status != job_status::completed)
     {
-    case job_status::completed:
+        error = context->error ? context->error : event.error;
+    }
+
+    if (!detached)
     {
+        notify_observers(context, event);
+
         job_result result;
         result.input_path = input_path;
-        result.status = job_status::completed;
-        result.output_dir = context->output_dir.value_or(std::filesystem::path{});
+        result.status = event.status;
+        result.output_dir = output_dir;
+        result.error = error;
         context->promise.set_value(std::move(result));
-        break;
     }
-    case job_status::failed:
-    case job_status::cancelled:
+
+    settle_followers(followers, output_dir, event, error);
+}
+
+job_handle job_runner::attach(const std::shared_ptr<attached_job>& follower, std::shared_future<job_result> future)
+{
+    auto handle_state = std::make_shared<job_handle_state>();
+    handle_state->job = follower->job;
+    handle_state->job_id = follower->job_id;
+    handle_state->future = std::move(future);
+    handle_state->pool = &pool_;
+    handle_state->runner = this;
+
+    job_event queued;
+    queued.id = follower->job_id;
+    queued.status = job_status::queued;
+    queued.message = "Attached to an identical job in flight";
+    {
+        std::lock_guard lock(follower->mutex);
+        follower->handle_state = handle_state;
+        if (!follower->settled)
+        {
+            notify_follower(*follower, queued);
+        }
+    }
+
+    return job_handle(std::move(handle_state));
+}
+
+void job_runner::settle_followers(const std::vector<std::shared_ptr<attached_job>>& followers,
+                                  const std::filesystem::path& source_dir,
+                                  const job_event& event,
+                                  const std::optional<std::string>& error) const
+{
+    for (const auto& follower : followers)
     {
         job_result result;
-        result.input_path = input_path;
+        result.input_path = follower->job.input_path;
         result.status = event.status;
-        result.output_dir = context->output_dir.value_or(std::filesystem::path{});
-        if (context->error)
+        result.output_dir = follower->job.output_dir;
+        result.error = error;
+
+        // Each submission gets its own output directory; link the shared execution's stems into it.
+        if (event.status == job_status::completed && source_dir != follower->job.output_dir)
+        {
+            if (auto linked = link_directory_files(source_dir, follower->job.output_dir); !linked)
+            {
+                result.status = job_status::failed;
+                result.error = linked.error();
+            }
+        }
+
+        job_event settled = event;
+        settled.status = result.status;
+        settled.error = result.error;
+        {
+            std::lock_guard lock(follower->mutex);
+            follower->settled = true;
+            notify_follower(*follower, settled);
+        }
+        follower->promise.set_value(std::move(result));
+    }
+}
+
+bool job_runner::cancel(std::size_t job_id, std::string reason)
+{
+    if (reason.empty())
+    {
+        reason = "Job cancelled";
+    }
+
+    std::shared_ptr<job_context> context;
+    std::shared_ptr<attached_job> follower;
+    std::optional<std::size_t> cancel_execution;
+    {
+        std::lock_guard lock(mutex_);
+        if (const auto it = followers_by_id_.find(job_id); it != followers_by_id_.end())
         {
-            result.error = context->error;
+            context = it->second;
+            followers_by_id_.erase(it);
+            auto& followers = context->followers;
+            const auto pos = std::ranges::find(followers, job_id, &attached_job::job_id);
+            if (pos == followers.end())
+            {
+                return false;
+            }
+            follower = *pos;
+            followers.erase(pos);
+            if (context->detached && followers.empty())
+            {
+                cancel_execution = context->job_id; // nobody is waiting for the result any more
+            }
         }
-        else if (event.error)
+        else if (const auto path = paths_by_id_.find(job_id); path != paths_by_id_.end())
         {
-            result.error = event.error;
+            const auto ctx = contexts_.find(path->second);
+            if (ctx != contexts_.end() && !ctx->second->followers.empty() && !ctx->second->detached)
+            {
+                // Attached jobs still need this execution: only the submitting handle lets go.
+                context = ctx->second;
+                context->detached = true;
+            }
+            else
+            {
+                cancel_execution = job_id;
+            }
         }
+        else
+        {
+            cancel_execution = job_id;
+        }
+    }
+
+    if (!context)
+    {
+        return pool_.cancel(*cancel_execution, std::move(reason));
+    }
+
+    job_event cancelled;
+    cancelled.status = job_status::cancelled;
+    cancelled.error = reason;
+    if (follower)
+    {
+        settle_followers({follower}, {}, cancelled, cancelled.error);
+    }
+    else
+    {
+        cancelled.id = context->job_id;
+        notify_observers(context, cancelled);
+
+        job_result result;
+        result.input_path = context->job.input_path;
+        result.status = job_status::cancelled;
+        result.output_dir = context->output_dir.value_or(std::filesystem::path{});
+        result.error = reason;
         context->promise.set_value(std::move(result));
-        break;
     }
-    default:
-        break;
+
+    if (cancel_execution)
+    {
+        (void)pool_.cancel(*cancel_execution, std::move(reason));
     }
+    return true;
 }
 
 std::shared_ptr<job_runner::job_context> job_runner::context_for(const std::filesystem::path& path) const
@@ -322,4 +620,50 @@ void job_runner::notify_observers(const std::shared_ptr<job_context>& context, c
     }
 }
 
+void job_runner::notify_follower(attached_job& follower, const job_event& event) const
+{
+    job_event forwarded = event;
+    forwarded.id = follower.job_id;
+
+    if (event_callback_)
+    {
+        event_callback_(follower.job, forwarded);
+    }
+
+    if (follower.observer.callback)
+    {
+        follower.observer.callback(follower.job, forwarded);
+    }
+
+    if (const auto handle_state = follower.handle_state.lock())
+    {
+        handle_state->notify(follower.job, forwarded);
+    }
+}
+
+void job_runner::forward_event(const std::shared_ptr<job_context>& context, const job_event& event) const
+{
+    std::vector<std::shared_ptr<attached_job>> followers;
+    bool detached = false;
+    {
+        std::lock_guard lock(mutex_);
+        followers = context->followers;
+        detached = context->detached;
+    }
+
+    if (!detached)
+    {
+        notify_observers(context, event);
+    }
+
+    for (const auto& follower : followers)
+    {
+        std::lock_guard lock(follower->mutex);
+        if (!follower->settled)
+        {
+            notify_follower(*follower, event);
+        }
+    }
+}
+
 } // namespace stemsmith
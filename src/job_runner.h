@@ -13,7 +13,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include "cpu_topology.h"
 #include "job_catalog.h"
+#include "result_cache.h"
 #include "separation_engine.h"
 #include "stemsmith/job_result.h"
 #include "stemsmith/service.h"
@@ -22,12 +24,15 @@
 namespace stemsmith
 {
 
+class job_runner;
+
 struct job_handle_state
 {
     job_descriptor job;
     std::size_t job_id{static_cast<std::size_t>(-1)};
     std::shared_future<job_result> future;
     worker_pool* pool{nullptr};
+    job_runner* runner{nullptr};
     std::atomic_bool cancel_requested{false};
     mutable std::mutex observer_mutex;
     job_observer observer;
@@ -48,17 +53,39 @@ public:
     job_runner(model_cache& cache,
                std::filesystem::path output_root,
                job_template defaults = {},
-               std::size_t worker_count = std::thread::hardware_concurrency(),
-               std::function<void(const job_descriptor&, const job_event&)> event_callback = {});
+               std::size_t worker_count = system_cpu_topology().usable_threads(),
+               std::function<void(const job_descriptor&, const job_event&)> event_callback = {},
+               engine_options options = {},
+               std::shared_ptr<result_cache> results = {},
+               bool coalesce = false);
 
     explicit job_runner(separation_engine engine,
                         job_template defaults = {},
-                        std::size_t worker_count = std::thread::hardware_concurrency(),
-                        std::function<void(const job_descriptor&, const job_event&)> event_callback = {});
+                        std::size_t worker_count = system_cpu_topology().usable_threads(),
+                        std::function<void(const job_descriptor&, const job_event&)> event_callback = {},
+                        std::shared_ptr<result_cache> results = {},
+                        bool coalesce = false);
 
     std::expected<job_handle, std::string> submit(job_request request);
+    [[nodiscard]] std::expected<void, std::string> warm_up(model_profile_id profile, std::size_t session_count);
+    [[nodiscard]] std::optional<result_cache_stats> result_cache_usage() const;
+
+    // Cancels a job; a job sharing its execution with others only detaches, the others keep running.
+    [[nodiscard]] bool cancel(std::size_t job_id, std::string reason);
 
 private:
+    // A submission that attached to an identical job already queued or running (single flight).
+    struct attached_job
+    {
+        std::promise<job_result> promise;
+        job_descriptor job;
+        std::size_t job_id{static_cast<std::size_t>(-1)};
+        job_observer observer;
+        std::mutex mutex; // orders this job's events and guards the fields below
+        std::weak_ptr<job_handle_state> handle_state;
+        bool settled{false};
+    };
+
     struct job_context
     {
         std::promise<job_result> promise;
@@ -68,21 +95,37 @@ private:
         std::size_t job_id{static_cast<std::size_t>(-1)};
         job_observer observer;
         std::weak_ptr<job_handle_state> handle_state;
+        std::optional<std::string> content_key; // audio + settings hash shared by identical jobs
+        std::vector<std::shared_ptr<attached_job>> followers;
+        bool detached{false}; // the submitting handle was cancelled while followers still need the result
     };
 
+    job_handle complete_from_cache(const job_descriptor& job, const job_observer& observer);
+    job_handle attach(const std::shared_ptr<attached_job>& follower, std::shared_future<job_result> future);
+    void settle_followers(const std::vector<std::shared_ptr<attached_job>>& followers,
+                          const std::filesystem::path& source_dir,
+                          const job_event& event,
+                          const std::optional<std::string>& error) const;
+
     void process_job(const job_descriptor& job, const std::atomic_bool& stop_flag);
     void handle_event(const job_event& event);
     std::shared_ptr<job_context> context_for(const std::filesystem::path& path) const;
     void notify_observers(const std::shared_ptr<job_context>& context, const job_event& event) const;
+    void notify_follower(attached_job& follower, const job_event& event) const;
+    void forward_event(const std::shared_ptr<job_context>& context, const job_event& event) const;
 
     job_catalog catalog_;
     separation_engine engine_;
     std::function<void(const job_descriptor&, const job_event&)> event_callback_;
+    std::shared_ptr<result_cache> results_;
+    bool coalesce_{false}; // attach identical submissions to a queued or running job
 
     mutable std::mutex mutex_;
     std::unordered_map<std::filesystem::path, std::shared_ptr<job_context>> contexts_;
     std::unordered_map<std::size_t, std::filesystem::path> paths_by_id_;
     std::unordered_map<std::size_t, std::vector<job_event>> pending_events_;
+    std::unordered_map<std::string, std::shared_ptr<job_context>> in_flight_;          // by content key
+    std::unordered_map<std::size_t, std::shared_ptr<job_context>> followers_by_id_; // follower id -> leader
     worker_pool pool_;
 };
 
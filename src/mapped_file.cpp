@@ -0,0 +1,80 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace stemsmith
+{
+
+std::expected<mapped_file, std::string> mapped_file::open(const std::filesystem::path& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return std::unexpected("Failed to open " + path.string() + ": " + std::strerror(errno));
+    }
+
+    struct stat info{};
+    if (::fstat(fd, &info) != 0)
+    {
+        const auto error = std::string{std::strerror(errno)};
+        ::close(fd);
+        return std::unexpected("Failed to stat " + path.string() + ": " + error);
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    if (size == 0)
+    {
+        ::close(fd);
+        return mapped_file{nullptr, 0};
+    }
+
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    const auto map_error = errno;
+    ::close(fd); // the mapping keeps its own reference to the file
+    if (data == MAP_FAILED)
+    {
+        return std::unexpected("Failed to map " + path.string() + ": " + std::strerror(map_error));
+    }
+
+    return mapped_file{static_cast<const unsigned char*>(data), size};
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+{
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+mapped_file::~mapped_file()
+{
+    reset();
+}
+
+void mapped_file::reset() noexcept
+{
+    if (data_)
+    {
+        ::munmap(const_cast<unsigned char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace stemsmith
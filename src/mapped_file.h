@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+
+namespace stemsmith
+{
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Pages come straight from the page cache, so several processes mapping the same cached weights
+ * share one physical copy and nothing is read until it is touched.
+ */
+class mapped_file
+{
+public:
+    [[nodiscard]] static std::expected<mapped_file, std::string> open(const std::filesystem::path& path);
+
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file();
+
+    [[nodiscard]] std::span<const unsigned char> bytes() const noexcept
+    {
+        return {data_, size_};
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+private:
+    mapped_file(const unsigned char* data, std::size_t size) : data_(data), size_(size) {}
+    void reset() noexcept;
+
+    const unsigned char* data_{};
+    std::size_t size_{};
+};
+
+} // namespace stemsmith
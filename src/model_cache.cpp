@@ -2,10 +2,10 @@
 
 #include <expected>
 #include <fstream>
-#include <iterator>
+#include <sstream>
 #include <system_error>
-#include <vector>
 
+#include "mapped_file.h"
 #include "model_manifest.h"
 #include "picosha2.h"
 #include "stemsmith/weight_fetcher.h"
@@ -19,6 +19,67 @@ std::filesystem::path model_path(const std::filesystem::path& root, const model_
     return root / entry.profile_key / entry.filename;
 }
 
+std::filesystem::path stamp_path(const std::filesystem::path& weights)
+{
+    auto stamp = weights;
+    stamp += ".verified";
+    return stamp;
+}
+
+// Identifies the verified file by checksum, size and mtime so a later ensure_ready can skip hashing.
+std::string stamp_contents(const std::filesystem::path& weights, const model_manifest_entry& entry)
+{
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(weights, ec);
+    const auto mtime = std::filesystem::last_write_time(weights, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    std::ostringstream out;
+    out << entry.sha256 << ' ' << size << ' ' << mtime.time_since_epoch().count();
+    return out.str();
+}
+
+bool stamp_matches(const std::filesystem::path& weights, const model_manifest_entry& entry)
+{
+    std::ifstream input(stamp_path(weights));
+    if (!input)
+    {
+        return false;
+    }
+
+    std::string stored;
+    std::getline(input, stored);
+    const auto expected = stamp_contents(weights, entry);
+    return !expected.empty() && stored == expected;
+}
+
+void write_stamp(const std::filesystem::path& weights, const model_manifest_entry& entry)
+{
+    const auto contents = stamp_contents(weights, entry);
+    if (contents.empty())
+    {
+        return;
+    }
+
+    // Best effort: a missing stamp only costs a rehash on the next start.
+    auto staging = stamp_path(weights);
+    staging += ".tmp";
+    {
+        std::ofstream out(staging, std::ios::trunc);
+        out << contents << '\n';
+        if (!out)
+        {
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(staging, stamp_path(weights), ec);
+}
+
 std::expected<bool, std::string> file_ready(const std::filesystem::path& path, const model_manifest_entry& entry)
 {
     std::error_code ec;
@@ -46,6 +107,11 @@ std::expected<bool, std::string> file_ready(const std::filesystem::path& path, c
         }
     }
 
+    if (stamp_matches(path, entry))
+    {
+        return true;
+    }
+
     auto checksum = stemsmith::model_cache::verify_checksum(path, entry);
     if (!checksum)
     {
@@ -55,9 +121,11 @@ std::expected<bool, std::string> file_ready(const std::filesystem::path& path, c
     if (!checksum.value())
     {
         std::filesystem::remove(path, ec);
+        std::filesystem::remove(stamp_path(path), ec);
         return false;
     }
 
+    write_stamp(path, entry);
     return true;
 }
 } // namespace
@@ -267,20 +335,22 @@ std::expected<model_handle, std::string> model_cache::download_and_stage(model_p
         return std::unexpected("Failed to finalize cached weights: " + ec.message());
     }
 
+    write_stamp(target_path, entry);
     return model_handle{profile, target_path, entry.sha256, entry.size_bytes, false};
 }
 
 std::expected<bool, std::string> model_cache::verify_checksum(const std::filesystem::path& path,
                                                               const model_manifest_entry& entry)
 {
-    std::ifstream input(path, std::ios::binary);
-    if (!input)
+    // Hash straight from the page cache instead of copying the whole weight file onto the heap.
+    const auto mapped = mapped_file::open(path);
+    if (!mapped)
     {
         return std::unexpected("Unable to open weights for checksum: " + path.string());
     }
 
-    const std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(input), {});
-    const auto hash = picosha2::hash256_hex_string(buffer);
+    const auto bytes = mapped->bytes();
+    const auto hash = picosha2::hash256_hex_string(bytes.begin(), bytes.end());
     return hash == entry.sha256;
 }
 } // namespace stemsmith
@@ -22,6 +22,13 @@ std::string expand_template(std::string_view tpl, std::string_view placeholder,
 
     return result;
 }
+
+// demucs.cpp reads f16 GGML files and expands them to f32 kernels; int8 or resident-f16
+// variants need quantized GEMM/conv kernels on that side before they can be listed here.
+bool is_supported_precision(std::string_view precision)
+{
+    return precision == "f16";
+}
 } // namespace
 
 namespace stemsmith
@@ -74,6 +81,11 @@ std::expected<model_manifest, std::string> model_manifest::from_file(const std::
         const auto filename = item["filename"].get<std::string>();
         const auto sha = item["sha256"].get<std::string>();
         const auto size = item.value("size_bytes", 0ULL);
+        const auto precision = item.value("precision", std::string{"f16"});
+        if (!is_supported_precision(precision))
+        {
+            return std::unexpected("Unsupported weight precision '" + precision + "' for " + profile_key);
+        }
 
         const auto profile = lookup_profile(profile_key);
         if (!profile)
@@ -94,7 +106,7 @@ std::expected<model_manifest, std::string> model_manifest::from_file(const std::
             return std::unexpected("No URL specified for manifest entry: " + profile_key);
         }
 
-        entries.push_back(model_manifest_entry{profile->id, profile_key, filename, url, size, sha});
+        entries.push_back(model_manifest_entry{profile->id, profile_key, filename, url, size, sha, precision});
     }
 
     return model_manifest{std::move(entries)};
@@ -18,6 +18,7 @@ struct model_manifest_entry
     std::string url;
     std::uint64_t size_bytes{};
     std::string sha256;
+    std::string precision{"f16"}; // storage precision of the weight file
 };
 
 /**
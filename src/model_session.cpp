@@ -15,38 +15,45 @@ namespace stemsmith
 
 namespace
 {
-std::expected<void, std::string> default_loader(demucscpp::demucs_model& model,
-                                                const std::filesystem::path& weights_path)
-{
-    if (!demucscpp::load_demucs_model(weights_path.string(), &model))
-    {
-        return std::unexpected("Failed to load Demucs weights: " + weights_path.string());
-    }
-    return {};
-}
-
 Eigen::Tensor3dXf default_inference(const demucscpp::demucs_model& model,
                                     const Eigen::MatrixXf& audio,
                                     const demucscpp::ProgressCallback& cb)
 {
     return demucscpp::demucs_inference(model, audio, cb);
 }
+
+// Both layouts already match an Eigen storage order, so this is a straight block copy rather than a transpose.
+void copy_to_matrix(const audio_buffer& input, Eigen::MatrixXf& matrix)
+{
+    const auto frames = static_cast<Eigen::Index>(input.frame_count());
+    if (input.layout == sample_layout::planar)
+    {
+        using planar_matrix = Eigen::Matrix<float, kExpectedChannels, Eigen::Dynamic, Eigen::RowMajor>;
+        matrix = Eigen::Map<const planar_matrix>(input.samples.data(), kExpectedChannels, frames);
+        return;
+    }
+    matrix = Eigen::Map<const Eigen::MatrixXf>(input.samples.data(), kExpectedChannels, frames);
+}
 } // namespace
 
-model_session::model_session(model_profile profile, model_cache& cache)
-    : model_session(
-          profile,
-          [&cache, profile]() -> std::expected<std::filesystem::path, std::string>
-          {
-              auto handle = cache.ensure_ready(profile.id);
-              if (!handle)
-              {
-                  return std::unexpected(handle.error());
-              }
-              return handle->weights_path;
-          },
-          default_loader,
-          default_inference)
+model_session::model_session(model_profile profile, std::shared_ptr<model_store> store)
+    : model_session(profile, std::move(store), default_inference)
+{
+}
+
+model_session::model_session(model_profile profile, std::shared_ptr<model_store> store, inference_function inference)
+    : model_session(profile, std::move(store), std::move(inference), {})
+{
+}
+
+model_session::model_session(model_profile profile,
+                             std::shared_ptr<model_store> store,
+                             inference_function inference,
+                             batch_inference_function batch_inference)
+    : profile_(profile)
+    , store_(std::move(store))
+    , inference_(std::move(inference))
+    , batch_inference_(std::move(batch_inference))
 {
 }
 
@@ -54,39 +61,51 @@ model_session::model_session(model_profile profile,
                              weight_resolver resolver,
                              loader_function loader,
                              inference_function inference)
-    : profile_(profile)
-    , resolver_(std::move(resolver))
-    , loader_(std::move(loader))
-    , inference_(std::move(inference))
+    : model_session(profile,
+                    std::make_shared<model_store>(
+                        [resolver = std::move(resolver)](model_profile_id)
+                            -> std::expected<std::filesystem::path, std::string>
+                        {
+                            if (!resolver)
+                            {
+                                return std::unexpected("Model session is missing its runtime hooks");
+                            }
+                            return resolver();
+                        },
+                        std::move(loader)),
+                    std::move(inference))
 {
 }
 
-std::expected<demucscpp::demucs_model*, std::string> model_session::ensure_model_loaded()
+std::expected<const demucscpp::demucs_model*, std::string> model_session::ensure_model_loaded()
 {
     if (model_)
     {
         return model_.get();
     }
 
-    if (!resolver_ || !loader_ || !inference_)
+    if (!store_ || !inference_)
     {
         return std::unexpected("Model session is missing its runtime hooks");
     }
 
-    auto weights_path = resolver_();
-    if (!weights_path)
+    auto model = store_->acquire(profile_.id);
+    if (!model)
     {
-        return std::unexpected(weights_path.error());
+        return std::unexpected(model.error());
     }
 
-    auto model = std::make_unique<demucscpp::demucs_model>();
-    if (auto load_status = loader_(*model, weights_path.value()); !load_status)
+    model_ = std::move(model.value());
+    return model_.get();
+}
+
+std::expected<void, std::string> model_session::preload()
+{
+    if (auto model = ensure_model_loaded(); !model)
     {
-        return std::unexpected(load_status.error());
+        return std::unexpected(model.error());
     }
-
-    model_ = std::move(model);
-    return model_.get();
+    return {};
 }
 
 std::expected<std::vector<std::size_t>, std::string> model_session::resolve_stem_indices(
@@ -120,10 +139,9 @@ std::expected<std::vector<std::size_t>, std::string> model_session::resolve_stem
     return indices;
 }
 
-std::expected<separation_result, std::string> model_session::separate(
+std::expected<std::vector<std::size_t>, std::string> model_session::validate(
     const audio_buffer& input,
-    std::span<const std::string_view> stems_to_extract,
-    demucscpp::ProgressCallback progress_cb)
+    std::span<const std::string_view> stems) const
 {
     if (input.channels != kExpectedChannels)
     {
@@ -135,7 +153,15 @@ std::expected<separation_result, std::string> model_session::separate(
         return std::unexpected("Input sample rate does not match Demucs requirements");
     }
 
-    const auto indices = resolve_stem_indices(stems_to_extract);
+    return resolve_stem_indices(stems);
+}
+
+std::expected<separation_result, std::string> model_session::separate(
+    const audio_buffer& input,
+    std::span<const std::string_view> stems_to_extract,
+    demucscpp::ProgressCallback progress_cb)
+{
+    const auto indices = validate(input, stems_to_extract);
     if (!indices)
     {
         return std::unexpected(indices.error());
@@ -147,25 +173,136 @@ std::expected<separation_result, std::string> model_session::separate(
         return std::unexpected(model.error());
     }
 
-    const std::size_t frames = input.frame_count();
-    Eigen::MatrixXf audio_matrix(kExpectedChannels, static_cast<int>(frames));
-    for (std::size_t i = 0; i < frames; ++i)
+    auto& matrix = workspace_.input(kExpectedChannels, static_cast<Eigen::Index>(input.frame_count()));
+    copy_to_matrix(input, matrix);
+    auto outputs = inference_(*model.value(), matrix, std::move(progress_cb));
+    return collect_stems(outputs, input, *indices, &workspace_);
+}
+
+void model_session::separate_batch(std::span<batch_entry> entries)
+{
+    std::vector<batch_entry*> runnable;
+    std::vector<std::vector<std::size_t>> indices;
+    runnable.reserve(entries.size());
+    indices.reserve(entries.size());
+    for (auto& entry : entries)
+    {
+        if (!entry.input)
+        {
+            entry.result = std::unexpected("Batch entry has no input");
+            continue;
+        }
+
+        auto resolved = validate(*entry.input, entry.stems);
+        if (!resolved)
+        {
+            entry.result = std::unexpected(resolved.error());
+            continue;
+        }
+        runnable.push_back(&entry);
+        indices.push_back(std::move(resolved.value()));
+    }
+
+    if (runnable.empty())
+    {
+        return;
+    }
+
+    auto model = ensure_model_loaded();
+    if (!model)
+    {
+        for (auto* entry : runnable)
+        {
+            entry->result = std::unexpected(model.error());
+        }
+        return;
+    }
+
+    std::vector<Eigen::MatrixXf> inputs;
+    std::vector<demucscpp::ProgressCallback> callbacks;
+    inputs.reserve(runnable.size());
+    callbacks.reserve(runnable.size());
+    for (auto* entry : runnable)
+    {
+        copy_to_matrix(*entry->input,
+                       inputs.emplace_back(kExpectedChannels, static_cast<Eigen::Index>(entry->input->frame_count())));
+        // Keep one entry's cancellation from tearing down the whole batch.
+        callbacks.emplace_back(
+            [entry](float pct, const std::string& message)
+            {
+                if (entry->error || !entry->progress_cb)
+                {
+                    return;
+                }
+                try
+                {
+                    entry->progress_cb(pct, message);
+                }
+                catch (...)
+                {
+                    entry->error = std::current_exception();
+                }
+            });
+    }
+
+    std::vector<Eigen::Tensor3dXf> outputs;
+    try
+    {
+        if (batch_inference_)
+        {
+            outputs = batch_inference_(*model.value(), inputs, callbacks);
+        }
+        else
+        {
+            outputs.reserve(inputs.size());
+            for (std::size_t i = 0; i < inputs.size(); ++i)
+            {
+                outputs.push_back(inference_(*model.value(), inputs[i], callbacks[i]));
+            }
+        }
+    }
+    catch (...)
     {
-        audio_matrix(0, static_cast<int>(i)) = input.samples[i * 2];
-        audio_matrix(1, static_cast<int>(i)) = input.samples[i * 2 + 1];
+        const auto failure = std::current_exception();
+        for (auto* entry : runnable)
+        {
+            entry->error = failure;
+        }
+        return;
     }
 
-    auto outputs = inference_(*model.value(), audio_matrix, std::move(progress_cb));
+    for (std::size_t i = 0; i < runnable.size(); ++i)
+    {
+        if (i >= outputs.size())
+        {
+            runnable[i]->result = std::unexpected("Batched inference returned fewer outputs than inputs");
+            continue;
+        }
+        // Batched results leave with other jobs' threads and are never recycled here, so skip the workspace.
+        runnable[i]->result = collect_stems(outputs[i], *runnable[i]->input, indices[i], nullptr);
+    }
+}
 
+std::expected<separation_result, std::string> model_session::collect_stems(const Eigen::Tensor3dXf& outputs,
+                                                                           const audio_buffer& input,
+                                                                           std::span<const std::size_t> indices,
+                                                                           inference_workspace* workspace) const
+{
+    const std::size_t frames = input.frame_count();
     if (outputs.dimension(2) != static_cast<Eigen::Index>(frames))
     {
         return std::unexpected("Demucs output length mismatch");
     }
 
+    if (outputs.dimension(1) != kExpectedChannels)
+    {
+        return std::unexpected("Demucs output channel mismatch");
+    }
+
     separation_result result;
-    result.stems.reserve(indices->size());
+    result.stems.reserve(indices.size());
 
-    for (const auto idx : *indices)
+    for (const auto idx : indices)
     {
         if (idx >= static_cast<std::size_t>(outputs.dimension(0)))
         {
@@ -175,14 +312,26 @@ std::expected<separation_result, std::string> model_session::separate(
         audio_buffer stem_buffer;
         stem_buffer.sample_rate = input.sample_rate;
         stem_buffer.channels = kExpectedChannels;
-        stem_buffer.samples.resize(frames * kExpectedChannels);
 
-        for (std::size_t frame = 0; frame < frames; ++frame)
+        if constexpr (static_cast<int>(Eigen::Tensor3dXf::Layout) == static_cast<int>(Eigen::RowMajor))
+        {
+            // Each stem is a contiguous [channel][frame] block of the row-major tensor: copy it as planar.
+            const auto* block = outputs.data() + idx * kExpectedChannels * frames;
+            stem_buffer.samples = workspace ? workspace->take(kExpectedChannels * frames) : std::vector<float>{};
+            stem_buffer.samples.assign(block, block + kExpectedChannels * frames);
+            stem_buffer.layout = sample_layout::planar;
+        }
+        else
         {
-            for (int ch = 0; ch < kExpectedChannels; ++ch)
+            stem_buffer.samples = workspace ? workspace->take(frames * kExpectedChannels) : std::vector<float>{};
+            stem_buffer.samples.resize(frames * kExpectedChannels);
+            for (std::size_t frame = 0; frame < frames; ++frame)
             {
-                stem_buffer.samples[frame * kExpectedChannels + ch] =
-                    outputs(static_cast<long>(idx), ch, static_cast<Eigen::Index>(frame));
+                for (int ch = 0; ch < kExpectedChannels; ++ch)
+                {
+                    stem_buffer.samples[frame * kExpectedChannels + ch] =
+                        outputs(static_cast<long>(idx), ch, static_cast<Eigen::Index>(frame));
+                }
             }
         }
 
@@ -192,4 +341,13 @@ std::expected<separation_result, std::string> model_session::separate(
     return result;
 }
 
+void model_session::recycle(separation_result&& result)
+{
+    for (auto& [name, buffer] : result.stems)
+    {
+        workspace_.give_back(std::move(buffer.samples));
+    }
+    result.stems.clear();
+}
+
 } // namespace stemsmith
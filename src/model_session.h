@@ -1,5 +1,6 @@
 #pragma once
 
+#include <exception>
 #include <expected>
 #include <filesystem>
 #include <functional>
@@ -10,8 +11,10 @@
 #include <vector>
 
 #include "audio_buffer.h"
+#include "inference_workspace.h"
 #include "model.hpp"
 #include "model_cache.h"
+#include "model_store.h"
 #include "stemsmith/job_config.h"
 
 namespace stemsmith
@@ -22,35 +25,92 @@ struct separation_result
     std::vector<std::pair<std::string, audio_buffer>> stems;
 };
 
+/**
+ * @brief One input of a batched separate call; the session fills `result` (or `error`) in place.
+ */
+struct batch_entry
+{
+    const audio_buffer* input{};
+    std::span<const std::string_view> stems{};
+    demucscpp::ProgressCallback progress_cb{};
+    std::expected<separation_result, std::string> result{std::unexpected("Batch entry was not processed")};
+    std::exception_ptr error{}; // thrown by progress_cb (e.g. cancellation), rethrown to the submitter
+};
+
 class model_session
 {
 public:
     using weight_resolver = std::function<std::expected<std::filesystem::path, std::string>()>;
-    using loader_function =
-        std::function<std::expected<void, std::string>(demucscpp::demucs_model&, const std::filesystem::path&)>;
+    using loader_function = model_store::loader_function;
     using inference_function = std::function<
         Eigen::Tensor3dXf(const demucscpp::demucs_model&, const Eigen::MatrixXf&, demucscpp::ProgressCallback)>;
+    // Runs several inputs through one forward pass; must return one tensor per input, in order.
+    using batch_inference_function =
+        std::function<std::vector<Eigen::Tensor3dXf>(const demucscpp::demucs_model&,
+                                                     std::span<const Eigen::MatrixXf>,
+                                                     std::span<const demucscpp::ProgressCallback>)>;
 
-    model_session(model_profile profile, model_cache& cache);
+    // Borrows shared, read-only weights from the store; the session only owns its scratch state.
+    model_session(model_profile profile, std::shared_ptr<model_store> store);
+    model_session(model_profile profile, std::shared_ptr<model_store> store, inference_function inference);
+    model_session(model_profile profile,
+                  std::shared_ptr<model_store> store,
+                  inference_function inference,
+                  batch_inference_function batch_inference);
+
+    // Loads a private copy of the weights through the given hooks (mainly useful for tests).
     model_session(model_profile profile,
                   weight_resolver resolver,
                   loader_function loader,
                   inference_function inference);
 
+    // Resolves and loads the weights ahead of the first separate() call.
+    std::expected<void, std::string> preload();
+
     std::expected<separation_result, std::string> separate(const audio_buffer& input,
                                                            std::span<const std::string_view> stems_to_extract = {},
                                                            demucscpp::ProgressCallback progress_cb = {});
 
+    /**
+     * @brief Separates several inputs with a single batched forward pass.
+     *
+     * Falls back to one inference call per entry when no batch hook is configured. An exception
+     * thrown by an entry's progress callback only fails that entry.
+     */
+    void separate_batch(std::span<batch_entry> entries);
+
+    // Hands the stem buffers of a finished result back to the workspace for the next call.
+    void recycle(separation_result&& result);
+
+    // Releases workspace storage beyond its cap before the session goes idle.
+    void trim_workspace()
+    {
+        workspace_.trim();
+    }
+
+    [[nodiscard]] const workspace_stats& workspace_usage() const noexcept
+    {
+        return workspace_.stats();
+    }
+
 private:
-    std::expected<demucscpp::demucs_model*, std::string> ensure_model_loaded();
+    std::expected<const demucscpp::demucs_model*, std::string> ensure_model_loaded();
     [[nodiscard]] std::expected<std::vector<std::size_t>, std::string> resolve_stem_indices(
         std::span<const std::string_view> stems) const;
+    [[nodiscard]] std::expected<std::vector<std::size_t>, std::string> validate(
+        const audio_buffer& input,
+        std::span<const std::string_view> stems) const;
+    [[nodiscard]] std::expected<separation_result, std::string> collect_stems(const Eigen::Tensor3dXf& outputs,
+                                                                              const audio_buffer& input,
+                                                                              std::span<const std::size_t> indices,
+                                                                              inference_workspace* workspace) const;
 
     model_profile profile_;
-    weight_resolver resolver_;
-    loader_function loader_;
+    std::shared_ptr<model_store> store_;
     inference_function inference_;
-    std::unique_ptr<demucscpp::demucs_model> model_;
+    batch_inference_function batch_inference_;
+    model_store::model_ptr model_;
+    inference_workspace workspace_;
 };
 
 } // namespace stemsmith
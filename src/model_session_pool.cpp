@@ -1,21 +1,24 @@
 #include "model_session_pool.h"
 
+#include <algorithm>
 #include <mutex>
 #include <utility>
 
 namespace stemsmith
 {
 
-model_session_pool::model_session_pool(model_cache& cache)
+model_session_pool::model_session_pool(model_cache& cache) : model_session_pool(std::make_shared<model_store>(cache)) {}
+
+model_session_pool::model_session_pool(std::shared_ptr<model_store> store)
     : model_session_pool(
-          [&cache](model_profile_id profile_id) -> std::expected<session_ptr, std::string>
+          [store = std::move(store)](model_profile_id profile_id) -> std::expected<session_ptr, std::string>
           {
               const auto profile = lookup_profile(profile_id);
               if (!profile)
               {
                   return std::unexpected("Unknown model profile id");
               }
-              return std::make_unique<model_session>(*profile, cache);
+              return std::make_unique<model_session>(*profile, store);
           })
 {
 }
@@ -130,8 +133,74 @@ std::expected<model_session_pool::session_handle, std::string> model_session_poo
     return session_handle(this, profile, std::move(session));
 }
 
+std::expected<void, std::string> model_session_pool::warm(model_profile_id profile, std::size_t session_count)
+{
+    if (!factory_)
+    {
+        return std::unexpected("Session pool is not configured with a factory");
+    }
+
+    std::vector<session_ptr> warmed;
+    {
+        std::lock_guard lock(mutex_);
+        auto& [idle_sessions] = buckets_[profile];
+        while (warmed.size() < session_count && !idle_sessions.empty())
+        {
+            warmed.push_back(std::move(idle_sessions.back()));
+            idle_sessions.pop_back();
+        }
+    }
+
+    // Idle sessions taken above go back to the bucket even if preloading fails midway.
+    auto return_warmed = [&]
+    {
+        std::lock_guard lock(mutex_);
+        auto& [idle_sessions] = buckets_[profile];
+        for (auto& session : warmed)
+        {
+            idle_sessions.push_back(std::move(session));
+        }
+    };
+
+    for (auto& session : warmed)
+    {
+        if (const auto status = session->preload(); !status)
+        {
+            return_warmed();
+            return std::unexpected(status.error());
+        }
+    }
+
+    while (warmed.size() < session_count)
+    {
+        auto constructed = factory_(profile);
+        if (!constructed)
+        {
+            return_warmed();
+            return std::unexpected(constructed.error());
+        }
+
+        if (const auto status = constructed.value()->preload(); !status)
+        {
+            return_warmed();
+            return std::unexpected(status.error());
+        }
+        warmed.push_back(std::move(constructed.value()));
+    }
+
+    return_warmed();
+    return {};
+}
+
+std::size_t model_session_pool::idle_count(model_profile_id profile)
+{
+    std::lock_guard lock(mutex_);
+    return buckets_[profile].idle_sessions.size();
+}
+
 void model_session_pool::recycle(model_profile_id profile, session_ptr session)
 {
+    session->trim_workspace(); // outside the lock: freeing a whole-track input can take a while
     std::lock_guard lock(mutex_);
     buckets_[profile].idle_sessions.push_back(std::move(session));
 }
@@ -9,6 +9,7 @@
 
 #include "model_cache.h"
 #include "model_session.h"
+#include "model_store.h"
 #include "stemsmith/job_config.h"
 
 namespace stemsmith
@@ -21,6 +22,7 @@ public:
     using session_factory = std::function<std::expected<session_ptr, std::string>(model_profile_id)>;
 
     explicit model_session_pool(model_cache& cache);
+    explicit model_session_pool(std::shared_ptr<model_store> store);
     explicit model_session_pool(session_factory factory);
 
     model_session_pool(model_session_pool&& other) noexcept;
@@ -54,6 +56,10 @@ public:
 
     [[nodiscard]] std::expected<session_handle, std::string> acquire(model_profile_id profile);
 
+    // Ensures at least `session_count` idle sessions with loaded weights are available for the profile.
+    [[nodiscard]] std::expected<void, std::string> warm(model_profile_id profile, std::size_t session_count);
+    [[nodiscard]] std::size_t idle_count(model_profile_id profile);
+
 private:
     /**
      * @brief Bucket of idle sessions for a specific model profile.
@@ -0,0 +1,106 @@
+#include "model_store.h"
+
+#include <utility>
+
+#include "model_cache.h"
+
+namespace stemsmith
+{
+
+namespace
+{
+std::expected<void, std::string> default_loader(demucscpp::demucs_model& model,
+                                                const std::filesystem::path& weights_path)
+{
+    if (!demucscpp::load_demucs_model(weights_path.string(), &model))
+    {
+        return std::unexpected("Failed to load Demucs weights: " + weights_path.string());
+    }
+    return {};
+}
+} // namespace
+
+model_store::model_store(model_cache& cache)
+    : model_store(
+          [&cache](model_profile_id profile) -> std::expected<std::filesystem::path, std::string>
+          {
+              auto handle = cache.ensure_ready(profile);
+              if (!handle)
+              {
+                  return std::unexpected(handle.error());
+              }
+              return handle->weights_path;
+          },
+          default_loader)
+{
+}
+
+model_store::model_store(weight_resolver resolver, loader_function loader)
+    : resolver_(std::move(resolver))
+    , loader_(std::move(loader))
+{
+}
+
+std::expected<model_store::model_ptr, std::string> model_store::acquire(model_profile_id profile)
+{
+    if (!resolver_ || !loader_)
+    {
+        return std::unexpected("Model store is missing its runtime hooks");
+    }
+
+    auto& entry = slot_for(profile);
+    std::lock_guard lock(entry.load_mutex);
+    if (auto resident = entry.model.load().lock())
+    {
+        return resident;
+    }
+
+    auto weights_path = resolver_(profile);
+    if (!weights_path)
+    {
+        return std::unexpected(weights_path.error());
+    }
+
+    auto model = std::make_shared<demucscpp::demucs_model>();
+    if (auto load_status = loader_(*model, weights_path.value()); !load_status)
+    {
+        return std::unexpected(load_status.error());
+    }
+
+    ++load_count_;
+    model_ptr shared = std::move(model);
+    entry.model.store(shared);
+    return shared;
+}
+
+std::size_t model_store::resident_count() const
+{
+    std::lock_guard lock(mutex_);
+    std::size_t count = 0;
+    for (const auto& [profile, entry] : slots_)
+    {
+        if (!entry->model.load().expired())
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::size_t model_store::load_count() const noexcept
+{
+    return load_count_.load();
+}
+
+model_store::slot& model_store::slot_for(model_profile_id profile)
+{
+    std::lock_guard lock(mutex_);
+    auto it = slots_.find(profile);
+    if (it == slots_.end())
+    {
+        it = slots_.emplace(profile, std::make_unique<slot>()).first;
+    }
+    return *it->second;
+}
+
+} // namespace stemsmith
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "model.hpp"
+#include "stemsmith/job_config.h"
+
+namespace stemsmith
+{
+class model_cache;
+
+/**
+ * @brief Reference-counted store of immutable Demucs weights, one instance per model profile.
+ *
+ * Sessions borrow a read-only ::demucscpp::demucs_model from the store instead of loading their own
+ * copy, so N sessions of a profile cost one set of weights plus N sets of inference scratch state.
+ * The weights are released once the last borrowing session is destroyed.
+ */
+class model_store
+{
+public:
+    using model_ptr = std::shared_ptr<const demucscpp::demucs_model>;
+    using weight_resolver = std::function<std::expected<std::filesystem::path, std::string>(model_profile_id)>;
+    using loader_function =
+        std::function<std::expected<void, std::string>(demucscpp::demucs_model&, const std::filesystem::path&)>;
+
+    explicit model_store(model_cache& cache);
+    model_store(weight_resolver resolver, loader_function loader);
+
+    model_store(const model_store&) = delete;
+    model_store& operator=(const model_store&) = delete;
+
+    [[nodiscard]] std::expected<model_ptr, std::string> acquire(model_profile_id profile);
+
+    // Number of profiles whose weights are currently resident.
+    [[nodiscard]] std::size_t resident_count() const;
+    // Number of times weights were loaded from disk since construction.
+    [[nodiscard]] std::size_t load_count() const noexcept;
+
+private:
+    struct slot
+    {
+        std::mutex load_mutex;
+        // Written under load_mutex, read lock-free by resident_count().
+        std::atomic<std::weak_ptr<const demucscpp::demucs_model>> model;
+    };
+
+    slot& slot_for(model_profile_id profile);
+
+    weight_resolver resolver_;
+    loader_function loader_;
+
+    mutable std::mutex mutex_; // guards slots_, each slot serialises its own loads
+    std::map<model_profile_id, std::unique_ptr<slot>> slots_;
+    std::atomic<std::size_t> load_count_{0};
+};
+
+} // namespace stemsmith
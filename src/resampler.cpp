@@ -0,0 +1,209 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+#include <samplerate.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace stemsmith
+{
+
+namespace
+{
+constexpr std::size_t kMaxPhases = 1024;
+
+struct filter_spec
+{
+    double attenuation_db;
+    double transition; // fraction of the lower Nyquist frequency
+};
+
+filter_spec spec_for(resample_quality quality)
+{
+    return quality == resample_quality::fast ? filter_spec{60.0, 0.25} : filter_spec{80.0, 0.16};
+}
+
+double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50 && term > 1e-12 * sum; ++k)
+    {
+        const double factor = x / (2.0 * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+float dot(const float* a, const float* b, std::size_t n)
+{
+    std::size_t i = 0;
+    float sum = 0.0f;
+#if defined(__SSE2__)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4)
+    {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    sum = (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1)) + (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+#endif
+    for (; i < n; ++i)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+} // namespace
+
+int libsamplerate_converter(resample_quality quality) noexcept
+{
+    switch (quality)
+    {
+    case resample_quality::fast:
+        return SRC_SINC_FASTEST;
+    case resample_quality::medium:
+        return SRC_SINC_MEDIUM_QUALITY;
+    case resample_quality::best:
+        break;
+    }
+    return SRC_SINC_BEST_QUALITY;
+}
+
+bool polyphase_resampler::supports(int source_rate, int target_rate, resample_quality quality) noexcept
+{
+    if (quality == resample_quality::best || source_rate <= 0 || target_rate <= 0 || source_rate == target_rate)
+    {
+        return false;
+    }
+    const auto divisor = std::gcd(source_rate, target_rate);
+    return static_cast<std::size_t>(target_rate / divisor) <= kMaxPhases;
+}
+
+polyphase_resampler::polyphase_resampler(int source_rate,
+                                         int target_rate,
+                                         resample_quality quality,
+                                         std::size_t channels)
+    : channels_(std::max<std::size_t>(1, channels))
+{
+    const auto divisor = std::gcd(source_rate, target_rate);
+    up_ = static_cast<std::size_t>(target_rate / divisor);
+    down_ = static_cast<std::size_t>(source_rate / divisor);
+
+    // Kaiser design: the tap count follows from the attenuation and the transition width.
+    const auto spec = spec_for(quality);
+    const double nyquist = 0.5 * std::min(source_rate, target_rate);
+    const double transition = spec.transition * nyquist / source_rate; // cycles per input sample
+    const auto estimate = (spec.attenuation_db - 8.0) / (2.285 * 2.0 * std::numbers::pi * transition);
+    taps_ = std::max<std::size_t>(8, (static_cast<std::size_t>(std::ceil(estimate)) + 3) / 4 * 4);
+    const double cutoff = nyquist / source_rate - 0.5 * transition;
+    const double beta = 0.1102 * (spec.attenuation_db - 8.7);
+    const double window_norm = bessel_i0(beta);
+
+    const auto half = static_cast<double>(taps_ / 2);
+    coefficients_.resize(up_ * taps_);
+    for (std::size_t phase = 0; phase < up_; ++phase)
+    {
+        auto* h = coefficients_.data() + phase * taps_;
+        double sum = 0.0;
+        for (std::size_t k = 0; k < taps_; ++k)
+        {
+            // Distance in input samples between tap k and the output's exact input position.
+            const double d = static_cast<double>(k) - (half - 1.0) - static_cast<double>(phase) / up_;
+            const double x = 2.0 * cutoff * d;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+            const double r = d / half;
+            const double window = r * r >= 1.0 ? 0.0 : bessel_i0(beta * std::sqrt(1.0 - r * r)) / window_norm;
+            const double value = 2.0 * cutoff * sinc * window;
+            h[k] = static_cast<float>(value);
+            sum += value;
+        }
+        // Unity gain per phase keeps DC flat across output positions.
+        for (std::size_t k = 0; k < taps_; ++k)
+        {
+            h[k] = static_cast<float>(h[k] / sum);
+        }
+    }
+
+    const auto lead = taps_ / 2 - 1;
+    history_.assign(channels_, std::vector<float>(lead, 0.0f));
+    history_start_ = -static_cast<std::int64_t>(lead);
+}
+
+void polyphase_resampler::process(std::span<const float> input, bool end_of_input, std::vector<float>& out)
+{
+    const auto frames = input.size() / channels_;
+    for (std::size_t ch = 0; ch < channels_; ++ch)
+    {
+        auto& channel = history_[ch];
+        const auto base = channel.size();
+        channel.resize(base + frames + (end_of_input ? taps_ / 2 + 1 : 0), 0.0f);
+        for (std::size_t frame = 0; frame < frames; ++frame)
+        {
+            channel[base + frame] = input[frame * channels_ + ch];
+        }
+    }
+    input_frames_ += frames;
+
+    // Output n reads input from floor(n * down / up) - lead on, so the last reachable position bounds
+    // how many outputs the buffered history can produce.
+    const auto lead = static_cast<std::int64_t>(taps_ / 2 - 1);
+    const auto history_end = history_start_ + static_cast<std::int64_t>(history_[0].size());
+    const auto last_position = history_end - static_cast<std::int64_t>(taps_) + lead;
+    auto end_output =
+        last_position < 0 ? 0 : (static_cast<std::uint64_t>(last_position + 1) * up_ + down_ - 1) / down_;
+    if (end_of_input)
+    {
+        end_output = std::min(end_output, (input_frames_ * up_ + down_ - 1) / down_);
+    }
+    if (end_output <= next_output_)
+    {
+        return;
+    }
+
+    const auto base = out.size();
+    out.resize(base + (end_output - next_output_) * channels_);
+    auto* dst = out.data() + base;
+    for (auto n = next_output_; n < end_output; ++n)
+    {
+        const auto* h = coefficients_.data() + (n * down_ % up_) * taps_;
+        const auto first = static_cast<std::int64_t>(n * down_ / up_) - lead;
+        const auto offset = static_cast<std::size_t>(first - history_start_);
+        for (std::size_t ch = 0; ch < channels_; ++ch)
+        {
+            *dst++ = dot(h, history_[ch].data() + offset, taps_);
+        }
+    }
+    next_output_ = end_output;
+
+    // Drop the input no later output can reach.
+    const auto next_first = static_cast<std::int64_t>(next_output_ * down_ / up_) - lead;
+    if (const auto drop = std::min(next_first, history_end) - history_start_; drop > 0)
+    {
+        for (auto& channel : history_)
+        {
+            channel.erase(channel.begin(), channel.begin() + drop);
+        }
+        history_start_ += drop;
+    }
+}
+
+} // namespace stemsmith
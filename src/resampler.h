@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "stemsmith/job_config.h"
+
+namespace stemsmith
+{
+
+// libsamplerate converter type used for `quality` when the polyphase path does not apply.
+[[nodiscard]] int libsamplerate_converter(resample_quality quality) noexcept;
+
+/**
+ * @brief Windowed-sinc polyphase resampler for rational rate ratios such as 48000/44100 (147/160).
+ *
+ * The ratio is reduced to up/down and one Kaiser-windowed filter phase is precomputed per output
+ * position modulo `up`, so each output sample is a single dot product over contiguous memory
+ * (SSE2/NEON where available). `medium` keeps ~80 dB of stopband attenuation with a transition
+ * band of 16% of the lower Nyquist frequency, `fast` ~60 dB with 25%; both end at the lower
+ * Nyquist frequency so nothing aliases. Input may arrive in chunks: history is carried across
+ * calls and the filter tail is flushed on `end_of_input`.
+ */
+class polyphase_resampler
+{
+public:
+    // True when the reduced ratio has a small enough phase table; `best` never takes this path.
+    [[nodiscard]] static bool supports(int source_rate, int target_rate, resample_quality quality) noexcept;
+
+    polyphase_resampler(int source_rate, int target_rate, resample_quality quality, std::size_t channels);
+
+    // Appends the interleaved output for `input` (interleaved frames) to `out`.
+    void process(std::span<const float> input, bool end_of_input, std::vector<float>& out);
+
+    [[nodiscard]] std::size_t taps() const noexcept
+    {
+        return taps_;
+    }
+
+private:
+    std::size_t up_{};
+    std::size_t down_{};
+    std::size_t taps_{};
+    std::size_t channels_{};
+    std::vector<float> coefficients_;         // up_ phases of taps_ coefficients each
+    std::vector<std::vector<float>> history_; // planar input per channel, starting at history_start_
+    std::int64_t history_start_{};            // input index of history_[ch][0]; negative while zero-padded
+    std::uint64_t input_frames_{};
+    std::uint64_t next_output_{};
+};
+
+} // namespace stemsmith
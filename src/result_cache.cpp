@@ -0,0 +1,316 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "picosha2.h"
+
+namespace stemsmith
+{
+
+namespace
+{
+constexpr std::size_t kHashChunkBytes = 1U << 20;
+constexpr std::string_view kKeyVersion = "stemsmith-result-v4";
+constexpr std::string_view kStagingPrefix = ".staging-";
+
+void hash_field(picosha2::hash256_one_by_one& hasher, std::string_view field)
+{
+    hasher.process(field.begin(), field.end());
+    constexpr char separator = '\0';
+    hasher.process(&separator, &separator + 1);
+}
+
+std::uint64_t directory_bytes(const std::filesystem::path& dir)
+{
+    std::uint64_t bytes = 0;
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(dir, ec))
+    {
+        if (file.is_regular_file(ec))
+        {
+            bytes += file.file_size(ec);
+        }
+    }
+    return bytes;
+}
+} // namespace
+
+std::expected<void, std::string> link_directory_files(const std::filesystem::path& from,
+                                                     const std::filesystem::path& to)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(to, ec);
+    if (ec)
+    {
+        return std::unexpected("Failed to create output directory: " + ec.message());
+    }
+
+    for (const auto& file : std::filesystem::directory_iterator(from, ec))
+    {
+        if (!file.is_regular_file(ec))
+        {
+            continue;
+        }
+        const auto target = to / file.path().filename();
+        std::filesystem::remove(target, ec);
+        std::filesystem::create_hard_link(file.path(), target, ec);
+        if (ec)
+        {
+            std::filesystem::copy_file(file.path(), target, std::filesystem::copy_options::overwrite_existing, ec);
+        }
+        if (ec)
+        {
+            return std::unexpected("Failed to place stem " + target.string() + ": " + ec.message());
+        }
+    }
+    if (ec)
+    {
+        return std::unexpected("Failed to list " + from.string() + ": " + ec.message());
+    }
+    return {};
+}
+
+result_cache::result_cache(std::filesystem::path root, std::uint64_t max_bytes)
+    : root_(std::move(root))
+    , max_bytes_(max_bytes)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(root_, ec);
+    load_entries();
+}
+
+std::expected<std::string, std::string> result_cache::key_for(const std::filesystem::path& input,
+                                                              const job_template& config,
+                                                              std::string_view engine_settings)
+{
+    const auto mapped = mapped_file::open(input);
+    if (!mapped)
+    {
+        return std::unexpected(mapped.error());
+    }
+
+    picosha2::hash256_one_by_one hasher;
+    hasher.init();
+    hash_field(hasher, kKeyVersion);
+    if (const auto profile = lookup_profile(config.profile))
+    {
+        hash_field(hasher, profile->key);
+    }
+    for (const auto& stem : config.resolved_stems())
+    {
+        hash_field(hasher, stem);
+    }
+    hash_field(hasher, quality_key(config.quality));
+    hash_field(hasher, resample_quality_key(config.resampler.value_or(resample_quality::best)));
+    hash_field(hasher, output_format_key(config.output.format));
+    if (config.output.format == output_format::flac)
+    {
+        hash_field(hasher, std::to_string(config.output.flac_level));
+    }
+    hash_field(hasher, engine_settings);
+
+    // The encoded file rather than its decoded PCM: hashing is then bounded by disk reads and submit
+    // never decodes (or resamples) the input a second time.
+    const auto bytes = mapped->bytes();
+    for (std::size_t offset = 0; offset < bytes.size(); offset += kHashChunkBytes)
+    {
+        const auto end = std::min(bytes.size(), offset + kHashChunkBytes);
+        hasher.process(bytes.begin() + offset, bytes.begin() + end);
+    }
+
+    hasher.finish();
+    return picosha2::get_hash_hex_string(hasher);
+}
+
+std::expected<bool, std::string> result_cache::restore(const std::string& key, const std::filesystem::path& output_dir)
+{
+    const auto entry_dir = root_ / key;
+    std::list<entry>::iterator pinned;
+    {
+        std::lock_guard lock(mutex_);
+        const auto found = index_.find(key);
+        if (found == index_.end())
+        {
+            ++stats_.misses;
+            return false;
+        }
+        std::error_code ec;
+        if (!std::filesystem::is_directory(entry_dir, ec))
+        {
+            // Removed behind our back; forget it unless another restore still holds it.
+            if (found->second->pins == 0)
+            {
+                stats_.bytes -= found->second->bytes;
+                lru_.erase(found->second);
+                index_.erase(found);
+                stats_.entries = lru_.size();
+            }
+            ++stats_.misses;
+            return false;
+        }
+        pinned = found->second;
+        ++pinned->pins;
+        touch(pinned);
+    }
+
+    // Linking or copying a whole entry can take a while; other lookups and stores proceed meanwhile.
+    auto linked = link_directory_files(entry_dir, output_dir);
+
+    std::lock_guard lock(mutex_);
+    --pinned->pins;
+    if (linked)
+    {
+        ++stats_.hits;
+    }
+    evict_over_budget(); // anything a store could not evict while this entry was pinned
+    if (!linked)
+    {
+        return std::unexpected(linked.error());
+    }
+    return true;
+}
+
+std::expected<void, std::string> result_cache::store(const std::string& key, const std::filesystem::path& job_dir)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (index_.contains(key))
+        {
+            return {};
+        }
+    }
+
+    if (const auto bytes = directory_bytes(job_dir); bytes == 0 || bytes > max_bytes_)
+    {
+        return {}; // nothing to keep, or larger than the whole budget
+    }
+
+    // Copy into a private staging directory first so readers never see a partial entry.
+    std::filesystem::path staging;
+    {
+        std::lock_guard lock(mutex_);
+        staging = root_ / (std::string{kStagingPrefix} + std::to_string(next_staging_++));
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(staging, ec);
+    std::filesystem::create_directories(staging, ec);
+    if (ec)
+    {
+        return std::unexpected("Failed to create result cache entry: " + ec.message());
+    }
+
+    std::uint64_t bytes = 0;
+    for (const auto& file : std::filesystem::directory_iterator(job_dir, ec))
+    {
+        if (!file.is_regular_file(ec))
+        {
+            continue;
+        }
+        // A copy rather than a hardlink: the job directory stays writable without touching the cache.
+        std::filesystem::copy_file(file.path(), staging / file.path().filename(), ec);
+        if (ec)
+        {
+            std::filesystem::remove_all(staging, ec);
+            return std::unexpected("Failed to copy stem into result cache: " + ec.message());
+        }
+        bytes += file.file_size(ec);
+    }
+
+    std::lock_guard lock(mutex_);
+    if (index_.contains(key))
+    {
+        std::filesystem::remove_all(staging, ec);
+        return {};
+    }
+
+    std::filesystem::rename(staging, root_ / key, ec);
+    if (ec)
+    {
+        std::filesystem::remove_all(staging, ec);
+        return std::unexpected("Failed to publish result cache entry: " + ec.message());
+    }
+
+    lru_.push_front(entry{key, bytes});
+    index_[key] = lru_.begin();
+    stats_.bytes += bytes;
+    stats_.entries = lru_.size();
+    evict_over_budget();
+    return {};
+}
+
+result_cache_stats result_cache::stats() const
+{
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void result_cache::load_entries()
+{
+    struct found_entry
+    {
+        entry value;
+        std::filesystem::file_time_type last_used;
+    };
+
+    std::vector<found_entry> found;
+    std::error_code ec;
+    for (const auto& dir : std::filesystem::directory_iterator(root_, ec))
+    {
+        const auto name = dir.path().filename().string();
+        if (!dir.is_directory(ec))
+        {
+            continue;
+        }
+        if (name.starts_with(kStagingPrefix))
+        {
+            std::filesystem::remove_all(dir.path(), ec); // left behind by an interrupted store
+            continue;
+        }
+        found.push_back({entry{name, directory_bytes(dir.path())}, dir.last_write_time(ec)});
+    }
+
+    std::ranges::sort(found, std::ranges::greater{}, &found_entry::last_used);
+    std::lock_guard lock(mutex_);
+    for (auto& item : found)
+    {
+        stats_.bytes += item.value.bytes;
+        lru_.push_back(std::move(item.value));
+        index_[lru_.back().key] = std::prev(lru_.end());
+    }
+    stats_.entries = lru_.size();
+    evict_over_budget();
+}
+
+void result_cache::touch(std::list<entry>::iterator it)
+{
+    lru_.splice(lru_.begin(), lru_, it);
+    std::error_code ec;
+    std::filesystem::last_write_time(root_ / it->key, std::filesystem::file_time_type::clock::now(), ec);
+}
+
+void result_cache::evict_over_budget()
+{
+    while (stats_.bytes > max_bytes_)
+    {
+        const auto victim = std::ranges::find(lru_.rbegin(), lru_.rend(), std::size_t{0}, &entry::pins);
+        if (victim == lru_.rend())
+        {
+            break; // everything left is being restored
+        }
+        std::error_code ec;
+        std::filesystem::remove_all(root_ / victim->key, ec);
+        stats_.bytes -= victim->bytes;
+        index_.erase(victim->key);
+        lru_.erase(std::next(victim).base());
+        ++stats_.evictions;
+    }
+    stats_.entries = lru_.size();
+}
+
+} // namespace stemsmith
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "stemsmith/service.h"
+
+namespace stemsmith
+{
+
+// Hardlinks every regular file of `from` into `to` (created if needed), copying where linking fails.
+[[nodiscard]] std::expected<void, std::string> link_directory_files(const std::filesystem::path& from,
+                                                                    const std::filesystem::path& to);
+
+/**
+ * @brief Content-addressed store of finished stems.
+ *
+ * Entries live in `<root>/<key>/` where the key hashes the input file together with every job
+ * setting that changes the separated audio. Restoring hardlinks the cached files into the job's
+ * output directory (copying across filesystems), and entries beyond the byte budget are evicted
+ * least recently used first. Recency survives restarts through the entry directories' mtimes.
+ * Stem writers replace their files by rename (see stem_file_writer), so a rerun never writes through
+ * a link into the cache. Files are linked or copied outside the lock; the entry is pinned meanwhile
+ * so eviction cannot remove it mid-restore.
+ */
+class result_cache
+{
+public:
+    result_cache(std::filesystem::path root, std::uint64_t max_bytes);
+
+    result_cache(const result_cache&) = delete;
+    result_cache& operator=(const result_cache&) = delete;
+
+    // SHA-256 over the input file's bytes, the model profile, resolved stems, quality, resampler tier,
+    // output encoding and the engine's output settings (see output_settings_key()).
+    [[nodiscard]] static std::expected<std::string, std::string> key_for(const std::filesystem::path& input,
+                                                                         const job_template& config,
+                                                                         std::string_view engine_settings = {});
+
+    // Places the stems cached under `key` into `output_dir`; false on a miss.
+    [[nodiscard]] std::expected<bool, std::string> restore(const std::string& key,
+                                                           const std::filesystem::path& output_dir);
+
+    // Copies the files of a finished job directory into the cache under `key`, then evicts over budget.
+    [[nodiscard]] std::expected<void, std::string> store(const std::string& key, const std::filesystem::path& job_dir);
+
+    [[nodiscard]] result_cache_stats stats() const;
+
+private:
+    struct entry
+    {
+        std::string key;
+        std::uint64_t bytes{};
+        std::size_t pins{}; // restores in progress; pinned entries are not evicted
+    };
+
+    void load_entries();
+    void touch(std::list<entry>::iterator it);
+    void evict_over_budget();
+
+    std::filesystem::path root_;
+    std::uint64_t max_bytes_{};
+
+    mutable std::mutex mutex_;
+    std::list<entry> lru_; // most recently used first
+    std::unordered_map<std::string, std::list<entry>::iterator> index_;
+    result_cache_stats stats_{};
+    std::uint64_t next_staging_{0};
+};
+
+} // namespace stemsmith
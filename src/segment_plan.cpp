@@ -0,0 +1,133 @@
+#include "segment_plan.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace stemsmith
+{
+
+std::vector<audio_segment> plan_segments(std::size_t total_frames,
+                                         std::size_t segment_frames,
+                                         std::size_t overlap_frames)
+{
+    std::vector<audio_segment> segments;
+    if (total_frames == 0)
+    {
+        return segments;
+    }
+
+    if (segment_frames == 0 || total_frames <= segment_frames)
+    {
+        segments.push_back({0, total_frames, false, false});
+        return segments;
+    }
+
+    overlap_frames = std::min(overlap_frames, segment_frames / 2);
+    const auto step = segment_frames - overlap_frames;
+    for (std::size_t offset = 0;; offset += step)
+    {
+        if (offset + segment_frames >= total_frames)
+        {
+            segments.push_back({offset, total_frames - offset, offset > 0, false});
+            break;
+        }
+        segments.push_back({offset, segment_frames, offset > 0, true});
+    }
+
+    return segments;
+}
+
+float crossfade_weight(const audio_segment& segment, std::size_t index, std::size_t overlap_frames)
+{
+    if (overlap_frames == 0)
+    {
+        return 1.0f;
+    }
+
+    const auto overlap = static_cast<float>(overlap_frames);
+    if (segment.fade_in && index < overlap_frames)
+    {
+        return (static_cast<float>(index) + 0.5f) / overlap;
+    }
+
+    if (segment.fade_out && index + overlap_frames >= segment.length)
+    {
+        return (static_cast<float>(segment.length - index) - 0.5f) / overlap;
+    }
+
+    return 1.0f;
+}
+
+audio_buffer slice_segment(const audio_buffer& source, const audio_segment& segment)
+{
+    audio_buffer part;
+    part.sample_rate = source.sample_rate;
+    part.channels = source.channels;
+    part.layout = source.layout;
+
+    if (source.layout == sample_layout::interleaved)
+    {
+        const auto begin = source.samples.begin() + static_cast<std::ptrdiff_t>(segment.offset * source.channels);
+        part.samples.assign(begin, begin + static_cast<std::ptrdiff_t>(segment.length * source.channels));
+        return part;
+    }
+
+    part.samples.reserve(segment.length * source.channels);
+    for (std::size_t ch = 0; ch < source.channels; ++ch)
+    {
+        const auto begin = source.samples.begin() + static_cast<std::ptrdiff_t>(source.index(segment.offset, ch));
+        part.samples.insert(part.samples.end(), begin, begin + static_cast<std::ptrdiff_t>(segment.length));
+    }
+    return part;
+}
+
+void overlap_add(audio_buffer& target,
+                 const audio_buffer& part,
+                 const audio_segment& segment,
+                 std::size_t overlap_frames)
+{
+    const auto frames = std::min(segment.length, part.frame_count());
+    for (std::size_t ch = 0; ch < target.channels; ++ch)
+    {
+        for (std::size_t frame = 0; frame < frames; ++frame)
+        {
+            const auto weight = crossfade_weight(segment, frame, overlap_frames);
+            target.samples[target.index(segment.offset + frame, ch)] += weight * part.samples[part.index(frame, ch)];
+        }
+    }
+}
+
+bool is_silent(const audio_buffer& source, const audio_segment& segment, double threshold_db)
+{
+    constexpr std::size_t kBlockFrames = 1024;
+    const auto channels = source.channels;
+    const auto end = std::min(segment.offset + segment.length, source.frame_count());
+    if (channels == 0 || segment.offset >= end)
+    {
+        return true;
+    }
+
+    // Compare mean squares against the squared linear threshold instead of taking logs per block.
+    const auto threshold = std::pow(10.0, threshold_db / 20.0);
+    const auto threshold_power = threshold * threshold;
+    for (std::size_t block = segment.offset; block < end; block += kBlockFrames)
+    {
+        const auto block_end = std::min(block + kBlockFrames, end);
+        double energy = 0.0;
+        for (std::size_t ch = 0; ch < channels; ++ch)
+        {
+            for (std::size_t frame = block; frame < block_end; ++frame)
+            {
+                const double sample = source.samples[source.index(frame, ch)];
+                energy += sample * sample;
+            }
+        }
+        if (energy / static_cast<double>((block_end - block) * channels) >= threshold_power)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace stemsmith
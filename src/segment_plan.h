@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "audio_buffer.h"
+
+namespace stemsmith
+{
+
+/**
+ * @brief A window of frames processed as one unit when a track is split into overlapping segments.
+ */
+struct audio_segment
+{
+    std::size_t offset{}; // first frame in the source track
+    std::size_t length{}; // number of frames
+    bool fade_in{false};  // overlaps the previous segment
+    bool fade_out{false}; // overlaps the next segment
+};
+
+/**
+ * @brief Splits `total_frames` into segments of `segment_frames` that overlap by exactly `overlap_frames`.
+ *
+ * The final segment is shortened to end at the last frame but always extends past the previous
+ * segment's overlap, so every interior seam has the same complementary crossfade.
+ */
+[[nodiscard]] std::vector<audio_segment> plan_segments(std::size_t total_frames,
+                                                       std::size_t segment_frames,
+                                                       std::size_t overlap_frames);
+
+// Linear crossfade weight of frame `index` within `segment`; weights of overlapping frames sum to 1.
+[[nodiscard]] float crossfade_weight(const audio_segment& segment, std::size_t index, std::size_t overlap_frames);
+
+// Copies the frames covered by `segment` out of `source`, keeping its sample layout.
+[[nodiscard]] audio_buffer slice_segment(const audio_buffer& source, const audio_segment& segment);
+
+// Adds the crossfaded `part` into `target` at the segment's offset; the two may differ in layout.
+void overlap_add(audio_buffer& target,
+                 const audio_buffer& part,
+                 const audio_segment& segment,
+                 std::size_t overlap_frames);
+
+/**
+ * @brief True when every short block of `segment` in `source` has an RMS level below `threshold_db` dBFS.
+ *
+ * Blocks of about 20 ms are checked individually so a brief transient inside a long quiet stretch
+ * still counts as content.
+ */
+[[nodiscard]] bool is_silent(const audio_buffer& source, const audio_segment& segment, double threshold_db);
+
+} // namespace stemsmith
@@ -1,9 +1,19 @@
 #include "separation_engine.h"
 
 #include <algorithm>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <string_view>
+#include <thread>
 #include <vector>
 
+#include "audio_stream.h"
+#include "segment_plan.h"
+
 namespace stemsmith
 {
 
@@ -18,28 +28,307 @@ std::filesystem::path job_output_directory(const std::filesystem::path& root, co
     const auto stem = job.input_path.stem();
     return root / stem;
 }
+
+std::size_t seconds_to_frames(double seconds, int sample_rate)
+{
+    if (seconds <= 0.0 || sample_rate <= 0)
+    {
+        return 0;
+    }
+    return static_cast<std::size_t>(std::llround(seconds * sample_rate));
+}
+
+std::size_t compute_budget(const engine_options& options)
+{
+    if (options.compute_threads > 0)
+    {
+        return options.compute_threads;
+    }
+    return system_cpu_topology().usable_threads();
+}
+
+// Overlap of `segment_frames` for the job's quality, capped so neighbouring crossfades never meet.
+std::size_t overlap_for(const engine_options& options, const quality_settings& quality, std::size_t segment_frames)
+{
+    const auto seconds = options.segment_overlap_seconds * quality.overlap_scale;
+    return std::min(seconds_to_frames(seconds, demucscpp::SUPPORTED_SAMPLE_RATE), segment_frames / 2);
+}
+
+// Zeroed stems shaped like a model session's output for `input`, standing in for segments that skip inference.
+std::expected<separation_result, std::string> silent_stems(const audio_buffer& input,
+                                                           model_profile_id profile_id,
+                                                           std::span<const std::string_view> stems)
+{
+    const auto profile = lookup_profile(profile_id);
+    if (!profile)
+    {
+        return std::unexpected("Unknown model profile id");
+    }
+
+    std::vector<std::string_view> names(stems.begin(), stems.end());
+    if (names.empty())
+    {
+        names.assign(profile->stems.begin(), profile->stems.begin() + static_cast<std::ptrdiff_t>(profile->stem_count));
+    }
+
+    separation_result result;
+    result.stems.reserve(names.size());
+    for (const auto name : names)
+    {
+        audio_buffer stem;
+        stem.sample_rate = input.sample_rate;
+        stem.channels = input.channels;
+        stem.layout = sample_layout::planar;
+        stem.samples.assign(input.samples.size(), 0.0f);
+        result.stems.emplace_back(std::string{name}, std::move(stem));
+    }
+    return result;
+}
+
+/**
+ * @brief Averages `quality.shifts` passes over copies of `audio` delayed by increasing offsets.
+ *
+ * This is the shift trick from Demucs' apply_model, with deterministic offsets so reruns are
+ * reproducible. A single shift calls `separate` directly, which keeps the output bit-identical.
+ * Each pass result is handed to `recycle` (when set) once it has been accumulated.
+ */
+std::expected<separation_result, std::string> separate_shifted(
+    const audio_buffer& audio,
+    const quality_settings& quality,
+    const std::function<std::expected<separation_result, std::string>(const audio_buffer&,
+                                                                      demucscpp::ProgressCallback)>& separate,
+    const std::function<void(separation_result&&)>& recycle,
+    const demucscpp::ProgressCallback& progress_cb)
+{
+    if (quality.shifts <= 1)
+    {
+        return separate(audio, progress_cb);
+    }
+
+    const auto max_shift = seconds_to_frames(quality.max_shift_seconds, audio.sample_rate);
+    const auto source = to_interleaved(audio);
+    const auto frames = source.frame_count();
+    separation_result averaged;
+    for (std::size_t pass = 0; pass < quality.shifts; ++pass)
+    {
+        const auto offset = pass * max_shift / quality.shifts;
+        audio_buffer shifted;
+        shifted.sample_rate = source.sample_rate;
+        shifted.channels = source.channels;
+        shifted.samples.reserve(offset * source.channels + source.samples.size());
+        shifted.samples.assign(offset * source.channels, 0.0f);
+        shifted.samples.insert(shifted.samples.end(), source.samples.begin(), source.samples.end());
+
+        demucscpp::ProgressCallback pass_cb;
+        if (progress_cb)
+        {
+            pass_cb = [&, pass](float pct, const std::string& message)
+            { progress_cb((static_cast<float>(pass) + pct) / static_cast<float>(quality.shifts), message); };
+        }
+
+        auto part = separate(shifted, pass_cb);
+        if (!part)
+        {
+            return std::unexpected(part.error());
+        }
+
+        if (averaged.stems.empty())
+        {
+            for (const auto& [name, buffer] : part->stems)
+            {
+                audio_buffer stem_buffer;
+                stem_buffer.sample_rate = buffer.sample_rate;
+                stem_buffer.channels = buffer.channels;
+                stem_buffer.layout = buffer.layout;
+                stem_buffer.samples.assign(frames * buffer.channels, 0.0f);
+                averaged.stems.emplace_back(name, std::move(stem_buffer));
+            }
+        }
+
+        for (std::size_t i = 0; i < part->stems.size() && i < averaged.stems.size(); ++i)
+        {
+            const auto& stem = part->stems[i].second;
+            auto& target = averaged.stems[i].second;
+            const auto available = std::min(frames, stem.frame_count() - std::min(offset, stem.frame_count()));
+            for (std::size_t ch = 0; ch < target.channels; ++ch)
+            {
+                for (std::size_t frame = 0; frame < available; ++frame)
+                {
+                    target.samples[target.index(frame, ch)] += stem.samples[stem.index(offset + frame, ch)];
+                }
+            }
+        }
+        if (recycle)
+        {
+            recycle(std::move(*part));
+        }
+    }
+
+    const auto scale = 1.0f / static_cast<float>(quality.shifts);
+    for (auto& [name, buffer] : averaged.stems)
+    {
+        for (auto& sample : buffer.samples)
+        {
+            sample *= scale;
+        }
+    }
+    return averaged;
+}
+
+/**
+ * @brief Pins the job's thread to the NUMA node running the fewest jobs until it finishes.
+ *
+ * Only the calling thread is re-pinned here; pass cpus() to compute_threads_scope so the job's
+ * OpenMP team follows it to the node.
+ */
+class node_lease
+{
+public:
+    node_lease(std::vector<std::atomic_size_t>& node_jobs, const std::vector<numa_node>& nodes)
+        : node_jobs_(node_jobs)
+        , index_(least_busy(node_jobs))
+        , cpus_(nodes[index_].cpus)
+        , affinity_(cpus_)
+    {
+        ++node_jobs_[index_];
+    }
+
+    ~node_lease()
+    {
+        --node_jobs_[index_];
+    }
+
+    node_lease(const node_lease&) = delete;
+    node_lease& operator=(const node_lease&) = delete;
+
+    [[nodiscard]] std::span<const int> cpus() const noexcept
+    {
+        return cpus_;
+    }
+
+private:
+    static std::size_t least_busy(const std::vector<std::atomic_size_t>& node_jobs)
+    {
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < node_jobs.size(); ++i)
+        {
+            if (node_jobs[i].load() < node_jobs[best].load())
+            {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    std::vector<std::atomic_size_t>& node_jobs_;
+    std::size_t index_;
+    std::span<const int> cpus_;
+    thread_affinity_scope affinity_;
+};
+
+/**
+ * @brief Tracks how many jobs are inside process() so segment lanes can be shared between them.
+ */
+class active_job_guard
+{
+public:
+    explicit active_job_guard(std::atomic_size_t& counter) : counter_(counter)
+    {
+        ++counter_;
+    }
+    ~active_job_guard()
+    {
+        --counter_;
+    }
+
+    active_job_guard(const active_job_guard&) = delete;
+    active_job_guard& operator=(const active_job_guard&) = delete;
+
+private:
+    std::atomic_size_t& counter_;
+};
 } // namespace
 
+// Quality only acts on stemsmith's own segmentation, so the serial path ignores the overlap scale
+// and draft costs the same as standard there.
+quality_settings settings_for(job_quality quality)
+{
+    switch (quality)
+    {
+    case job_quality::draft:
+        return {.overlap_scale = 0.25, .shifts = 1};
+    case job_quality::max:
+        return {.overlap_scale = 2.0, .shifts = 2};
+    case job_quality::standard:
+        break;
+    }
+    return {};
+}
+
+std::string output_settings_key(const engine_options& options)
+{
+    // Thread counts, slots and pinning only change how fast the same audio is produced.
+    std::string key;
+    for (const auto value : {options.segment_parallelism, options.max_batch_size})
+    {
+        key += std::to_string(value) + ';';
+    }
+    for (const auto value : {options.segment_seconds, options.segment_overlap_seconds, options.silence_threshold_db})
+    {
+        key += std::to_string(value) + ';';
+    }
+    key += options.streaming ? "streaming" : "buffered";
+    return key;
+}
+
 separation_engine::separation_engine(model_cache& cache,
                                      std::filesystem::path output_root,
                                      audio_loader loader,
-                                     audio_writer writer)
+                                     audio_writer writer,
+                                     engine_options options)
     : output_root_(std::move(output_root))
     , model_session_pool_(cache)
     , loader_(std::move(loader))
     , writer_(std::move(writer))
+    , options_(options)
+    , active_jobs_(std::make_unique<std::atomic_size_t>(0))
 {
+    if (const auto& nodes = system_cpu_topology().nodes; options_.numa_pinning && nodes.size() > 1)
+    {
+        node_pools_.reserve(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            node_pools_.emplace_back(cache);
+        }
+    }
+    if (options_.max_batch_size > 1)
+    {
+        batcher_ = std::make_unique<inference_batcher>(
+            inference_batcher::options{options_.max_batch_size, options_.max_batch_wait});
+    }
+    start_scheduler();
+    start_pipeline();
 }
 
 separation_engine::separation_engine(model_session_pool&& pool,
                                      std::filesystem::path output_root,
                                      audio_loader loader,
-                                     audio_writer writer)
+                                     audio_writer writer,
+                                     engine_options options)
     : output_root_(std::move(output_root))
     , model_session_pool_(std::move(pool))
     , loader_(std::move(loader))
     , writer_(std::move(writer))
+    , options_(options)
+    , active_jobs_(std::make_unique<std::atomic_size_t>(0))
 {
+    if (options_.max_batch_size > 1)
+    {
+        batcher_ = std::make_unique<inference_batcher>(
+            inference_batcher::options{options_.max_batch_size, options_.max_batch_wait});
+    }
+    start_scheduler();
+    start_pipeline();
 }
 
 std::expected<std::filesystem::path, std::string> separation_engine::process(const job_descriptor& job,
@@ -55,18 +344,6 @@ std::expected<std::filesystem::path, std::string> separation_engine::process(con
         return std::unexpected("No audio writer configured");
     }
 
-    auto audio = loader_(job.input_path);
-    if (!audio)
-    {
-        return std::unexpected(audio.error());
-    }
-
-    auto session_handle = model_session_pool_.acquire(job.config.profile);
-    if (!session_handle)
-    {
-        return std::unexpected(session_handle.error());
-    }
-
     std::vector<std::string_view> filter_views;
     if (!job.config.stems_filter.empty())
     {
@@ -83,7 +360,89 @@ std::expected<std::filesystem::path, std::string> separation_engine::process(con
         filter_span = {filter_views.data(), filter_views.size()};
     }
 
-    auto result = session_handle->get()->separate(*audio, filter_span, std::move(progress_cb));
+    if (options_.streaming)
+    {
+        active_job_guard active_guard(*active_jobs_);
+        std::optional<node_lease> node;
+        if (node_jobs_)
+        {
+            node.emplace(*node_jobs_, system_cpu_topology().nodes);
+        }
+        const compute_threads_scope compute_threads(compute_share(job.config, 1),
+                                                    node ? node->cpus() : std::span<const int>{});
+        return process_streaming(job, filter_span, progress_cb);
+    }
+
+    // Decode stage: runs before the job takes an inference slot, so slots never wait on disk.
+    auto audio = loader_(job.input_path, job.config.resampler.value_or(options_.resampler));
+    if (!audio)
+    {
+        return std::unexpected(audio.error());
+    }
+
+    const auto quality = settings_for(job.config.quality);
+    std::expected<separation_result, std::string> result;
+    model_session_pool::session_handle session; // held until the stems are written so their buffers can be recycled
+    {
+        std::optional<slot_gate::lease> slot;
+        if (inference_gate_)
+        {
+            if (progress_cb)
+            {
+                progress_cb(0.0f, "Waiting for inference");
+            }
+            slot.emplace(*inference_gate_);
+        }
+
+        active_job_guard active_guard(*active_jobs_);
+        std::optional<node_lease> node;
+        if (node_jobs_)
+        {
+            node.emplace(*node_jobs_, system_cpu_topology().nodes);
+        }
+        const compute_threads_scope compute_threads(compute_share(job.config, 1),
+                                                    node ? node->cpus() : std::span<const int>{});
+
+        // Silence detection works per segment, so it sends even single-lane jobs through the segmented path.
+        if (const auto lanes = segment_lanes(*audio); lanes > 1 || skips_silence())
+        {
+            result = separate_segmented(
+                *audio, job.config.profile, filter_span, lanes, compute_share(job.config, lanes), quality, progress_cb);
+        }
+        else if (batcher_)
+        {
+            result = separate_shifted(
+                *audio,
+                quality,
+                [&](const audio_buffer& input, demucscpp::ProgressCallback cb)
+                { return separate_batched(input, job.config.profile, filter_span, std::move(cb)); },
+                {},
+                progress_cb);
+        }
+        else
+        {
+            auto acquired = session_pool().acquire(job.config.profile);
+            if (!acquired)
+            {
+                return std::unexpected(acquired.error());
+            }
+            session = std::move(acquired.value());
+            result = separate_shifted(
+                *audio,
+                quality,
+                [&](const audio_buffer& input, demucscpp::ProgressCallback cb)
+                { return session->separate(input, filter_span, std::move(cb)); },
+                [&](separation_result&& part) { session->recycle(std::move(part)); },
+                progress_cb);
+        }
+
+        if (slot)
+        {
+            // Leaving the inference stage: the session serves the next job while this one is encoded.
+            session = {};
+        }
+    }
+
     if (!result)
     {
         return std::unexpected(result.error());
@@ -97,18 +456,546 @@ std::expected<std::filesystem::path, std::string> separation_engine::process(con
         return std::unexpected("Failed to create output directory: " + ec.message());
     }
 
-    for (auto& [stem_name, buffer] : result->stems)
+    if (auto written = write_stems(job_dir, *result, job.config.output); !written)
+    {
+        return std::unexpected(written.error());
+    }
+
+    if (session.get())
+    {
+        session->recycle(std::move(*result));
+    }
+
+    return job_dir;
+}
+
+std::expected<void, std::string> separation_engine::write_stems(const std::filesystem::path& job_dir,
+                                                                const separation_result& result,
+                                                                const output_encoding& encoding)
+{
+    if (!encoder_)
     {
-        const auto stem_path = job_dir / (stem_name + ".wav");
-        if (const auto status = writer_(stem_path, buffer); !status)
+        for (const auto& [stem_name, buffer] : result.stems)
+        {
+            const auto path = job_dir / stem_file_name(stem_name, encoding.format);
+            if (const auto status = writer_(path, buffer, encoding); !status)
+            {
+                return std::unexpected(status.error());
+            }
+        }
+        return {};
+    }
+
+    // Encode stage: stems are written concurrently on the shared encode pool.
+    std::vector<std::future<std::expected<void, std::string>>> writes;
+    writes.reserve(result.stems.size());
+    for (const auto& [stem_name, buffer] : result.stems)
+    {
+        writes.push_back(encoder_->submit([this, path = job_dir / stem_file_name(stem_name, encoding.format), &buffer,
+                                           encoding] { return writer_(path, buffer, encoding); }));
+    }
+
+    std::expected<void, std::string> status;
+    for (auto& write : writes)
+    {
+        // Wait for every write, even after a failure, because they all reference `result`.
+        if (auto written = write.get(); !written && status)
+        {
+            status = std::unexpected(written.error());
+        }
+    }
+    return status;
+}
+
+std::expected<std::filesystem::path, std::string> separation_engine::process_streaming(
+    const job_descriptor& job,
+    std::span<const std::string_view> stems,
+    const demucscpp::ProgressCallback& progress_cb)
+{
+    auto reader = audio_stream_reader::open(job.input_path, job.config.resampler.value_or(options_.resampler));
+    if (!reader)
+    {
+        return std::unexpected(reader.error());
+    }
+
+    std::optional<model_session_pool::session_handle> session; // leased on the first audible segment
+    const auto sample_rate = demucscpp::SUPPORTED_SAMPLE_RATE;
+    const auto segment_frames = std::max<std::size_t>(1, seconds_to_frames(options_.segment_seconds, sample_rate));
+    const auto quality = settings_for(job.config.quality);
+    const auto overlap_frames = overlap_for(options_, quality, segment_frames);
+    const auto advance_frames = segment_frames - overlap_frames;
+
+    // `window` is the segment being separated; `lookahead` tells whether another one follows.
+    audio_buffer window;
+    audio_buffer lookahead;
+    if (auto status = reader->read(window, segment_frames); !status)
+    {
+        return std::unexpected(status.error());
+    }
+    if (window.empty())
+    {
+        return std::unexpected("Input contains no audio");
+    }
+
+    auto job_dir = job_output_directory(output_root_, job);
+    std::error_code ec;
+    std::filesystem::create_directories(job_dir, ec);
+    if (ec)
+    {
+        return std::unexpected("Failed to create output directory: " + ec.message());
+    }
+
+    std::vector<stem_file_writer> writers;
+    std::vector<std::vector<float>> tails;       // crossfaded end of the previous segment, per stem
+    std::vector<std::vector<float>> interleaved; // reused encode buffers, per stem
+    const auto total_frames = std::max<std::size_t>(1, reader->frames_hint());
+    std::size_t offset = 0;
+    while (true)
+    {
+        if (auto status = reader->read(lookahead, advance_frames); !status)
         {
             return std::unexpected(status.error());
         }
+
+        const auto frames = window.frame_count();
+        const audio_segment segment{offset, frames, offset > 0, !lookahead.empty()};
+        const auto emit_frames = segment.fade_out ? frames - overlap_frames : frames;
+        demucscpp::ProgressCallback segment_cb;
+        if (progress_cb)
+        {
+            segment_cb = [&](float pct, const std::string& message)
+            {
+                const auto done = static_cast<float>(offset) + pct * static_cast<float>(emit_frames);
+                progress_cb(std::min(1.0f, done / static_cast<float>(total_frames)), message);
+            };
+        }
+
+        std::expected<separation_result, std::string> part;
+        if (skips_silence() && is_silent(window, {0, frames}, options_.silence_threshold_db))
+        {
+            part = silent_stems(window, job.config.profile, stems);
+        }
+        else
+        {
+            // When gated, each segment holds an inference slot only while it runs through the model.
+            std::optional<slot_gate::lease> slot;
+            if (inference_gate_)
+            {
+                slot.emplace(*inference_gate_);
+            }
+            if (!session)
+            {
+                auto acquired = session_pool().acquire(job.config.profile);
+                if (!acquired)
+                {
+                    return std::unexpected(acquired.error());
+                }
+                session = std::move(acquired.value());
+            }
+            part = separate_shifted(
+                window,
+                quality,
+                [&](const audio_buffer& input, demucscpp::ProgressCallback cb)
+                { return (*session)->separate(input, stems, std::move(cb)); },
+                [&](separation_result&& result) { (*session)->recycle(std::move(result)); },
+                segment_cb);
+            if (slot)
+            {
+                session.reset(); // let the slot's next holder take the session while this segment is written
+            }
+        }
+        if (!part)
+        {
+            return std::unexpected(part.error());
+        }
+
+        if (writers.empty())
+        {
+            writers.reserve(part->stems.size());
+            tails.resize(part->stems.size());
+            interleaved.resize(part->stems.size());
+            for (const auto& [stem_name, buffer] : part->stems)
+            {
+                auto writer = stem_file_writer::create(job_dir / stem_file_name(stem_name, job.config.output.format),
+                                                       buffer.sample_rate,
+                                                       buffer.channels,
+                                                       job.config.output);
+                if (!writer)
+                {
+                    return std::unexpected(writer.error());
+                }
+                writers.push_back(std::move(writer.value()));
+            }
+        }
+
+        for (std::size_t i = 0; i < part->stems.size() && i < writers.size(); ++i)
+        {
+            // The stream writer takes interleaved frames, so this is where planar model output gets interleaved.
+            const auto& stem = part->stems[i].second;
+            const auto channels = stem.channels;
+            auto& samples = interleaved[i];
+            samples.resize(stem.samples.size());
+            if (stem.layout == sample_layout::planar)
+            {
+                interleave(stem.samples, channels, samples);
+            }
+            else
+            {
+                std::copy(stem.samples.begin(), stem.samples.end(), samples.begin());
+            }
+            for (std::size_t frame = 0; frame < frames; ++frame)
+            {
+                const auto weight = crossfade_weight(segment, frame, overlap_frames);
+                for (std::size_t ch = 0; ch < channels; ++ch)
+                {
+                    samples[frame * channels + ch] *= weight;
+                }
+            }
+
+            if (segment.fade_in)
+            {
+                for (std::size_t k = 0; k < tails[i].size(); ++k)
+                {
+                    samples[k] += tails[i][k];
+                }
+            }
+
+            if (auto status = writers[i].append({samples.data(), emit_frames * channels}); !status)
+            {
+                return std::unexpected(status.error());
+            }
+            tails[i].assign(samples.begin() + static_cast<std::ptrdiff_t>(emit_frames * channels), samples.end());
+        }
+        if (session)
+        {
+            (*session)->recycle(std::move(*part));
+        }
+
+        if (progress_cb)
+        {
+            const auto done = static_cast<float>(offset + emit_frames) / static_cast<float>(total_frames);
+            progress_cb(std::min(1.0f, done), "Segment written");
+        }
+
+        if (lookahead.empty())
+        {
+            break;
+        }
+
+        // Slide: keep the overlap of the current window and append the freshly read frames.
+        offset += frames - overlap_frames;
+        window.samples.erase(window.samples.begin(),
+                             window.samples.end() - static_cast<std::ptrdiff_t>(overlap_frames * window.channels));
+        window.samples.insert(window.samples.end(), lookahead.samples.begin(), lookahead.samples.end());
     }
 
+    for (auto& writer : writers)
+    {
+        if (auto status = writer.finalize(); !status)
+        {
+            return std::unexpected(status.error());
+        }
+    }
+
+    if (progress_cb)
+    {
+        progress_cb(1.0f, "Streaming complete");
+    }
     return job_dir;
 }
 
+std::size_t separation_engine::compute_share(const job_template& config, std::size_t lanes) const
+{
+    lanes = std::max<std::size_t>(1, lanes);
+    const auto budget = config.threads > 0 ? config.threads : options_.threads_per_job;
+    if (budget > 0)
+    {
+        return std::max<std::size_t>(1, std::min(budget, compute_threads_) / lanes);
+    }
+
+    const auto active = std::max<std::size_t>(1, active_jobs_->load());
+    return std::max<std::size_t>(1, compute_threads_ / active / lanes);
+}
+
+std::size_t separation_engine::segment_lanes(const audio_buffer& audio) const
+{
+    // Batching needs concurrent submitters, so a long track gets at least one lane per batch slot.
+    const auto budget = batcher_ ? std::max(options_.segment_parallelism, options_.max_batch_size)
+                                 : options_.segment_parallelism;
+    if (budget <= 1)
+    {
+        return 1;
+    }
+
+    const auto segment_frames = seconds_to_frames(options_.segment_seconds, audio.sample_rate);
+    if (segment_frames == 0 || audio.frame_count() <= segment_frames)
+    {
+        return 1;
+    }
+
+    // Lanes are a per-engine budget: concurrent jobs split them instead of oversubscribing the cores.
+    const auto active = std::max<std::size_t>(1, active_jobs_->load());
+    return std::max<std::size_t>(1, budget / active);
+}
+
+std::expected<separation_result, std::string> separation_engine::separate_segmented(
+    const audio_buffer& audio,
+    model_profile_id profile,
+    std::span<const std::string_view> stems,
+    std::size_t lanes,
+    std::size_t threads_per_lane,
+    const quality_settings& quality,
+    const demucscpp::ProgressCallback& progress_cb)
+{
+    const auto segment_frames = seconds_to_frames(options_.segment_seconds, audio.sample_rate);
+    const auto overlap_frames = overlap_for(options_, quality, segment_frames);
+    const auto segments = plan_segments(audio.frame_count(), segment_frames, overlap_frames);
+    lanes = std::min(lanes, segments.size());
+
+    std::mutex merge_mutex;
+    separation_result merged;
+    std::vector<float> segment_progress(segments.size(), 0.0f);
+    std::atomic_size_t next_segment{0};
+    std::atomic_bool failed{false};
+    std::optional<std::string> error;
+    std::exception_ptr exception;
+
+    const auto report = [&](std::size_t index, float pct, const std::string& message)
+    {
+        // Caller holds merge_mutex so progress callbacks never run concurrently.
+        segment_progress[index] = pct;
+        if (progress_cb)
+        {
+            const auto total = std::accumulate(segment_progress.begin(), segment_progress.end(), 0.0f);
+            progress_cb(total / static_cast<float>(segments.size()), message);
+        }
+    };
+
+    const auto fail = [&](std::string message)
+    {
+        std::lock_guard lock(merge_mutex);
+        if (!error && !exception)
+        {
+            error = std::move(message);
+        }
+        failed = true;
+    };
+
+    const auto run_lane = [&]
+    {
+        try
+        {
+            const compute_threads_scope compute_threads(threads_per_lane);
+            std::optional<model_session_pool::session_handle> session; // leased on the first audible segment
+
+            for (auto index = next_segment++; index < segments.size() && !failed; index = next_segment++)
+            {
+                const auto& segment = segments[index];
+                demucscpp::ProgressCallback segment_cb = [&, index](float pct, const std::string& message)
+                {
+                    std::lock_guard lock(merge_mutex);
+                    report(index, pct, message);
+                };
+
+                if (skips_silence() && is_silent(audio, segment, options_.silence_threshold_db))
+                {
+                    // The merged stems start zeroed, so a silent segment only has to make sure they exist;
+                    // its neighbours' crossfade weights still fade them into and out of the silence.
+                    std::lock_guard lock(merge_mutex);
+                    if (merged.stems.empty())
+                    {
+                        auto zeros = silent_stems(audio, profile, stems);
+                        if (!zeros)
+                        {
+                            error = error ? error : zeros.error();
+                            failed = true;
+                            return;
+                        }
+                        merged = std::move(zeros.value());
+                    }
+                    report(index, 1.0f, "Silent segment skipped");
+                    continue;
+                }
+
+                if (!session && !batcher_)
+                {
+                    auto acquired = session_pool().acquire(profile);
+                    if (!acquired)
+                    {
+                        fail(acquired.error());
+                        return;
+                    }
+                    session = std::move(acquired.value());
+                }
+
+                const auto segment_audio = slice_segment(audio, segment);
+                auto part = separate_shifted(
+                    segment_audio,
+                    quality,
+                    [&](const audio_buffer& input, demucscpp::ProgressCallback cb)
+                    {
+                        return session ? (*session)->separate(input, stems, std::move(cb))
+                                       : separate_batched(input, profile, stems, std::move(cb));
+                    },
+                    [&](separation_result&& result)
+                    {
+                        if (session)
+                        {
+                            (*session)->recycle(std::move(result));
+                        }
+                    },
+                    segment_cb);
+                if (!part)
+                {
+                    fail(part.error());
+                    return;
+                }
+
+                std::lock_guard lock(merge_mutex);
+                if (merged.stems.empty())
+                {
+                    for (const auto& [name, buffer] : part->stems)
+                    {
+                        audio_buffer stem_buffer;
+                        stem_buffer.sample_rate = buffer.sample_rate;
+                        stem_buffer.channels = buffer.channels;
+                        stem_buffer.layout = buffer.layout;
+                        stem_buffer.samples.assign(audio.frame_count() * buffer.channels, 0.0f);
+                        merged.stems.emplace_back(name, std::move(stem_buffer));
+                    }
+                }
+
+                for (std::size_t i = 0; i < part->stems.size() && i < merged.stems.size(); ++i)
+                {
+                    overlap_add(merged.stems[i].second, part->stems[i].second, segment, overlap_frames);
+                }
+                report(index, 1.0f, "Segment complete");
+                if (session)
+                {
+                    (*session)->recycle(std::move(*part));
+                }
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard lock(merge_mutex);
+            if (!exception)
+            {
+                exception = std::current_exception();
+            }
+            failed = true;
+        }
+    };
+
+    // The job's thread runs one lane itself; the others are picked up by idle scheduler threads.
+    if (lanes > 1 && scheduler_)
+    {
+        scheduler_->parallel_for(lanes, lanes, [&](std::size_t) { run_lane(); });
+    }
+    else
+    {
+        run_lane();
+    }
+
+    // Cancellation is signalled by throwing from the progress callback; surface it on the job's thread.
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+
+    if (error)
+    {
+        return std::unexpected(*error);
+    }
+
+    return merged;
+}
+
+std::expected<separation_result, std::string> separation_engine::separate_batched(
+    const audio_buffer& audio,
+    model_profile_id profile,
+    std::span<const std::string_view> stems,
+    demucscpp::ProgressCallback progress_cb)
+{
+    return batcher_->separate(session_pool(), profile, audio, stems, std::move(progress_cb));
+}
+
+std::expected<void, std::string> separation_engine::warm_up(model_profile_id profile, std::size_t session_count)
+{
+    if (node_pools_.empty())
+    {
+        return model_session_pool_.warm(profile, session_count);
+    }
+
+    // Load each node's weights from a thread on that node so first-touch places them node-local.
+    const auto& nodes = system_cpu_topology().nodes;
+    std::vector<std::expected<void, std::string>> results(node_pools_.size());
+    std::vector<std::thread> loaders;
+    loaders.reserve(node_pools_.size());
+    for (std::size_t i = 0; i < node_pools_.size(); ++i)
+    {
+        loaders.emplace_back(
+            [&, i]()
+            {
+                pin_current_thread(nodes[i].cpus);
+                results[i] = node_pools_[i].warm(profile, session_count);
+            });
+    }
+    for (auto& loader : loaders)
+    {
+        loader.join();
+    }
+
+    for (auto& result : results)
+    {
+        if (!result)
+        {
+            return result;
+        }
+    }
+    return {};
+}
+
+model_session_pool& separation_engine::session_pool()
+{
+    if (node_pools_.empty())
+    {
+        return model_session_pool_;
+    }
+    return node_pools_[std::min(current_node_index(), node_pools_.size() - 1)];
+}
+
+void separation_engine::start_scheduler()
+{
+    compute_threads_ = std::max<std::size_t>(1, compute_budget(options_));
+    const auto& nodes = system_cpu_topology().nodes;
+    std::function<void(std::size_t)> on_thread_start;
+    if (options_.numa_pinning && nodes.size() > 1)
+    {
+        node_jobs_ = std::make_unique<std::vector<std::atomic_size_t>>(nodes.size());
+        on_thread_start = [&nodes](std::size_t index) { pin_current_thread(nodes[index % nodes.size()].cpus); };
+    }
+
+    // Only segment lanes run on the scheduler; segment_lanes() never exceeds one without this budget.
+    if (std::max(options_.segment_parallelism, options_.max_batch_size) > 1)
+    {
+        scheduler_ = std::make_unique<task_scheduler>(compute_threads_, std::move(on_thread_start));
+    }
+}
+
+void separation_engine::start_pipeline()
+{
+    if (options_.inference_slots > 0)
+    {
+        inference_gate_ = std::make_unique<slot_gate>(options_.inference_slots);
+    }
+    if (options_.encode_threads > 0)
+    {
+        // Two queued writes per thread keep the encoders busy without buffering whole jobs.
+        encoder_ = std::make_unique<stage_pool>(options_.encode_threads, 2 * options_.encode_threads);
+    }
+}
+
 std::filesystem::path separation_engine::fallback_output_dir(const std::filesystem::path& input) const
 {
     return output_root_ / input.stem();
@@ -1,52 +1,185 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <expected>
 #include <filesystem>
 #include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
 
 #include "audio_buffer.h"
 #include "audio_io.h"
+#include "cpu_topology.h"
+#include "inference_batcher.h"
 #include "job_catalog.h"
 #include "model_cache.h"
 #include "model_session_pool.h"
+#include "stage_pool.h"
+#include "stemsmith/job_config.h"
+#include "task_scheduler.h"
 
 namespace stemsmith
 {
 
+/**
+ * @brief Tuning knobs for how a single job is spread over the session pool.
+ *
+ * With `segment_parallelism` above one, tracks longer than `segment_seconds` are split into
+ * overlapping segments that run on separate pooled sessions and are stitched back together with a
+ * linear crossfade. The available lanes are shared between concurrently running jobs, so a busy
+ * engine falls back to the serial path.
+ *
+ * With `max_batch_size` above one, forward passes of the same profile (segments of one job or
+ * concurrent jobs) are coalesced into batches of up to that size, waiting at most `max_batch_wait`
+ * for a batch to fill. Long tracks are then segmented into at least `max_batch_size` lanes. This only
+ * pays off with sessions that carry a batch_inference_function; without one the entries of a batch
+ * run back-to-back and the wait is pure latency. demucs.cpp has no batched kernel yet, so the service
+ * and stemsmithd do not expose batching.
+ *
+ * With `streaming` set, the input is decoded, separated and written one segment at a time, so peak
+ * memory depends on `segment_seconds` rather than track length. Stems are appended to their WAV
+ * files as segments finish; the injected loader and writer are bypassed on that path.
+ *
+ * All compute shares one budget of `compute_threads` (0 uses every hardware thread): segment lanes
+ * run on the engine's work-stealing task_scheduler (started only when `segment_parallelism` or
+ * `max_batch_size` is above one), and each job's OpenMP team inside Demucs is
+ * capped at its share of the budget, which shrinks as more jobs become active. A job with its own
+ * thread budget (job_template::threads, else `threads_per_job`) gets that many threads instead,
+ * still capped at `compute_threads`. The default budget follows the process' cpuset and cgroup
+ * `cpu.max` quota rather than the host's CPU count.
+ *
+ * With `numa_pinning` on a multi-node host, scheduler threads are spread over the NUMA nodes, each
+ * job thread is pinned to the least busy node while it runs, and every node gets its own session
+ * pool whose weights are loaded (and therefore first touched) by a thread on that node.
+ *
+ * With `inference_slots` set, process() runs as a three-stage pipeline: the input is decoded on the
+ * calling job thread before it competes for one of the inference slots, and once separation is done
+ * the slot is released before the stems are written. With `encode_threads` set, those writes go to
+ * a shared, bounded encode pool so stems of one job are written concurrently. Running more job
+ * threads than slots lets queued jobs decode while others occupy the models.
+ */
+struct engine_options
+{
+    std::size_t segment_parallelism{1};
+    double segment_seconds{30.0};
+    double segment_overlap_seconds{1.0};
+    std::size_t max_batch_size{1};
+    std::chrono::milliseconds max_batch_wait{5};
+    bool streaming{false};
+    std::size_t compute_threads{0};
+    std::size_t threads_per_job{0}; // budget for jobs that do not set job_template::threads; 0 -> fair share
+    resample_quality resampler{resample_quality::best}; // for jobs that do not set job_template::resampler
+    bool numa_pinning{false};
+    double silence_threshold_db{0.0}; // segments whose block RMS stays below this (dBFS) skip inference; 0 -> off
+    std::size_t inference_slots{0};   // jobs allowed to run inference at once; 0 -> ungated
+    std::size_t encode_threads{0};    // threads writing stems; 0 -> written serially on the job thread
+};
+
+/**
+ * @brief How a ::stemsmith::job_quality translates into engine work.
+ *
+ * demucs.cpp fixes the overlap and shifts of its internal chunking, so quality acts on
+ * stemsmith's own segmentation: the crossfade width between segments and the number of
+ * time-shifted passes averaged per segment.
+ */
+struct quality_settings
+{
+    double overlap_scale{1.0}; // multiplies engine_options::segment_overlap_seconds
+    std::size_t shifts{1};     // passes offset by up to max_shift_seconds, averaged
+    double max_shift_seconds{0.5};
+};
+
+[[nodiscard]] quality_settings settings_for(job_quality quality);
+
+// The engine_options that change the separated audio (segmentation, streaming, silence skipping),
+// serialised so result_cache keys differ between engines configured differently.
+[[nodiscard]] std::string output_settings_key(const engine_options& options);
+
 class separation_engine
 {
 public:
-    using audio_loader = std::function<std::expected<audio_buffer, std::string>(const std::filesystem::path&)>;
-    using audio_writer =
-        std::function<std::expected<void, std::string>(const std::filesystem::path&, const audio_buffer&)>;
+    using audio_loader =
+        std::function<std::expected<audio_buffer, std::string>(const std::filesystem::path&, resample_quality)>;
+    using audio_writer = std::function<
+        std::expected<void, std::string>(const std::filesystem::path&, const audio_buffer&, const output_encoding&)>;
 
     separation_engine(
         model_cache& cache,
         std::filesystem::path output_root,
         audio_loader loader = load_audio_file,
-        audio_writer writer = [](const std::filesystem::path& path, const audio_buffer& buffer)
-        { return write_audio_file(path, buffer); });
+        audio_writer writer = write_audio_file,
+        engine_options options = {});
 
     separation_engine(model_session_pool&& pool,
                       std::filesystem::path output_root,
                       audio_loader loader,
-                      audio_writer writer);
+                      audio_writer writer,
+                      engine_options options = {});
 
     [[nodiscard]] std::expected<std::filesystem::path, std::string> process(
         const job_descriptor& job,
         demucscpp::ProgressCallback progress_cb = {});
 
+    [[nodiscard]] std::expected<void, std::string> warm_up(model_profile_id profile, std::size_t session_count);
+
     [[nodiscard]] const std::filesystem::path& output_root() const noexcept
     {
         return output_root_;
     }
     [[nodiscard]] std::filesystem::path fallback_output_dir(const std::filesystem::path& input) const;
 
+    [[nodiscard]] const engine_options& options() const noexcept
+    {
+        return options_;
+    }
+
 private:
+    [[nodiscard]] std::expected<std::filesystem::path, std::string> process_streaming(
+        const job_descriptor& job,
+        std::span<const std::string_view> stems,
+        const demucscpp::ProgressCallback& progress_cb);
+    [[nodiscard]] std::size_t segment_lanes(const audio_buffer& audio) const;
+    [[nodiscard]] std::size_t compute_share(const job_template& config, std::size_t lanes) const;
+    [[nodiscard]] bool skips_silence() const noexcept
+    {
+        return options_.silence_threshold_db < 0.0;
+    }
+    [[nodiscard]] std::expected<void, std::string> write_stems(const std::filesystem::path& job_dir,
+                                                               const separation_result& result,
+                                                               const output_encoding& encoding);
+    [[nodiscard]] model_session_pool& session_pool();
+    void start_scheduler();
+    void start_pipeline();
+    [[nodiscard]] std::expected<separation_result, std::string> separate_segmented(
+        const audio_buffer& audio,
+        model_profile_id profile,
+        std::span<const std::string_view> stems,
+        std::size_t lanes,
+        std::size_t threads_per_lane,
+        const quality_settings& quality,
+        const demucscpp::ProgressCallback& progress_cb);
+    [[nodiscard]] std::expected<separation_result, std::string> separate_batched(
+        const audio_buffer& audio,
+        model_profile_id profile,
+        std::span<const std::string_view> stems,
+        demucscpp::ProgressCallback progress_cb);
+
     std::filesystem::path output_root_;
     model_session_pool model_session_pool_;
+    std::vector<model_session_pool> node_pools_; // one per NUMA node when pinning is enabled
     audio_loader loader_;
     audio_writer writer_;
+    engine_options options_;
+    std::unique_ptr<std::atomic_size_t> active_jobs_; // heap-allocated so the engine stays movable
+    std::unique_ptr<inference_batcher> batcher_;      // only when batching is enabled
+    std::size_t compute_threads_{1};                  // the compute budget shared by all jobs
+    std::unique_ptr<task_scheduler> scheduler_;       // only when segments can run on parallel lanes
+    std::unique_ptr<std::vector<std::atomic_size_t>> node_jobs_; // running jobs per NUMA node
+    std::unique_ptr<slot_gate> inference_gate_;                  // only when inference_slots is set
+    std::unique_ptr<stage_pool> encoder_;                        // only when encode_threads is set
 };
 
 } // namespace stemsmith
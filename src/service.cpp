@@ -1,6 +1,7 @@
 #include <memory>
 #include <system_error>
 
+#include "cpu_topology.h"
 #include "http_weight_fetcher.h"
 #include "job_runner.h"
 #include "model_cache.h"
@@ -15,7 +16,13 @@ service::service(std::shared_ptr<model_cache> cache, std::unique_ptr<job_runner>
 {
 }
 
-service::~service() = default;
+service::~service()
+{
+    if (warmup_thread_.joinable())
+    {
+        warmup_thread_.join();
+    }
+}
 
 std::expected<job_handle, std::string> service::submit(job_request request) const
 {
@@ -42,6 +49,43 @@ std::expected<void, std::string> service::purge_models(std::optional<model_profi
     return cache_->purge_all();
 }
 
+bool service::ready() const noexcept
+{
+    return ready_.load();
+}
+
+std::optional<std::string> service::warmup_error() const
+{
+    std::lock_guard lock(warmup_mutex_);
+    return warmup_error_;
+}
+
+std::expected<void, std::string> service::warm_up(const runtime_config::warmup_config& warmup, std::size_t worker_count)
+{
+    const auto sessions = warmup.sessions_per_profile == 0 ? worker_count : warmup.sessions_per_profile;
+    for (const auto profile : warmup.profiles)
+    {
+        if (auto status = runner_->warm_up(profile, sessions); !status)
+        {
+            std::lock_guard lock(warmup_mutex_);
+            warmup_error_ = status.error();
+            return std::unexpected(status.error());
+        }
+    }
+
+    ready_ = true;
+    return {};
+}
+
+std::optional<result_cache_stats> service::result_cache_usage() const
+{
+    if (!runner_)
+    {
+        return std::nullopt;
+    }
+    return runner_->result_cache_usage();
+}
+
 std::expected<model_handle, std::string> service::ensure_model_ready(model_profile_id profile) const
 {
     if (!cache_)
@@ -64,6 +108,11 @@ std::expected<std::unique_ptr<service>, std::string> service::create(runtime_con
         return std::unexpected("output_root is required");
     }
 
+    if (runtime.worker_count == 0)
+    {
+        runtime.worker_count = system_cpu_topology().usable_threads();
+    }
+
     if (!runtime.cache.fetcher)
     {
         runtime.cache.fetcher = std::make_shared<http_weight_fetcher>();
@@ -91,13 +140,53 @@ std::expected<std::unique_ptr<service>, std::string> service::create(runtime_con
 
     auto cache_ptr = std::make_shared<model_cache>(std::move(cache_result.value()));
 
+    std::shared_ptr<result_cache> results;
+    if (!runtime.results.root.empty())
+    {
+        results = std::make_shared<result_cache>(runtime.results.root, runtime.results.max_bytes);
+    }
+
+    // Extra job threads decode ahead; the inference gate keeps model concurrency at worker_count.
+    const auto decode_ahead = runtime.pipeline.decode_ahead;
+    const std::size_t inference_slots = decode_ahead > 0 ? runtime.worker_count : 0;
     auto runner = std::make_unique<job_runner>(*cache_ptr,
                                                runtime.output_root,
                                                defaults,
-                                               runtime.worker_count,
-                                               std::move(runtime.on_job_event));
+                                               runtime.worker_count + decode_ahead,
+                                               std::move(runtime.on_job_event),
+                                               engine_options{.segment_parallelism = runtime.segment_parallelism,
+                                                              .streaming = runtime.streaming,
+                                                              .compute_threads = runtime.compute_threads,
+                                                              .threads_per_job = runtime.threads_per_job,
+                                                              .resampler = runtime.resampler,
+                                                              .numa_pinning = runtime.numa_pinning,
+                                                              .silence_threshold_db = runtime.silence_threshold_db,
+                                                              .inference_slots = inference_slots,
+                                                              .encode_threads = runtime.pipeline.encode_threads},
+                                               std::move(results),
+                                               runtime.coalesce_jobs);
+
+    auto svc = std::unique_ptr<service>(new service(std::move(cache_ptr), std::move(runner)));
+    if (runtime.warmup.profiles.empty())
+    {
+        return svc;
+    }
+
+    svc->ready_ = false;
+    if (runtime.warmup.background)
+    {
+        svc->warmup_thread_ =
+            std::thread([raw = svc.get(), warmup = std::move(runtime.warmup), workers = runtime.worker_count]
+                        { (void)raw->warm_up(warmup, workers); });
+        return svc;
+    }
+
+    if (auto status = svc->warm_up(runtime.warmup, runtime.worker_count); !status)
+    {
+        return std::unexpected("Model warm-up failed: " + status.error());
+    }
 
-    return std::unique_ptr<service>(new service(std::move(cache_ptr), std::move(runner)));
+    return svc;
 }
 
 } // namespace stemsmith
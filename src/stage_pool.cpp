@@ -0,0 +1,87 @@
+#include "stage_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace stemsmith
+{
+
+stage_pool::stage_pool(std::size_t thread_count, std::size_t capacity) : capacity_(std::max<std::size_t>(1, capacity))
+{
+    thread_count = std::max<std::size_t>(1, thread_count);
+    threads_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        threads_.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+stage_pool::~stage_pool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void stage_pool::push(std::function<void()> task)
+{
+    {
+        std::unique_lock lock(mutex_);
+        not_full_.wait(lock, [this] { return stopping_ || tasks_.size() < capacity_; });
+        tasks_.push_back(std::move(task));
+    }
+    not_empty_.notify_one();
+}
+
+void stage_pool::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            not_empty_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty())
+            {
+                return; // stopping and drained
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        not_full_.notify_one();
+        task();
+    }
+}
+
+slot_gate::slot_gate(std::size_t slots) : slots_(std::max<std::size_t>(1, slots)) {}
+
+slot_gate::lease::lease(slot_gate& gate) : gate_(&gate)
+{
+    std::unique_lock lock(gate_->mutex_);
+    gate_->released_.wait(lock, [this] { return gate_->in_use_ < gate_->slots_; });
+    ++gate_->in_use_;
+}
+
+slot_gate::lease::~lease()
+{
+    {
+        std::lock_guard lock(gate_->mutex_);
+        --gate_->in_use_;
+    }
+    gate_->released_.notify_one();
+}
+
+std::size_t slot_gate::in_use() const
+{
+    std::lock_guard lock(mutex_);
+    return in_use_;
+}
+
+} // namespace stemsmith
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace stemsmith
+{
+
+/**
+ * @brief Fixed threads serving one pipeline stage from a bounded FIFO.
+ *
+ * submit() blocks while `capacity` tasks are already waiting, so a stage that falls behind slows
+ * down the stage feeding it instead of buffering without limit.
+ */
+class stage_pool
+{
+public:
+    stage_pool(std::size_t thread_count, std::size_t capacity);
+    ~stage_pool();
+
+    stage_pool(const stage_pool&) = delete;
+    stage_pool& operator=(const stage_pool&) = delete;
+    stage_pool(stage_pool&&) = delete;
+    stage_pool& operator=(stage_pool&&) = delete;
+
+    template <typename Task>
+    [[nodiscard]] std::future<std::invoke_result_t<Task>> submit(Task task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<Task>()>>(std::move(task));
+        auto future = packaged->get_future();
+        push([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    [[nodiscard]] std::size_t thread_count() const noexcept
+    {
+        return threads_.size();
+    }
+
+private:
+    void push(std::function<void()> task);
+    void worker_loop();
+
+    std::size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopping_{false};
+};
+
+/**
+ * @brief Counting gate that limits how many jobs occupy a stage at once.
+ */
+class slot_gate
+{
+public:
+    explicit slot_gate(std::size_t slots);
+
+    /**
+     * @brief Holds one slot for its lifetime; blocks on construction until a slot is free.
+     */
+    class lease
+    {
+    public:
+        explicit lease(slot_gate& gate);
+        ~lease();
+
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+
+    private:
+        slot_gate* gate_;
+    };
+
+    [[nodiscard]] std::size_t in_use() const;
+
+private:
+    std::size_t slots_;
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    std::size_t in_use_{0};
+};
+
+} // namespace stemsmith
@@ -0,0 +1,236 @@
+#include "task_scheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <utility>
+
+#include "cpu_topology.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace stemsmith
+{
+
+namespace
+{
+constexpr auto kNoWorker = std::numeric_limits<std::size_t>::max();
+
+// Index of the scheduler thread running on this OS thread, so nested submissions stay local.
+thread_local const task_scheduler* current_scheduler = nullptr;
+thread_local std::size_t current_worker = kNoWorker;
+} // namespace
+
+task_scheduler::task_scheduler(std::size_t thread_count, std::function<void(std::size_t)> on_thread_start)
+{
+    thread_count = std::max<std::size_t>(1, thread_count);
+    queues_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        queues_.push_back(std::make_unique<worker_queue>());
+    }
+
+    threads_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+    {
+        threads_.emplace_back(
+            [this, i, on_thread_start]()
+            {
+                if (on_thread_start)
+                {
+                    on_thread_start(i);
+                }
+                worker_loop(i);
+            });
+    }
+}
+
+task_scheduler::~task_scheduler()
+{
+    {
+        std::lock_guard lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void task_scheduler::submit(std::function<void()> task)
+{
+    const auto target = current_scheduler == this ? current_worker : next_queue_++ % queues_.size();
+    {
+        std::lock_guard lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard lock(wake_mutex_);
+        ++pending_;
+    }
+    wake_.notify_one();
+}
+
+void task_scheduler::parallel_for(std::size_t count,
+                                  std::size_t parallelism,
+                                  const std::function<void(std::size_t)>& body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    struct shared_state
+    {
+        const std::function<void(std::size_t)>* body{};
+        std::size_t count{};
+        std::atomic_size_t next{0};
+        std::mutex mutex;
+        std::condition_variable idle;
+        std::size_t active_helpers{0};
+        bool closed{false};
+        std::exception_ptr error;
+
+        void drain()
+        {
+            for (auto index = next++; index < count; index = next++)
+            {
+                try
+                {
+                    (*body)(index);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                    next = count;
+                }
+            }
+        }
+    };
+
+    const auto state = std::make_shared<shared_state>();
+    state->body = &body;
+    state->count = count;
+
+    const auto helpers = std::min(parallelism, count) - std::min<std::size_t>(1, parallelism);
+    for (std::size_t i = 0; i < helpers; ++i)
+    {
+        submit(
+            [state]()
+            {
+                {
+                    // Helpers that start after the caller finished must not touch `body` any more.
+                    std::lock_guard lock(state->mutex);
+                    if (state->closed)
+                    {
+                        return;
+                    }
+                    ++state->active_helpers;
+                }
+                state->drain();
+                {
+                    std::lock_guard lock(state->mutex);
+                    --state->active_helpers;
+                }
+                state->idle.notify_all();
+            });
+    }
+
+    state->drain();
+
+    std::unique_lock lock(state->mutex);
+    state->closed = true;
+    state->idle.wait(lock, [&] { return state->active_helpers == 0; });
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+bool task_scheduler::try_run_one(std::size_t self)
+{
+    std::function<void()> task;
+    for (std::size_t offset = 0; offset < queues_.size() && !task; ++offset)
+    {
+        auto& queue = *queues_[(self + offset) % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+        // Own queue: newest first (cache-warm); other queues: steal the oldest.
+        if (offset == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+    {
+        return false;
+    }
+
+    --pending_;
+    task();
+    return true;
+}
+
+void task_scheduler::worker_loop(std::size_t index)
+{
+    current_scheduler = this;
+    current_worker = index;
+    while (true)
+    {
+        if (try_run_one(index))
+        {
+            continue;
+        }
+
+        std::unique_lock lock(wake_mutex_);
+        wake_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+        if (stopping_ && pending_ == 0)
+        {
+            return;
+        }
+    }
+}
+
+compute_threads_scope::compute_threads_scope(std::size_t threads, std::span<const int> cpus)
+{
+#ifdef _OPENMP
+    previous_ = omp_get_max_threads();
+    const auto team = static_cast<int>(std::max<std::size_t>(1, threads));
+    omp_set_num_threads(team);
+    if (!cpus.empty())
+    {
+        // Runs once on every member of the team the job's regions will reuse, including this thread.
+#pragma omp parallel num_threads(team)
+        pin_current_thread(cpus);
+    }
+#else
+    (void)threads;
+    (void)cpus;
+#endif
+}
+
+compute_threads_scope::~compute_threads_scope()
+{
+#ifdef _OPENMP
+    omp_set_num_threads(previous_);
+#endif
+}
+
+} // namespace stemsmith
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace stemsmith
+{
+
+/**
+ * @brief Work-stealing pool of compute threads shared by every job of an engine.
+ *
+ * Each thread owns a deque: it pops its own newest task and steals the oldest task of another
+ * thread when idle. parallel_for lets the calling thread take part, so nested calls from a task
+ * always make progress even when every scheduler thread is busy.
+ */
+class task_scheduler
+{
+public:
+    // `on_thread_start` runs first on each scheduler thread with its index (e.g. to pin it to a NUMA node).
+    explicit task_scheduler(std::size_t thread_count = std::thread::hardware_concurrency(),
+                            std::function<void(std::size_t)> on_thread_start = {});
+    ~task_scheduler();
+
+    task_scheduler(const task_scheduler&) = delete;
+    task_scheduler& operator=(const task_scheduler&) = delete;
+    task_scheduler(task_scheduler&&) = delete;
+    task_scheduler& operator=(task_scheduler&&) = delete;
+
+    [[nodiscard]] std::size_t thread_count() const noexcept
+    {
+        return threads_.size();
+    }
+
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Runs body(0) .. body(count - 1) with at most `parallelism` invocations in flight.
+     *
+     * The calling thread runs iterations too and returns once all of them have finished. The first
+     * exception thrown by `body` stops the remaining iterations and is rethrown here.
+     */
+    void parallel_for(std::size_t count, std::size_t parallelism, const std::function<void(std::size_t)>& body);
+
+private:
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    [[nodiscard]] bool try_run_one(std::size_t self);
+    void worker_loop(std::size_t index);
+
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic_size_t pending_{0};
+    std::atomic_size_t next_queue_{0};
+    bool stopping_{false};
+};
+
+/**
+ * @brief Caps OpenMP regions started on the current thread (Demucs' inner loops) for its lifetime.
+ *
+ * OpenMP keeps the team size per thread, so each job thread and segment lane gets its own share of
+ * the compute budget instead of every region spawning a full hardware-sized team. No-op without OpenMP.
+ *
+ * With `cpus` given, the team is also pinned to them. The runtime pools team threads per calling
+ * thread and they keep the affinity they were created with, so pinning only the job thread (as a
+ * NUMA node lease does) would leave a reused team on the node of an earlier job.
+ */
+class compute_threads_scope
+{
+public:
+    explicit compute_threads_scope(std::size_t threads, std::span<const int> cpus = {});
+    ~compute_threads_scope();
+
+    compute_threads_scope(const compute_threads_scope&) = delete;
+    compute_threads_scope& operator=(const compute_threads_scope&) = delete;
+
+private:
+    int previous_{};
+};
+
+} // namespace stemsmith
@@ -0,0 +1,219 @@
+#include "wav_format.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace stemsmith
+{
+
+namespace
+{
+constexpr std::uint32_t kRf64Placeholder = 0xFFFFFFFF;
+constexpr float kScale16 = 1.0f / 32768.0f;
+constexpr float kScale24 = 1.0f / 8388608.0f;
+constexpr float kScale32 = 1.0f / 2147483648.0f;
+
+std::uint16_t read_u16(const unsigned char* bytes)
+{
+    return static_cast<std::uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+std::uint32_t read_u32(const unsigned char* bytes)
+{
+    return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8) |
+           (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+}
+
+std::uint64_t read_u64(const unsigned char* bytes)
+{
+    return static_cast<std::uint64_t>(read_u32(bytes)) | (static_cast<std::uint64_t>(read_u32(bytes + 4)) << 32);
+}
+
+void convert_pcm16(const unsigned char* src, std::size_t count, float* out)
+{
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(kScale16);
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        // Placing each sample in the upper half of a 32-bit lane and shifting back sign-extends it.
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8)
+    {
+        const int16x8_t packed = vreinterpretq_s16_u8(vld1q_u8(src + 2 * i));
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(packed))), kScale16));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(packed))), kScale16));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        out[i] = static_cast<float>(static_cast<std::int16_t>(read_u16(src + 2 * i))) * kScale16;
+    }
+}
+
+void convert_pcm24(const unsigned char* src, std::size_t count, float* out)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto* bytes = src + 3 * i;
+        const auto packed = static_cast<std::int32_t>((static_cast<std::uint32_t>(bytes[0]) << 8) |
+                                                      (static_cast<std::uint32_t>(bytes[1]) << 16) |
+                                                      (static_cast<std::uint32_t>(bytes[2]) << 24));
+        out[i] = static_cast<float>(packed >> 8) * kScale24;
+    }
+}
+
+void convert_pcm32(const unsigned char* src, std::size_t count, float* out)
+{
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(kScale32);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(packed), scale));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4)
+    {
+        const int32x4_t packed = vreinterpretq_s32_u8(vld1q_u8(src + 4 * i));
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(packed), kScale32));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        out[i] = static_cast<float>(static_cast<std::int32_t>(read_u32(src + 4 * i))) * kScale32;
+    }
+}
+
+void convert_samples(const unsigned char* src, const wav_format& format, std::size_t count, float* out)
+{
+    if (format.format_tag == wav_format_float)
+    {
+        std::memcpy(out, src, count * sizeof(float));
+        return;
+    }
+
+    switch (format.bits_per_sample)
+    {
+    case 16:
+        convert_pcm16(src, count, out);
+        break;
+    case 24:
+        convert_pcm24(src, count, out);
+        break;
+    default:
+        convert_pcm32(src, count, out);
+        break;
+    }
+}
+} // namespace
+
+std::optional<wav_layout> parse_wav_header(std::span<const unsigned char> file)
+{
+    if (file.size() < 12 || std::memcmp(file.data() + 8, "WAVE", 4) != 0)
+    {
+        return std::nullopt;
+    }
+    const bool rf64 = std::memcmp(file.data(), "RF64", 4) == 0 || std::memcmp(file.data(), "BW64", 4) == 0;
+    if (!rf64 && std::memcmp(file.data(), "RIFF", 4) != 0)
+    {
+        return std::nullopt;
+    }
+
+    wav_layout layout;
+    bool has_fmt = false;
+    std::uint64_t ds64_data_bytes = 0;
+    std::uint64_t offset = 12;
+    while (offset + 8 <= file.size())
+    {
+        const auto* header = file.data() + offset;
+        const auto chunk_size = read_u32(header + 4);
+        const auto body = offset + 8;
+        const auto available = file.size() - body;
+
+        if (std::memcmp(header, "ds64", 4) == 0 && chunk_size >= 16 && available >= 16)
+        {
+            ds64_data_bytes = read_u64(file.data() + body + 8); // after the 64-bit RIFF size
+        }
+        else if (std::memcmp(header, "fmt ", 4) == 0 && chunk_size >= 16 && available >= 16)
+        {
+            const auto* fmt = file.data() + body;
+            layout.format.format_tag = read_u16(fmt);
+            layout.format.channels = read_u16(fmt + 2);
+            layout.format.sample_rate = static_cast<int>(read_u32(fmt + 4));
+            layout.format.bits_per_sample = read_u16(fmt + 14);
+            if (layout.format.format_tag == wav_format_extensible && chunk_size >= 26 && available >= 26)
+            {
+                layout.format.format_tag = read_u16(fmt + 24); // first bytes of the sub-format GUID
+            }
+            has_fmt = true;
+        }
+        else if (std::memcmp(header, "data", 4) == 0)
+        {
+            if (!has_fmt)
+            {
+                return std::nullopt;
+            }
+            const auto declared = rf64 && chunk_size == kRf64Placeholder ? ds64_data_bytes : chunk_size;
+            layout.data_offset = body;
+            layout.data_bytes = std::min<std::uint64_t>(declared, available);
+            if (const auto block_align = layout.format.block_align(); block_align > 0)
+            {
+                layout.data_bytes -= layout.data_bytes % block_align;
+            }
+            return layout;
+        }
+
+        offset = body + chunk_size + (chunk_size & 1);
+    }
+    return std::nullopt;
+}
+
+bool is_native_wav(const wav_format& format) noexcept
+{
+    if ((format.channels != 1 && format.channels != 2) || format.sample_rate <= 0)
+    {
+        return false;
+    }
+    if (format.format_tag == wav_format_float)
+    {
+        return format.bits_per_sample == 32;
+    }
+    return format.format_tag == wav_format_pcm &&
+           (format.bits_per_sample == 16 || format.bits_per_sample == 24 || format.bits_per_sample == 32);
+}
+
+void decode_to_stereo(const unsigned char* data, const wav_format& format, std::size_t frames, float* out)
+{
+    if (format.channels == 2)
+    {
+        convert_samples(data, format, 2 * frames, out);
+        return;
+    }
+
+    // Mono: convert into the upper half, then spread forward. Frame i is written to 2i and 2i + 1,
+    // which never passes the unread source at frames + j for j > i.
+    float* mono = out + frames;
+    convert_samples(data, format, frames, mono);
+    for (std::size_t i = 0; i < frames; ++i)
+    {
+        const auto sample = mono[i];
+        out[2 * i] = sample;
+        out[2 * i + 1] = sample;
+    }
+}
+
+} // namespace stemsmith
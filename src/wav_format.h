@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace stemsmith
+{
+
+inline constexpr std::uint16_t wav_format_pcm = 1;
+inline constexpr std::uint16_t wav_format_float = 3;
+inline constexpr std::uint16_t wav_format_extensible = 0xFFFE;
+
+/**
+ * @brief Sample encoding described by a WAV `fmt ` chunk.
+ *
+ * For WAVE_FORMAT_EXTENSIBLE files `format_tag` holds the tag from the sub-format GUID, so callers
+ * only ever see ::wav_format_pcm or ::wav_format_float for the formats stemsmith decodes itself.
+ */
+struct wav_format
+{
+    std::uint16_t format_tag{};
+    std::uint16_t bits_per_sample{};
+    std::size_t channels{};
+    int sample_rate{};
+
+    [[nodiscard]] std::size_t block_align() const noexcept
+    {
+        return channels * (bits_per_sample / 8);
+    }
+};
+
+/**
+ * @brief Where the sample data of a RIFF/RF64 WAV file lives.
+ */
+struct wav_layout
+{
+    wav_format format;
+    std::uint64_t data_offset{}; // byte offset of the first frame
+    std::uint64_t data_bytes{};  // whole frames only, clamped to the file size
+};
+
+// Parses the chunk headers of a RIFF or RF64/BW64 WAVE file; nullopt without `fmt ` and `data` chunks.
+[[nodiscard]] std::optional<wav_layout> parse_wav_header(std::span<const unsigned char> file);
+
+// True for mono or stereo 16/24/32-bit PCM and 32-bit float, which decode_to_stereo handles.
+[[nodiscard]] bool is_native_wav(const wav_format& format) noexcept;
+
+/**
+ * @brief Converts `frames` frames of raw little-endian samples into interleaved stereo floats.
+ *
+ * `out` must hold 2 * `frames` floats; mono input is duplicated to both channels. 16- and 32-bit
+ * integer input is converted with SSE2/NEON where available.
+ */
+void decode_to_stereo(const unsigned char* data, const wav_format& format, std::size_t frames, float* out);
+
+} // namespace stemsmith
@@ -37,6 +37,11 @@ public:
     worker_pool& operator=(worker_pool&&) = delete;
 
     [[nodiscard]] std::size_t enqueue(job_descriptor job);
+    // Takes an id from the same sequence as enqueue() for a job finished without running on the pool.
+    [[nodiscard]] std::size_t reserve_id() noexcept
+    {
+        return next_id_++;
+    }
     [[nodiscard]] bool cancel(std::size_t job_id, std::string reason = {});
     void shutdown();
     [[nodiscard]] bool is_shutdown() const noexcept;
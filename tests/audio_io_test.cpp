@@ -1,12 +1,18 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <libnyquist/Common.h>
 #include <libnyquist/Decoders.h>
 #include <libnyquist/Encoders.h>
 #include <memory>
 #include <numeric>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "audio_io.h"
@@ -94,6 +100,140 @@ TEST(audio_io_test, writes_stereo_wav_files)
     expect_wav_file(path, 44100, 2);
 }
 
+TEST(audio_io_test, writes_planar_buffers_interleaved)
+{
+    const temp_dir dir;
+    audio_buffer buffer;
+    buffer.sample_rate = 44100;
+    buffer.channels = 2;
+    buffer.layout = sample_layout::planar;
+    buffer.samples.resize(2 * 33);
+    for (std::size_t f = 0; f < 33; ++f)
+    {
+        buffer.samples[buffer.index(f, 0)] = static_cast<float>(f) / 64.0f;
+        buffer.samples[buffer.index(f, 1)] = -static_cast<float>(f) / 64.0f;
+    }
+
+    const auto path = dir.path / "planar.wav";
+    ASSERT_TRUE(write_audio_file(path, buffer).has_value());
+
+    const auto decoded = load_audio_file(path);
+    ASSERT_TRUE(decoded.has_value()) << decoded.error();
+    ASSERT_EQ(decoded->frame_count(), 33U);
+    for (std::size_t f = 0; f < 33; ++f)
+    {
+        EXPECT_NEAR(decoded->samples[2 * f], static_cast<float>(f) / 64.0f, 1e-6f);
+        EXPECT_NEAR(decoded->samples[2 * f + 1], -static_cast<float>(f) / 64.0f, 1e-6f);
+    }
+}
+
+TEST(audio_io_test, writes_float_samples_without_dither)
+{
+    const temp_dir dir;
+    audio_buffer buffer;
+    buffer.sample_rate = 44100;
+    buffer.channels = 2;
+    buffer.layout = sample_layout::planar;
+    buffer.samples.resize(2 * 20000); // spans more than one interleaving block
+    for (std::size_t i = 0; i < buffer.samples.size(); ++i)
+    {
+        buffer.samples[i] = std::sin(static_cast<float>(i) * 0.001f) * 1e-4f; // far below 16-bit dither
+    }
+
+    const auto path = dir.path / "quiet.wav";
+    ASSERT_TRUE(write_audio_file(path, buffer).has_value());
+    EXPECT_EQ(std::filesystem::file_size(path), 44 + buffer.samples.size() * sizeof(float));
+
+    const auto decoded = load_audio_file(path);
+    ASSERT_TRUE(decoded.has_value()) << decoded.error();
+    ASSERT_EQ(decoded->frame_count(), 20000U);
+    for (std::size_t f = 0; f < 20000; ++f)
+    {
+        for (std::size_t ch = 0; ch < 2; ++ch)
+        {
+            ASSERT_EQ(decoded->samples[2 * f + ch], buffer.samples[buffer.index(f, ch)]) << f;
+        }
+    }
+}
+
+TEST(audio_io_test, writes_dithered_pcm_and_flac_stems)
+{
+    const temp_dir dir;
+    audio_buffer buffer;
+    buffer.sample_rate = 44100;
+    buffer.channels = 2;
+    buffer.layout = sample_layout::planar;
+    constexpr std::size_t frames = 10000; // two full FLAC blocks and a short last one
+    buffer.samples.resize(2 * frames);
+    for (std::size_t f = 0; f < frames; ++f)
+    {
+        // A tone, a stretch of digital silence and a hard-clipped tail cover every subframe type.
+        const auto tone = 0.6f * std::sin(static_cast<float>(f) * 0.05f);
+        const auto left = f < 3000 ? tone : f < 6000 ? 0.0f : std::clamp(4.0f * tone, -1.0f, 1.0f);
+        buffer.samples[buffer.index(f, 0)] = left;
+        buffer.samples[buffer.index(f, 1)] = f % 7 == 0 ? -left : 0.5f * left;
+    }
+
+    const std::vector<std::pair<output_encoding, float>> cases{
+        {{output_format::wav_pcm16}, 2.0f / 32768.0f},
+        {{output_format::wav_pcm24}, 2.0f / 8388608.0f},
+        {{output_format::flac, 0}, 2.0f / 8388608.0f},
+        {{output_format::flac, 5}, 2.0f / 8388608.0f},
+        {{output_format::flac, 8}, 2.0f / 8388608.0f},
+    };
+    for (const auto& [encoding, tolerance] : cases)
+    {
+        const auto path = dir.path / stem_file_name("mix", encoding.format);
+        ASSERT_TRUE(write_audio_file(path, buffer, encoding).has_value());
+
+        const auto decoded = load_audio_file(path);
+        ASSERT_TRUE(decoded.has_value()) << decoded.error();
+        ASSERT_EQ(decoded->frame_count(), frames);
+        for (std::size_t f = 0; f < frames; ++f)
+        {
+            for (std::size_t ch = 0; ch < 2; ++ch)
+            {
+                ASSERT_NEAR(decoded->samples[2 * f + ch], buffer.samples[buffer.index(f, ch)], tolerance)
+                    << output_format_key(encoding.format) << " level " << encoding.flac_level << " frame " << f;
+            }
+        }
+    }
+
+    const auto pcm24_bytes = std::filesystem::file_size(dir.path / "mix.wav"); // written by the last WAV case
+    EXPECT_EQ(pcm24_bytes, 44 + frames * 2 * 3);
+    EXPECT_LT(std::filesystem::file_size(dir.path / "mix.flac"), pcm24_bytes * 2 / 3);
+}
+
+TEST(audio_io_test, rewriting_a_hardlinked_stem_leaves_the_other_link_alone)
+{
+    const temp_dir dir;
+    audio_buffer buffer;
+    buffer.sample_rate = 44100;
+    buffer.channels = 2;
+    buffer.samples.assign(2 * 64, 0.25f);
+
+    // As when a restored job directory shares its stems with the result cache.
+    const auto cached = dir.path / "cache" / "vocals.wav";
+    const auto output = dir.path / "output" / "vocals.wav";
+    ASSERT_TRUE(write_audio_file(cached, buffer).has_value());
+    std::filesystem::create_directories(output.parent_path());
+    std::filesystem::create_hard_link(cached, output);
+    const auto cached_bytes = std::filesystem::file_size(cached);
+
+    buffer.samples.assign(2 * 128, -0.5f);
+    ASSERT_TRUE(write_audio_file(output, buffer).has_value());
+
+    EXPECT_EQ(std::filesystem::file_size(cached), cached_bytes);
+    EXPECT_EQ(std::filesystem::hard_link_count(cached), 1U);
+    EXPECT_GT(std::filesystem::file_size(output), cached_bytes);
+    const auto rewritten = load_audio_file(output);
+    ASSERT_TRUE(rewritten.has_value()) << rewritten.error();
+    EXPECT_FLOAT_EQ(rewritten->samples.front(), -0.5f);
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(output.parent_path()),
+                            std::filesystem::directory_iterator{}),
+              1); // no temporary file left behind
+}
+
 TEST(audio_io_test, write_audio_file_fails_with_tiny_buffer)
 {
     const temp_dir dir;
@@ -127,6 +267,55 @@ TEST(audio_io_test, load_audio_file_supports_stereo_without_resample)
     EXPECT_EQ(buffer->samples.size(), 960U);
 }
 
+TEST(audio_io_test, loads_rf64_pcm24_natively)
+{
+    const temp_dir dir;
+    const auto path = dir.path / "long.wav";
+    {
+        std::ofstream out(path, std::ios::binary);
+        const auto put = [&](std::uint64_t v, int size)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                out.put(static_cast<char>((v >> (8 * i)) & 0xFF));
+            }
+        };
+        constexpr std::uint32_t frames = 5;
+        out.write("RF64", 4);
+        put(0xFFFFFFFF, 4);
+        out.write("WAVEds64", 8);
+        put(28, 4);
+        put(0, 8);
+        put(frames * 6, 8);
+        put(frames, 8);
+        put(0, 4);
+        out.write("fmt ", 4);
+        put(16, 4);
+        put(1, 2);
+        put(2, 2);
+        put(44100, 4);
+        put(44100 * 6, 4);
+        put(6, 2);
+        put(24, 2);
+        out.write("data", 4);
+        put(0xFFFFFFFF, 4);
+        for (std::int32_t i = 0; i < static_cast<std::int32_t>(frames); ++i)
+        {
+            put(static_cast<std::uint32_t>(i * 100000), 3);
+            put(static_cast<std::uint32_t>(-i * 100000), 3);
+        }
+    }
+
+    const auto buffer = load_audio_file(path);
+    ASSERT_TRUE(buffer.has_value()) << buffer.error();
+    ASSERT_EQ(buffer->frame_count(), 5U);
+    for (std::size_t f = 0; f < 5; ++f)
+    {
+        EXPECT_FLOAT_EQ(buffer->samples[2 * f], static_cast<float>(f) * 100000.0f / 8388608.0f);
+        EXPECT_FLOAT_EQ(buffer->samples[2 * f + 1], -static_cast<float>(f) * 100000.0f / 8388608.0f);
+    }
+}
+
 TEST(audio_io_test, load_audio_file_rejects_multichannel_inputs)
 {
     const temp_dir dir;
@@ -149,4 +338,83 @@ TEST(audio_io_test, audio_buffer)
     EXPECT_EQ(buffer.frame_count(), 2U);
 }
 
+TEST(audio_io_test, interleave_handles_simd_tails)
+{
+    for (const std::size_t channels : {std::size_t{1}, std::size_t{2}, std::size_t{3}})
+    {
+        audio_buffer buffer;
+        buffer.channels = channels;
+        buffer.layout = sample_layout::planar;
+        buffer.samples.resize(channels * 11);
+        std::iota(buffer.samples.begin(), buffer.samples.end(), 0.0f);
+
+        const auto interleaved = to_interleaved(buffer);
+        EXPECT_EQ(interleaved.layout, sample_layout::interleaved);
+        ASSERT_EQ(interleaved.samples.size(), buffer.samples.size());
+        for (std::size_t f = 0; f < 11; ++f)
+        {
+            for (std::size_t ch = 0; ch < channels; ++ch)
+            {
+                EXPECT_EQ(interleaved.samples[interleaved.index(f, ch)], buffer.samples[buffer.index(f, ch)]);
+                EXPECT_EQ(interleaved.samples[f * channels + ch], static_cast<float>(ch * 11 + f));
+            }
+        }
+    }
+}
+
+
+TEST(audio_io_test, interleaves_a_frame_range_of_planar_blocks)
+{
+    for (const std::size_t channels : {std::size_t{1}, std::size_t{2}, std::size_t{3}})
+    {
+        std::vector<float> planar(channels * 23);
+        std::iota(planar.begin(), planar.end(), 0.0f);
+
+        // A range that starts mid-block and runs past the end is clamped to the frames that exist.
+        std::vector<float> block(channels * 16, -1.0f);
+        interleave(planar, channels, 9, 16, block);
+        for (std::size_t f = 0; f < 14; ++f)
+        {
+            for (std::size_t ch = 0; ch < channels; ++ch)
+            {
+                EXPECT_EQ(block[f * channels + ch], static_cast<float>(ch * 23 + 9 + f));
+            }
+        }
+        EXPECT_EQ(block[14 * channels], -1.0f);
+    }
+}
+
+TEST(audio_io_test, identifies_input_formats_by_extension_and_signature)
+{
+    EXPECT_EQ(input_format_for("a/mix.WAV"), input_format::wav);
+    EXPECT_EQ(input_format_for("mix.flac"), input_format::flac);
+    EXPECT_EQ(input_format_for("mix.Mp3"), input_format::mp3);
+    EXPECT_EQ(input_format_for("mix.ogg"), input_format::ogg);
+    EXPECT_EQ(input_format_for("mix.opus"), input_format::ogg);
+    EXPECT_EQ(input_format_for("mix.aiff"), std::nullopt);
+    EXPECT_EQ(input_format_for("mix"), std::nullopt);
+
+    using namespace std::string_view_literals;
+    const auto sniff = [](std::string_view bytes)
+    { return sniff_input_format({reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size()}); };
+    EXPECT_EQ(sniff("RIFF\x24\0\0\0WAVEfmt "sv), input_format::wav);
+    EXPECT_EQ(sniff("RF64\xff\xff\xff\xffWAVE"sv), input_format::wav);
+    EXPECT_EQ(sniff("RIFF\x24\0\0\0AVI "sv), std::nullopt);
+    EXPECT_EQ(sniff("fLaC"sv), input_format::flac);
+    EXPECT_EQ(sniff("OggS\0\x02"sv), input_format::ogg);
+    EXPECT_EQ(sniff("ID3\x04"sv), input_format::mp3);
+    EXPECT_EQ(sniff("\xff\xfb\x90\x64"sv), input_format::mp3);
+    EXPECT_EQ(sniff("abc"sv), std::nullopt);
+    EXPECT_EQ(sniff(""sv), std::nullopt);
+}
+
+TEST(audio_io_test, reports_undecodable_compressed_input)
+{
+    const temp_dir dir;
+    const auto path = dir.path / "broken.flac";
+    std::ofstream(path, std::ios::binary) << "fLaC-not-really";
+
+    const auto decoded = load_audio_file(path);
+    EXPECT_FALSE(decoded.has_value());
+}
 } // namespace stemsmith
@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "audio_io.h"
+#include "audio_stream.h"
+
+namespace
+{
+struct temp_dir
+{
+    temp_dir()
+    {
+        path = std::filesystem::temp_directory_path() / "stemsmith-audio-stream-test";
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+
+    ~temp_dir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+
+    std::filesystem::path path;
+};
+
+std::filesystem::path write_pcm16_wav(const temp_dir& dir, int sample_rate, std::uint16_t channels, std::size_t frames)
+{
+    const auto path = dir.path / "pcm16.wav";
+    std::ofstream out(path, std::ios::binary);
+    const auto put32 = [&](std::uint32_t v) { out.write(reinterpret_cast<const char*>(&v), 4); };
+    const auto put16 = [&](std::uint16_t v) { out.write(reinterpret_cast<const char*>(&v), 2); };
+
+    const auto data_bytes = static_cast<std::uint32_t>(frames * channels * 2);
+    out.write("RIFF", 4);
+    put32(36 + data_bytes);
+    out.write("WAVEfmt ", 8);
+    put32(16);
+    put16(1);
+    put16(channels);
+    put32(static_cast<std::uint32_t>(sample_rate));
+    put32(static_cast<std::uint32_t>(sample_rate) * channels * 2);
+    put16(static_cast<std::uint16_t>(channels * 2));
+    put16(16);
+    out.write("data", 4);
+    put32(data_bytes);
+    for (std::size_t i = 0; i < frames * channels; ++i)
+    {
+        put16(static_cast<std::uint16_t>(static_cast<std::int16_t>((i * 37) % 2000) - 1000));
+    }
+    return path;
+}
+} // namespace
+
+namespace stemsmith
+{
+TEST(audio_stream_test, chunked_reads_match_full_decode)
+{
+    const temp_dir dir;
+    const auto path = write_pcm16_wav(dir, 44100, 2, 3000);
+
+    auto reader = audio_stream_reader::open(path);
+    ASSERT_TRUE(reader.has_value()) << reader.error();
+    EXPECT_EQ(reader->frames_hint(), 3000U);
+
+    std::vector<float> streamed;
+    audio_buffer chunk;
+    do
+    {
+        ASSERT_TRUE(reader->read(chunk, 700).has_value());
+        EXPECT_LE(chunk.frame_count(), 700U);
+        streamed.insert(streamed.end(), chunk.samples.begin(), chunk.samples.end());
+    } while (!chunk.empty());
+
+    const auto full = load_audio_file(path);
+    ASSERT_TRUE(full.has_value());
+    ASSERT_EQ(streamed.size(), full->samples.size());
+    for (std::size_t i = 0; i < streamed.size(); ++i)
+    {
+        ASSERT_NEAR(streamed[i], full->samples[i], 1e-4f);
+    }
+}
+
+TEST(audio_stream_test, resamples_mono_input_incrementally)
+{
+    const temp_dir dir;
+    const auto path = write_pcm16_wav(dir, 48000, 1, 48000);
+
+    auto reader = audio_stream_reader::open(path);
+    ASSERT_TRUE(reader.has_value()) << reader.error();
+
+    std::size_t frames = 0;
+    audio_buffer chunk;
+    do
+    {
+        ASSERT_TRUE(reader->read(chunk, 4096).has_value());
+        EXPECT_EQ(chunk.sample_rate, 44100);
+        EXPECT_EQ(chunk.channels, 2U);
+        if (!chunk.empty())
+        {
+            EXPECT_FLOAT_EQ(chunk.samples[0], chunk.samples[1]);
+        }
+        frames += chunk.frame_count();
+    } while (!chunk.empty());
+
+    EXPECT_NEAR(static_cast<double>(frames), 44100.0, 64.0);
+}
+
+TEST(audio_stream_test, writer_appends_and_patches_header)
+{
+    const temp_dir dir;
+    const auto path = dir.path / "out.wav";
+
+    auto writer = wav_stream_writer::create(path, 44100, 2);
+    ASSERT_TRUE(writer.has_value()) << writer.error();
+
+    std::vector<float> first(200, 0.25f);
+    std::vector<float> second(300, -0.5f);
+    ASSERT_TRUE(writer->append(first).has_value());
+    ASSERT_TRUE(writer->append(second).has_value());
+    ASSERT_TRUE(writer->finalize().has_value());
+
+    const auto decoded = load_audio_file(path);
+    ASSERT_TRUE(decoded.has_value()) << decoded.error();
+    ASSERT_EQ(decoded->samples.size(), 500U);
+    EXPECT_FLOAT_EQ(decoded->samples[0], 0.25f);
+    EXPECT_FLOAT_EQ(decoded->samples[499], -0.5f);
+}
+} // namespace stemsmith
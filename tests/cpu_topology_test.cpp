@@ -0,0 +1,90 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "cpu_topology.h"
+
+namespace
+{
+struct fake_root
+{
+    fake_root()
+    {
+        path = std::filesystem::temp_directory_path() / "stemsmith-cpu-topology-test";
+        std::filesystem::remove_all(path);
+    }
+
+    ~fake_root()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+
+    void write(const std::filesystem::path& relative, const std::string& contents) const
+    {
+        const auto target = path / relative;
+        std::filesystem::create_directories(target.parent_path());
+        std::ofstream(target) << contents;
+    }
+
+    std::filesystem::path path;
+};
+} // namespace
+
+namespace stemsmith
+{
+TEST(cpu_topology_test, parses_cpu_lists)
+{
+    EXPECT_EQ(parse_cpu_list("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(parse_cpu_list(" 5 "), (std::vector<int>{5}));
+    EXPECT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(cpu_topology_test, parses_cpu_max)
+{
+    EXPECT_FALSE(parse_cpu_max("max 100000").has_value());
+    ASSERT_TRUE(parse_cpu_max("250000 100000").has_value());
+    EXPECT_DOUBLE_EQ(*parse_cpu_max("250000 100000"), 2.5);
+    EXPECT_FALSE(parse_cpu_max("garbage").has_value());
+}
+
+TEST(cpu_topology_test, sizes_from_cpuset_quota_and_numa_nodes)
+{
+    const fake_root root;
+    root.write("proc/self/status", "Name:\tstemsmithd\nCpus_allowed_list:\t0-5,8-13\n");
+    root.write("proc/self/cgroup", "0::/docker/abc\n");
+    root.write("sys/fs/cgroup/cpu.max", "max 100000\n");
+    root.write("sys/fs/cgroup/docker/cpu.max", "800000 100000\n");
+    root.write("sys/fs/cgroup/docker/abc/cpu.max", "350000 100000\n");
+    root.write("sys/devices/system/node/node0/cpulist", "0-7\n");
+    root.write("sys/devices/system/node/node1/cpulist", "8-15\n");
+    root.write("sys/devices/system/node/node2/cpulist", "16-23\n");
+
+    const auto topology = detect_cpu_topology(root.path);
+    EXPECT_EQ(topology.allowed_cpus.size(), 12U);
+    ASSERT_TRUE(topology.cpu_quota.has_value());
+    EXPECT_DOUBLE_EQ(*topology.cpu_quota, 3.5);
+    EXPECT_EQ(topology.usable_threads(), 4U);
+
+    // node2 has no allowed CPU and is dropped; the others only keep allowed CPUs.
+    ASSERT_EQ(topology.nodes.size(), 2U);
+    EXPECT_EQ(topology.nodes[0].cpus, (std::vector<int>{0, 1, 2, 3, 4, 5}));
+    EXPECT_EQ(topology.nodes[1].id, 1);
+    EXPECT_EQ(topology.node_index_of(9), 1U);
+}
+
+TEST(cpu_topology_test, unlimited_cgroup_uses_allowed_cpus)
+{
+    const fake_root root;
+    root.write("proc/self/status", "Cpus_allowed_list:\t0-2\n");
+    root.write("proc/self/cgroup", "0::/\n");
+    root.write("sys/fs/cgroup/cpu.max", "max 100000\n");
+
+    const auto topology = detect_cpu_topology(root.path);
+    EXPECT_FALSE(topology.cpu_quota.has_value());
+    EXPECT_EQ(topology.usable_threads(), 3U);
+    EXPECT_TRUE(topology.nodes.empty());
+}
+} // namespace stemsmith
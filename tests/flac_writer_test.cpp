@@ -0,0 +1,140 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <libnyquist/Common.h>
+#include <libnyquist/Decoders.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "flac_writer.h"
+
+namespace
+{
+std::vector<unsigned char> read_bytes(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+std::uint64_t big_endian(const std::vector<unsigned char>& bytes, std::size_t offset, std::size_t size)
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        value = (value << 8) | bytes[offset + i];
+    }
+    return value;
+}
+} // namespace
+
+namespace stemsmith
+{
+TEST(flac_writer_test, streaminfo_describes_the_stream_after_finalize)
+{
+    const auto path = std::filesystem::temp_directory_path() / "stemsmith-flac-writer.flac";
+    auto writer = flac_stream_writer::create(path, 48000, 2, 5);
+    ASSERT_TRUE(writer.has_value()) << writer.error();
+
+    // Appended in uneven chunks that straddle the 4096-frame blocks.
+    std::vector<float> samples(2 * 5000);
+    for (std::size_t i = 0; i < samples.size(); ++i)
+    {
+        samples[i] = static_cast<float>(i % 200) / 400.0f;
+    }
+    ASSERT_TRUE(writer->append({samples.data(), 2 * 3001}).has_value());
+    ASSERT_TRUE(writer->append({samples.data() + 2 * 3001, samples.size() - 2 * 3001}).has_value());
+    ASSERT_TRUE(writer->finalize().has_value());
+
+    const auto bytes = read_bytes(path);
+    ASSERT_GT(bytes.size(), 42U);
+    EXPECT_EQ(std::string(bytes.begin(), bytes.begin() + 4), "fLaC");
+    EXPECT_EQ(bytes[4], 0x80); // last metadata block, STREAMINFO
+    EXPECT_EQ(big_endian(bytes, 8, 2), 4096U);
+    EXPECT_EQ(big_endian(bytes, 10, 2), 4096U);
+    EXPECT_GT(big_endian(bytes, 12, 3), 0U); // smallest frame
+    const auto packed = big_endian(bytes, 18, 8);
+    EXPECT_EQ(packed >> 44, 48000U);
+    EXPECT_EQ(((packed >> 41) & 0x7) + 1, 2U);
+    EXPECT_EQ(((packed >> 36) & 0x1F) + 1, 24U);
+    EXPECT_EQ(packed & 0xFFFFFFFFFULL, 5000U);
+    EXPECT_EQ(bytes[42], 0xFF); // first frame's sync code
+    EXPECT_EQ(bytes[43] & 0xFE, 0xF8);
+    std::filesystem::remove(path);
+}
+
+TEST(flac_writer_test, round_trips_through_the_reference_decoder)
+{
+    const auto path = std::filesystem::temp_directory_path() / "stemsmith-flac-writer-reference.flac";
+    constexpr std::size_t block = 4096;
+
+    // One block each of signals LPC predicts almost perfectly (a pure tone, a ramp, a near-constant
+    // level), one it cannot predict at all (full-scale noise) and hard-clipped square waves, plus a
+    // short tail block. The channels differ so every stereo decorrelation mode gets exercised.
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    std::vector<float> samples;
+    const auto push = [&](float left, float right)
+    {
+        samples.push_back(left);
+        samples.push_back(right);
+    };
+    for (std::size_t f = 0; f < block; ++f)
+    {
+        const auto tone = 0.9f * std::sin(static_cast<float>(f) * 0.01f);
+        push(tone, 0.5f * tone);
+    }
+    for (std::size_t f = 0; f < block; ++f)
+    {
+        const auto ramp = -0.75f + 1.5f * static_cast<float>(f) / block;
+        push(ramp, -ramp);
+    }
+    for (std::size_t f = 0; f < block; ++f)
+    {
+        push(0.25f + (f % 512 == 0 ? 1e-6f : 0.0f), 0.25f);
+    }
+    for (std::size_t f = 0; f < block; ++f)
+    {
+        push(noise(rng), noise(rng));
+    }
+    for (std::size_t f = 0; f < block + 777; ++f)
+    {
+        const auto square = (f / 37) % 2 == 0 ? 1.0f : -1.0f;
+        push(square, f % 3 == 0 ? -square : square);
+    }
+    const auto frames = samples.size() / 2;
+
+    for (const unsigned level : {0U, 5U, 8U})
+    {
+        auto writer = flac_stream_writer::create(path, 44100, 2, level);
+        ASSERT_TRUE(writer.has_value()) << writer.error();
+        ASSERT_TRUE(writer->append(samples).has_value());
+        ASSERT_TRUE(writer->finalize().has_value());
+
+        // libnyquist decodes FLAC with libFLAC, independently of stemsmith's own audio_io.
+        nqr::NyquistIO loader;
+        nqr::AudioData decoded;
+        loader.Load(&decoded, path.string());
+        ASSERT_EQ(decoded.channelCount, 2) << "level " << level;
+        ASSERT_EQ(decoded.sampleRate, 44100) << "level " << level;
+        ASSERT_EQ(decoded.samples.size(), frames * 2) << "level " << level;
+        for (std::size_t i = 0; i < samples.size(); ++i)
+        {
+            // Dithered to 24 bits; anything beyond a couple of LSBs is a mis-coded subframe.
+            ASSERT_NEAR(decoded.samples[i], samples[i], 3.0f / 8388608.0f) << "level " << level << " sample " << i;
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(flac_writer_test, rejects_unsupported_layouts)
+{
+    const auto path = std::filesystem::temp_directory_path() / "stemsmith-flac-writer-invalid.flac";
+    EXPECT_FALSE(flac_stream_writer::create(path, 44100, 0, 5).has_value());
+    EXPECT_FALSE(flac_stream_writer::create(path, 44100, 9, 5).has_value());
+    EXPECT_FALSE(flac_stream_writer::create(path, 2000000, 2, 5).has_value());
+}
+} // namespace stemsmith
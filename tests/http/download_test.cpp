@@ -1,6 +1,9 @@
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+#include <vector>
 
 #include "http/server.h"
 
@@ -14,6 +17,14 @@ public:
         return srv.handle_download(id);
     }
 
+    static crow::response get_stem(server& srv,
+                                   const crow::request& req,
+                                   const std::string& id,
+                                   const std::string& name)
+    {
+        return srv.handle_get_stem(req, id, name);
+    }
+
     static job_registry& registry(server& srv)
     {
         return srv.registry_;
@@ -50,33 +61,215 @@ TEST(http_download_test, returns_conflict_if_not_completed)
     EXPECT_EQ(resp.code, crow::status::CONFLICT);
 }
 
-TEST(http_download_test, returns_zip_when_completed)
+namespace
+{
+// Registers a completed job whose output directory holds one text file of `text_bytes` bytes.
+std::string add_completed_job(stemsmith::http::job_registry& reg,
+                              const std::filesystem::path& output_dir,
+                              std::size_t text_bytes)
 {
-    using namespace stemsmith::http;
-    config cfg;
-    server srv(cfg);
-
-    auto& reg = server_test_hook::registry(srv);
     const auto id = reg.next_id();
     reg.add(id, stemsmith::job_handle{}, std::filesystem::path{});
 
-    const auto tmp_dir = std::filesystem::temp_directory_path() / "stemsmith-http-zip";
-    std::filesystem::create_directories(tmp_dir);
+    std::filesystem::create_directories(output_dir);
     {
-        const auto file_path = tmp_dir / "test.txt";
-        std::ofstream out(file_path);
-        out << "hello";
+        std::ofstream out(output_dir / "test.txt");
+        for (std::size_t i = 0; i < text_bytes; ++i)
+        {
+            out << "hello"[i % 5];
+        }
     }
 
     stemsmith::job_descriptor desc;
-    desc.output_dir = tmp_dir;
+    desc.output_dir = output_dir;
 
     stemsmith::job_event ev;
     ev.status = stemsmith::job_status::completed;
     reg.update(id, desc, ev);
+    return id;
+}
+
+std::vector<unsigned char> read_bytes(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+} // namespace
+
+TEST(http_download_test, returns_zip_when_completed)
+{
+    using namespace stemsmith::http;
+    config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-zip";
+    server srv(cfg);
+
+    const auto id = add_completed_job(server_test_hook::registry(srv), cfg.output_root / "job", 5);
 
     auto resp = server_test_hook::download(srv, id);
     EXPECT_EQ(resp.code, crow::status::OK);
-    EXPECT_NE(resp.body.size(), 0u);
+    EXPECT_TRUE(resp.is_static_type()); // streamed from disk, not buffered in the body
     EXPECT_NE(resp.get_header_value("Content-Type").find("application/zip"), std::string::npos);
+
+    const auto archive = cfg.output_root / "archives" / ("job-" + id + ".zip");
+    ASSERT_TRUE(std::filesystem::exists(archive));
+    EXPECT_EQ(resp.get_header_value("Content-Length"), std::to_string(std::filesystem::file_size(archive)));
+    const auto bytes = read_bytes(archive);
+    ASSERT_GT(bytes.size(), 30u);
+    EXPECT_EQ(bytes[8] | (bytes[9] << 8), 0); // STORE by default
+    std::filesystem::remove_all(cfg.output_root);
+}
+
+TEST(http_download_test, reuses_the_archive_and_honours_the_zip_level)
+{
+    using namespace stemsmith::http;
+    config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-zip-level";
+    cfg.zip_level = 9;
+    server srv(cfg);
+
+    const auto id = add_completed_job(server_test_hook::registry(srv), cfg.output_root / "job", 50000);
+    ASSERT_EQ(server_test_hook::download(srv, id).code, crow::status::OK);
+
+    const auto archive = cfg.output_root / "archives" / ("job-" + id + ".zip");
+    const auto first = read_bytes(archive);
+    ASSERT_GT(first.size(), 30u);
+    EXPECT_EQ(first[8] | (first[9] << 8), 8); // deflate
+    EXPECT_LT(first.size(), 50000u / 10);
+
+    // A later download serves the archive built by the first one.
+    std::filesystem::remove(cfg.output_root / "job" / "test.txt");
+    const auto again = server_test_hook::download(srv, id);
+    EXPECT_EQ(again.code, crow::status::OK);
+    EXPECT_EQ(read_bytes(archive), first);
+    std::filesystem::remove_all(cfg.output_root);
+}
+
+TEST(http_download_test, removes_only_its_own_archives)
+{
+    using namespace stemsmith::http;
+    config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-zip-cleanup";
+    std::filesystem::remove_all(cfg.output_root);
+    const auto archives = cfg.output_root / "archives";
+
+    // Files this server did not build, such as an earlier process' archive, are left alone.
+    std::filesystem::create_directories(archives);
+    std::ofstream(archives / "job-99.zip") << "foreign";
+    {
+        server srv(cfg);
+        const auto id = add_completed_job(server_test_hook::registry(srv), cfg.output_root / "job", 5);
+        ASSERT_EQ(server_test_hook::download(srv, id).code, crow::status::OK);
+        EXPECT_TRUE(std::filesystem::exists(archives / ("job-" + id + ".zip")));
+    }
+    EXPECT_TRUE(std::filesystem::exists(archives / "job-99.zip"));
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(archives), std::filesystem::directory_iterator{}), 1);
+    EXPECT_TRUE(std::filesystem::exists(cfg.output_root / "job" / "test.txt"));
+    std::filesystem::remove_all(cfg.output_root);
+}
+
+TEST(http_download_test, evicts_archives_over_budget_and_with_removed_outputs)
+{
+    using namespace stemsmith::http;
+    config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-zip-evict";
+    cfg.archive_cache_bytes = 1500; // room for one archive of the 1000-byte jobs below
+    std::filesystem::remove_all(cfg.output_root);
+    server srv(cfg);
+    auto& reg = server_test_hook::registry(srv);
+    const auto archive_of = [&](const std::string& id)
+    { return cfg.output_root / "archives" / ("job-" + id + ".zip"); };
+
+    const auto first = add_completed_job(reg, cfg.output_root / "first", 1000);
+    const auto second = add_completed_job(reg, cfg.output_root / "second", 1000);
+    ASSERT_EQ(server_test_hook::download(srv, first).code, crow::status::OK);
+    ASSERT_EQ(server_test_hook::download(srv, second).code, crow::status::OK);
+    EXPECT_FALSE(std::filesystem::exists(archive_of(first)));
+    EXPECT_TRUE(std::filesystem::exists(archive_of(second)));
+
+    // Evicted archives are rebuilt on demand.
+    ASSERT_EQ(server_test_hook::download(srv, first).code, crow::status::OK);
+    EXPECT_TRUE(std::filesystem::exists(archive_of(first)));
+
+    std::filesystem::remove_all(cfg.output_root / "first");
+    EXPECT_EQ(server_test_hook::download(srv, first).code, crow::status::NOT_FOUND);
+    EXPECT_FALSE(std::filesystem::exists(archive_of(first)));
+    std::filesystem::remove_all(cfg.output_root);
+}
+
+TEST(http_download_test, serves_single_stems_with_validators)
+{
+    using namespace stemsmith::http;
+    config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-stem";
+    server srv(cfg);
+
+    const auto output_dir = cfg.output_root / "job";
+    const auto id = add_completed_job(server_test_hook::registry(srv), output_dir, 10);
+    std::filesystem::rename(output_dir / "test.txt", output_dir / "vocals.wav");
+
+    const crow::request plain;
+    auto full = server_test_hook::get_stem(srv, plain, id, "vocals");
+    EXPECT_EQ(full.code, crow::status::OK);
+    EXPECT_TRUE(full.is_static_type()); // streamed from disk
+    EXPECT_EQ(full.get_header_value("Content-Type"), "audio/wav");
+    EXPECT_EQ(full.get_header_value("Content-Length"), "10");
+    EXPECT_EQ(full.get_header_value("Accept-Ranges"), "bytes");
+    const auto etag = full.get_header_value("ETag");
+    ASSERT_FALSE(etag.empty());
+    EXPECT_EQ(server_test_hook::get_stem(srv, plain, id, "vocals.wav").get_header_value("ETag"), etag);
+
+    EXPECT_EQ(server_test_hook::get_stem(srv, plain, id, "drums").code, crow::status::NOT_FOUND);
+    EXPECT_EQ(server_test_hook::get_stem(srv, plain, id, "../job/vocals.wav").code, crow::status::NOT_FOUND);
+    EXPECT_EQ(server_test_hook::get_stem(srv, plain, "missing", "vocals").code, crow::status::NOT_FOUND);
+
+    crow::request cached;
+    cached.add_header("If-None-Match", "\"other\", W/" + etag);
+    auto not_modified = server_test_hook::get_stem(srv, cached, id, "vocals");
+    EXPECT_EQ(not_modified.code, crow::status::NOT_MODIFIED);
+    EXPECT_EQ(not_modified.get_header_value("ETag"), etag);
+    std::filesystem::remove_all(cfg.output_root);
+}
+
+TEST(http_download_test, serves_byte_ranges_of_a_stem)
+{
+    using namespace stemsmith::http;
+    config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-stem-range";
+    server srv(cfg);
+
+    const auto output_dir = cfg.output_root / "job";
+    const auto id = add_completed_job(server_test_hook::registry(srv), output_dir, 10); // "hellohello"
+    std::filesystem::rename(output_dir / "test.txt", output_dir / "bass.flac");
+
+    const auto get_range = [&](const std::string& range, const std::string& if_range = {})
+    {
+        crow::request req;
+        req.add_header("Range", range);
+        if (!if_range.empty())
+        {
+            req.add_header("If-Range", if_range);
+        }
+        return server_test_hook::get_stem(srv, req, id, "bass");
+    };
+
+    auto middle = get_range("bytes=2-5");
+    EXPECT_EQ(middle.code, crow::status::PARTIAL_CONTENT);
+    EXPECT_EQ(middle.body, "lloh");
+    EXPECT_EQ(middle.get_header_value("Content-Range"), "bytes 2-5/10");
+    EXPECT_EQ(middle.get_header_value("Content-Type"), "audio/flac");
+    EXPECT_FALSE(middle.get_header_value("ETag").empty());
+
+    EXPECT_EQ(get_range("bytes=-3").body, "llo");
+    EXPECT_EQ(get_range("bytes=7-").body, "llo");
+    EXPECT_EQ(get_range("bytes=8-100").get_header_value("Content-Range"), "bytes 8-9/10");
+
+    auto unsatisfiable = get_range("bytes=10-");
+    EXPECT_EQ(unsatisfiable.code, crow::status::RANGE_NOT_SATISFIABLE);
+    EXPECT_EQ(unsatisfiable.get_header_value("Content-Range"), "bytes */10");
+
+    // Ranges the server may ignore, and a stale If-Range, fall back to the whole file.
+    EXPECT_EQ(get_range("bytes=0-1,4-5").code, crow::status::OK);
+    EXPECT_EQ(get_range("items=0-1").code, crow::status::OK);
+    EXPECT_EQ(get_range("bytes=0-1", "\"stale\"").code, crow::status::OK);
+    std::filesystem::remove_all(cfg.output_root);
 }
@@ -0,0 +1,128 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+
+#include "http/multipart_upload.h"
+
+namespace
+{
+std::string make_body(const std::string& file_body, const std::string& config_json)
+{
+    std::string body = "preamble\r\n";
+    body += "--XyZ\r\n";
+    body += "Content-Disposition: form-data; name=\"config\"\r\n\r\n";
+    body += config_json;
+    body += "\r\n--XyZ\r\n";
+    body += "content-disposition: form-data; name=\"file\"; filename=\"take.flac\"\r\n";
+    body += "Content-Type: audio/flac\r\n\r\n";
+    body += file_body;
+    body += "\r\n--XyZ--\r\n";
+    return body;
+}
+
+std::string read_file(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+} // namespace
+
+namespace stemsmith::http
+{
+TEST(multipart_upload_test, streams_file_part_to_disk_across_slices)
+{
+    const auto path = std::filesystem::temp_directory_path() / "stemsmith-multipart-upload.flac";
+
+    // Contains near-misses of the delimiter so a split across slices is exercised.
+    std::string file_body = "fLaC";
+    for (int i = 0; i < 5000; ++i)
+    {
+        file_body += static_cast<char>(i * 31);
+        file_body += i % 97 == 0 ? "\r\n--XyY" : "";
+    }
+    const auto body = make_body(file_body, R"({"stems":["vocals"]})");
+
+    for (const std::size_t slice : {std::size_t{1}, std::size_t{7}, std::size_t{4096}, body.size()})
+    {
+        multipart_upload::file_info seen;
+        multipart_upload upload(
+            "XyZ",
+            [&](const multipart_upload::file_info& info) -> std::expected<std::filesystem::path, upload_error>
+            {
+                seen = info;
+                return path;
+            },
+            1 << 20);
+        for (std::size_t offset = 0; offset < body.size(); offset += slice)
+        {
+            ASSERT_TRUE(upload.feed(std::string_view{body}.substr(offset, slice)).has_value()) << slice;
+        }
+        ASSERT_TRUE(upload.finish().has_value());
+
+        EXPECT_EQ(seen.filename, "take.flac");
+        EXPECT_EQ(seen.content_type, "audio/flac");
+        ASSERT_NE(upload.field("config"), nullptr);
+        EXPECT_EQ(*upload.field("config"), R"({"stems":["vocals"]})");
+        EXPECT_EQ(upload.file_bytes(), file_body.size());
+        EXPECT_EQ(upload.file_head(), file_body.substr(0, multipart_upload::head_size));
+        EXPECT_EQ(read_file(path), file_body) << slice;
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(multipart_upload_test, stops_at_the_file_cap_and_discards_the_partial_file)
+{
+    const auto path = std::filesystem::temp_directory_path() / "stemsmith-multipart-cap.flac";
+    multipart_upload upload(
+        "XyZ",
+        [&](const multipart_upload::file_info&) -> std::expected<std::filesystem::path, upload_error> { return path; },
+        1000);
+
+    const auto fed = upload.feed(make_body(std::string(1001, 'x'), "{}"));
+    ASSERT_FALSE(fed.has_value());
+    EXPECT_EQ(fed.error().reason, upload_error::kind::too_large);
+    EXPECT_TRUE(std::filesystem::exists(path));
+    upload.discard();
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(multipart_upload_test, rejects_truncated_and_refused_parts)
+{
+    const auto path = std::filesystem::temp_directory_path() / "stemsmith-multipart-refused.flac";
+    const auto body = make_body("fLaC", "{}");
+    {
+        multipart_upload upload(
+            "XyZ",
+            [&](const multipart_upload::file_info&) -> std::expected<std::filesystem::path, upload_error>
+            { return path; },
+            1000);
+        ASSERT_TRUE(upload.feed(std::string_view{body}.substr(0, body.size() - 8)).has_value());
+        const auto finished = upload.finish();
+        ASSERT_FALSE(finished.has_value());
+        EXPECT_EQ(finished.error().reason, upload_error::kind::malformed);
+        upload.discard();
+    }
+    {
+        multipart_upload upload(
+            "XyZ",
+            [](const multipart_upload::file_info&) -> std::expected<std::filesystem::path, upload_error>
+            { return std::unexpected(upload_error{upload_error::kind::malformed, "nope"}); },
+            1000);
+        const auto fed = upload.feed(body);
+        ASSERT_FALSE(fed.has_value());
+        EXPECT_EQ(fed.error().message, "nope");
+        EXPECT_FALSE(upload.file_path().has_value());
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(multipart_upload_test, reads_boundary_from_content_type)
+{
+    EXPECT_EQ(multipart_upload::boundary_from("multipart/form-data; boundary=abc"), "abc");
+    EXPECT_EQ(multipart_upload::boundary_from(R"(multipart/form-data; charset=utf-8; Boundary="a b")"), "a b");
+    EXPECT_EQ(multipart_upload::boundary_from("multipart/form-data"), std::nullopt);
+    EXPECT_EQ(multipart_upload::boundary_from("multipart/form-data; boundary="), std::nullopt);
+}
+} // namespace stemsmith::http
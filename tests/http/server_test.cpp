@@ -2,10 +2,14 @@
 #include <exception>
 #include <asio.hpp>
 // clang-format on
+#include <array>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <curl/curl.h>
+#include <filesystem>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <optional>
 #include <string>
 #include <thread>
@@ -63,6 +67,45 @@ std::optional<http_response> http_get(const std::string& url)
     return http_response{status, std::move(buffer)};
 }
 
+// Raw connection to a test server, retried while it starts up; used to send a request body in pieces.
+std::optional<asio::ip::tcp::socket> connect_raw(asio::io_context& io, std::uint16_t port)
+{
+    for (int attempt = 0; attempt < 20; ++attempt)
+    {
+        asio::ip::tcp::socket socket(io);
+        try
+        {
+            socket.connect({asio::ip::make_address("127.0.0.1"), port});
+            return socket;
+        }
+        catch (const std::exception&)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        }
+    }
+    return std::nullopt;
+}
+
+// Everything the server sends until it closes the connection (requests say "Connection: close").
+std::string read_until_closed(asio::ip::tcp::socket& socket)
+{
+    std::string response;
+    std::array<char, 4096> chunk{};
+    try
+    {
+        while (true)
+        {
+            const auto read = socket.read_some(asio::buffer(chunk));
+            response.append(chunk.data(), read);
+        }
+    }
+    catch (const std::exception&)
+    {
+        // End of stream.
+    }
+    return response;
+}
+
 class curl_global_guard
 {
 public:
@@ -174,7 +217,7 @@ TEST(http_server_test, post_jobs_rejects_missing_file)
     EXPECT_NE(resp.body.find(R"({"error":"file field required"})"), std::string::npos);
 }
 
-TEST(http_server_test, post_jobs_rejects_non_wav)
+TEST(http_server_test, post_jobs_rejects_unsupported_format)
 {
     stemsmith::http::config cfg;
     stemsmith::http::server srv(cfg);
@@ -185,6 +228,31 @@ TEST(http_server_test, post_jobs_rejects_non_wav)
     const std::string part_body = "abc";
     std::string body;
     body += "--BOUNDARY\r\n";
+    body += "Content-Disposition: form-data; name=\"file\"; filename=\"file.aiff\"\r\n";
+    body += "Content-Type: audio/aiff\r\n\r\n";
+    body += part_body;
+    body += "\r\n--BOUNDARY--\r\n";
+
+    crow::request req;
+    req.body = body;
+    req.add_header("Content-Type", "multipart/form-data; boundary=BOUNDARY");
+
+    const auto resp = stemsmith::http::server_test_hook::post_job(srv, req);
+    EXPECT_EQ(resp.code, crow::status::BAD_REQUEST);
+    EXPECT_NE(resp.body.find(R"({"error":"WAV, FLAC, MP3, OGG or Opus input required"})"), std::string::npos);
+}
+
+TEST(http_server_test, post_jobs_rejects_content_not_matching_extension)
+{
+    stemsmith::http::config cfg;
+    stemsmith::http::server srv(cfg);
+    stemsmith::http::server_test_hook::set_submit_override(srv,
+                                                           [](stemsmith::job_request)
+                                                           { return stemsmith::job_handle{}; });
+
+    const std::string part_body = "RIFF....WAVE"; // a WAV posing as MP3
+    std::string body;
+    body += "--BOUNDARY\r\n";
     body += "Content-Disposition: form-data; name=\"file\"; filename=\"file.mp3\"\r\n";
     body += "Content-Type: audio/mpeg\r\n\r\n";
     body += part_body;
@@ -196,7 +264,66 @@ TEST(http_server_test, post_jobs_rejects_non_wav)
 
     const auto resp = stemsmith::http::server_test_hook::post_job(srv, req);
     EXPECT_EQ(resp.code, crow::status::BAD_REQUEST);
-    EXPECT_NE(resp.body.find(R"({"error":"WAV input required"})"), std::string::npos);
+    EXPECT_NE(resp.body.find(R"({"error":"file content does not match file type"})"), std::string::npos);
+}
+
+TEST(http_server_test, post_jobs_rejects_mismatched_content_type)
+{
+    stemsmith::http::config cfg;
+    stemsmith::http::server srv(cfg);
+    stemsmith::http::server_test_hook::set_submit_override(srv,
+                                                           [](stemsmith::job_request)
+                                                           { return stemsmith::job_handle{}; });
+
+    const std::string part_body = "fLaC";
+    std::string body;
+    body += "--BOUNDARY\r\n";
+    body += "Content-Disposition: form-data; name=\"file\"; filename=\"file.flac\"\r\n";
+    body += "Content-Type: audio/mpeg\r\n\r\n";
+    body += part_body;
+    body += "\r\n--BOUNDARY--\r\n";
+
+    crow::request req;
+    req.body = body;
+    req.add_header("Content-Type", "multipart/form-data; boundary=BOUNDARY");
+
+    const auto resp = stemsmith::http::server_test_hook::post_job(srv, req);
+    EXPECT_EQ(resp.code, crow::status::BAD_REQUEST);
+    EXPECT_NE(resp.body.find(R"({"error":"content-type does not match file type"})"), std::string::npos);
+}
+
+TEST(http_server_test, post_jobs_accepts_compressed_upload)
+{
+    stemsmith::http::config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-compressed";
+    stemsmith::http::server srv(cfg);
+
+    std::filesystem::path submitted;
+    stemsmith::http::server_test_hook::set_submit_override(
+        srv,
+        [&](const stemsmith::job_request& req) -> std::expected<stemsmith::job_handle, std::string>
+        {
+            submitted = req.input_path;
+            return stemsmith::job_handle{};
+        });
+
+    const std::string file_body = "fLaC\x80\x00\x00\x22";
+    std::string body;
+    body += "--BOUNDARY\r\n";
+    body += "Content-Disposition: form-data; name=\"file\"; filename=\"Track.FLAC\"\r\n";
+    body += "Content-Type: audio/flac\r\n\r\n";
+    body += file_body;
+    body += "\r\n--BOUNDARY--\r\n";
+
+    crow::request req;
+    req.body = body;
+    req.add_header("Content-Type", "multipart/form-data; boundary=BOUNDARY");
+
+    const auto resp = stemsmith::http::server_test_hook::post_job(srv, req);
+    EXPECT_EQ(resp.code, crow::status::ACCEPTED);
+    EXPECT_EQ(submitted.extension(), ".flac");
+    EXPECT_TRUE(std::filesystem::exists(submitted));
+    std::filesystem::remove_all(cfg.output_root);
 }
 
 TEST(http_server_test, post_jobs_rejects_bad_config_json)
@@ -255,6 +382,154 @@ TEST(http_server_test, post_jobs_rejects_large_file)
     EXPECT_EQ(resp.code, crow::status::PAYLOAD_TOO_LARGE);
 }
 
+TEST(http_server_test, post_jobs_honours_configured_upload_cap)
+{
+    stemsmith::http::config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-upload-cap";
+    cfg.max_upload_bytes = 64;
+    stemsmith::http::server srv(cfg);
+    stemsmith::http::server_test_hook::set_submit_override(srv,
+                                                           [](stemsmith::job_request)
+                                                           { return stemsmith::job_handle{}; });
+
+    const auto post = [&](const std::string& file_body)
+    {
+        std::string body;
+        body += "--BOUNDARY\r\n";
+        body += "Content-Disposition: form-data; name=\"file\"; filename=\"file.wav\"\r\n";
+        body += "Content-Type: audio/wav\r\n\r\n";
+        body += file_body;
+        body += "\r\n--BOUNDARY--\r\n";
+
+        crow::request req;
+        req.body = body;
+        req.add_header("Content-Type", "multipart/form-data; boundary=BOUNDARY");
+        return stemsmith::http::server_test_hook::post_job(srv, req);
+    };
+
+    EXPECT_EQ(post("RIFF....WAVE" + std::string(52, 'x')).code, crow::status::ACCEPTED);
+    EXPECT_EQ(post("RIFF....WAVE" + std::string(53, 'x')).code, crow::status::PAYLOAD_TOO_LARGE);
+
+    // Only the accepted upload is left on disk; the rejected one is removed as soon as it hits the cap.
+    const auto uploads = cfg.output_root / "uploads";
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(uploads), std::filesystem::directory_iterator{}), 1);
+    std::filesystem::remove_all(cfg.output_root);
+}
+
+TEST(http_server_test, post_jobs_rejects_oversized_content_length_before_parsing)
+{
+    stemsmith::http::config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-content-length";
+    cfg.max_upload_bytes = 64;
+    std::filesystem::remove_all(cfg.output_root);
+    stemsmith::http::server srv(cfg);
+    stemsmith::http::server_test_hook::set_submit_override(srv,
+                                                           [](stemsmith::job_request)
+                                                           { return stemsmith::job_handle{}; });
+
+    crow::request req;
+    req.add_header("Content-Type", "multipart/form-data; boundary=BOUNDARY");
+    req.add_header("Content-Length", std::to_string(std::uint64_t{1} << 40));
+
+    const auto resp = stemsmith::http::server_test_hook::post_job(srv, req);
+    EXPECT_EQ(resp.code, crow::status::PAYLOAD_TOO_LARGE);
+    EXPECT_FALSE(std::filesystem::exists(cfg.output_root / "uploads"));
+}
+
+TEST(http_server_test, post_jobs_answers_oversized_upload_without_reading_the_body)
+{
+    const auto port = pick_ephemeral_port();
+    stemsmith::http::config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = port;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-early-413";
+    cfg.max_upload_bytes = 64;
+    std::filesystem::remove_all(cfg.output_root);
+    stemsmith::http::server srv(cfg);
+    stemsmith::http::server_test_hook::set_submit_override(srv,
+                                                           [](stemsmith::job_request)
+                                                           { return stemsmith::job_handle{}; });
+    srv.start();
+
+    asio::io_context io;
+    auto socket = connect_raw(io, port);
+    ASSERT_TRUE(socket.has_value());
+    // Only the headers are sent; the server must answer instead of waiting for a terabyte of body.
+    const std::string head = "POST /jobs HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                             "Content-Type: multipart/form-data; boundary=BOUNDARY\r\n"
+                             "Content-Length: " +
+                             std::to_string(std::uint64_t{1} << 40) + "\r\nExpect: 100-continue\r\n\r\n";
+    asio::write(*socket, asio::buffer(head));
+    const auto response = read_until_closed(*socket);
+    srv.stop();
+
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 413")) << response;
+    EXPECT_NE(response.find("file too large"), std::string::npos);
+    EXPECT_FALSE(std::filesystem::exists(cfg.output_root / "uploads"));
+    std::filesystem::remove_all(cfg.output_root);
+}
+
+TEST(http_server_test, post_jobs_writes_upload_to_disk_while_it_arrives)
+{
+    const auto port = pick_ephemeral_port();
+    stemsmith::http::config cfg;
+    cfg.bind_address = "127.0.0.1";
+    cfg.port = port;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-streamed-upload";
+    std::filesystem::remove_all(cfg.output_root);
+    stemsmith::http::server srv(cfg);
+    std::filesystem::path submitted;
+    stemsmith::http::server_test_hook::set_submit_override(srv,
+                                                           [&](stemsmith::job_request job)
+                                                           {
+                                                               submitted = job.input_path;
+                                                               return stemsmith::job_handle{};
+                                                           });
+    srv.start();
+
+    const std::string file_body = "RIFF....WAVE" + std::string(256 * 1024, 'x');
+    const std::string part_head = "--BOUNDARY\r\n"
+                                  "Content-Disposition: form-data; name=\"file\"; filename=\"long.wav\"\r\n"
+                                  "Content-Type: audio/wav\r\n\r\n";
+    const std::string part_tail = "\r\n--BOUNDARY--\r\n";
+    const auto content_length = part_head.size() + file_body.size() + part_tail.size();
+    const std::string head = "POST /jobs HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n"
+                             "Content-Type: multipart/form-data; boundary=BOUNDARY\r\n"
+                             "Content-Length: " +
+                             std::to_string(content_length) + "\r\n\r\n";
+    const auto half = file_body.size() / 2;
+
+    asio::io_context io;
+    auto socket = connect_raw(io, port);
+    ASSERT_TRUE(socket.has_value());
+    asio::write(*socket, asio::buffer(head + part_head + file_body.substr(0, half)));
+
+    // The file part reaches uploads/ before the request body is complete.
+    bool on_disk_early = false;
+    for (int attempt = 0; attempt < 100 && !on_disk_early; ++attempt)
+    {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(cfg.output_root / "uploads", ec))
+        {
+            on_disk_early = on_disk_early || entry.file_size() > 0;
+        }
+        if (!on_disk_early)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    asio::write(*socket, asio::buffer(file_body.substr(half) + part_tail));
+    const auto response = read_until_closed(*socket);
+    srv.stop();
+
+    EXPECT_TRUE(on_disk_early);
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 202")) << response;
+    ASSERT_FALSE(submitted.empty());
+    EXPECT_EQ(std::filesystem::file_size(submitted), file_body.size());
+    std::filesystem::remove_all(cfg.output_root);
+}
+
 TEST(http_server_test, post_jobs_accepts_valid_wav_and_config)
 {
     stemsmith::http::config cfg;
@@ -297,6 +572,49 @@ TEST(http_server_test, post_jobs_accepts_valid_wav_and_config)
     EXPECT_TRUE(submit_called);
 }
 
+TEST(http_server_test, post_jobs_keeps_output_subdir_out_of_server_directories)
+{
+    stemsmith::http::config cfg;
+    cfg.output_root = std::filesystem::temp_directory_path() / "stemsmith-http-output-subdir";
+    stemsmith::http::server srv(cfg);
+    std::optional<std::filesystem::path> submitted;
+    stemsmith::http::server_test_hook::set_submit_override(
+        srv,
+        [&](const stemsmith::job_request& req) -> std::expected<stemsmith::job_handle, std::string>
+        {
+            submitted = req.output_subdir;
+            return stemsmith::job_handle{};
+        });
+
+    const auto post = [&](const std::string& subdir)
+    {
+        std::string body;
+        body += "--BOUNDARY\r\n";
+        body += "Content-Disposition: form-data; name=\"config\"\r\n\r\n";
+        body += R"({"output_subdir":")" + subdir + R"("})";
+        body += "\r\n--BOUNDARY\r\n";
+        body += "Content-Disposition: form-data; name=\"file\"; filename=\"file.wav\"\r\n";
+        body += "Content-Type: audio/wav\r\n\r\n";
+        body += "RIFF....WAVE";
+        body += "\r\n--BOUNDARY--\r\n";
+
+        crow::request req;
+        req.body = body;
+        req.add_header("Content-Type", "multipart/form-data; boundary=BOUNDARY");
+        return stemsmith::http::server_test_hook::post_job(srv, req);
+    };
+
+    for (const auto* subdir : {"archives", "archives/x", "./Uploads", "../elsewhere", "a/../../b", ""})
+    {
+        EXPECT_EQ(post(subdir).code, crow::status::BAD_REQUEST) << subdir;
+    }
+    EXPECT_FALSE(submitted.has_value());
+
+    EXPECT_EQ(post("mixes/take-1").code, crow::status::ACCEPTED);
+    EXPECT_EQ(submitted, std::filesystem::path{"mixes/take-1"});
+    std::filesystem::remove_all(cfg.output_root);
+}
+
 TEST(http_server_test, service_unavailable_when_no_service)
 {
     stemsmith::http::config cfg;
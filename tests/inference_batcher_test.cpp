@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <expected>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "inference_batcher.h"
+#include "model_session_pool.h"
+#include "support/fake_session.h"
+
+namespace
+{
+using stemsmith::model_profile_id;
+
+Eigen::Tensor3dXf echo_stems(const Eigen::MatrixXf& audio)
+{
+    Eigen::Tensor3dXf tensor(4, 2, audio.cols());
+    tensor.setConstant(audio.cols() > 0 ? audio(0, 0) : 0.0f);
+    return tensor;
+}
+
+stemsmith::model_session_pool make_pool(std::mutex& mutex, std::vector<std::size_t>& batch_sizes)
+{
+    auto store = std::make_shared<stemsmith::model_store>(
+        [](model_profile_id) -> std::expected<std::filesystem::path, std::string>
+        { return std::filesystem::path{"stub-weights.bin"}; },
+        [](demucscpp::demucs_model&, const std::filesystem::path&) { return std::expected<void, std::string>{}; });
+
+    return stemsmith::model_session_pool(
+        [store, &mutex, &batch_sizes](
+            model_profile_id id) -> std::expected<std::unique_ptr<stemsmith::model_session>, std::string>
+        {
+            return std::make_unique<stemsmith::model_session>(
+                *stemsmith::lookup_profile(id),
+                store,
+                [](const demucscpp::demucs_model&, const Eigen::MatrixXf& audio, demucscpp::ProgressCallback)
+                { return echo_stems(audio); },
+                [&mutex, &batch_sizes](const demucscpp::demucs_model&,
+                                       std::span<const Eigen::MatrixXf> inputs,
+                                       std::span<const demucscpp::ProgressCallback> callbacks)
+                {
+                    {
+                        std::lock_guard lock(mutex);
+                        batch_sizes.push_back(inputs.size());
+                    }
+                    std::vector<Eigen::Tensor3dXf> outputs;
+                    for (std::size_t i = 0; i < inputs.size(); ++i)
+                    {
+                        callbacks[i](1.0f, "batch");
+                        outputs.push_back(echo_stems(inputs[i]));
+                    }
+                    return outputs;
+                });
+        });
+}
+
+stemsmith::audio_buffer make_marked_buffer(float marker)
+{
+    auto buffer = stemsmith::test::make_buffer(8);
+    std::fill(buffer.samples.begin(), buffer.samples.end(), marker);
+    return buffer;
+}
+} // namespace
+
+namespace stemsmith
+{
+TEST(inference_batcher_test, coalesces_concurrent_requests_into_one_batch)
+{
+    std::mutex mutex;
+    std::vector<std::size_t> batch_sizes;
+    auto pool = make_pool(mutex, batch_sizes);
+    inference_batcher batcher({.max_batch_size = 4, .max_wait = std::chrono::seconds{5}});
+
+    std::vector<std::thread> callers;
+    std::atomic_int matched{0};
+    for (int i = 0; i < 4; ++i)
+    {
+        callers.emplace_back(
+            [&, i]
+            {
+                const auto marker = static_cast<float>(i + 1) / 10.0f;
+                const auto input = make_marked_buffer(marker);
+                const auto result =
+                    batcher.separate(pool, model_profile_id::balanced_four_stem, input, {}, demucscpp::ProgressCallback{});
+                if (result && result->stems.size() == 4 && result->stems[0].second.samples[0] == marker)
+                {
+                    ++matched;
+                }
+            });
+    }
+    for (auto& caller : callers)
+    {
+        caller.join();
+    }
+
+    EXPECT_EQ(matched.load(), 4);
+    EXPECT_EQ(batcher.batch_count(), 1U);
+    EXPECT_EQ(batcher.batched_entries(), 4U);
+    ASSERT_EQ(batch_sizes.size(), 1U);
+    EXPECT_EQ(batch_sizes[0], 4U);
+}
+
+TEST(inference_batcher_test, flushes_partial_batch_after_max_wait)
+{
+    std::mutex mutex;
+    std::vector<std::size_t> batch_sizes;
+    auto pool = make_pool(mutex, batch_sizes);
+    inference_batcher batcher({.max_batch_size = 8, .max_wait = std::chrono::milliseconds{1}});
+
+    const auto input = make_marked_buffer(0.5f);
+    const auto result = batcher.separate(pool, model_profile_id::balanced_four_stem, input, {}, {});
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(batch_sizes.size(), 1U);
+    EXPECT_EQ(batch_sizes[0], 1U);
+}
+
+TEST(inference_batcher_test, cancellation_only_fails_its_own_entry)
+{
+    std::mutex mutex;
+    std::vector<std::size_t> batch_sizes;
+    auto pool = make_pool(mutex, batch_sizes);
+    inference_batcher batcher({.max_batch_size = 2, .max_wait = std::chrono::seconds{5}});
+
+    std::atomic_bool cancelled{false};
+    std::atomic_bool succeeded{false};
+    std::thread cancelling(
+        [&]
+        {
+            const auto input = make_marked_buffer(0.1f);
+            try
+            {
+                (void)batcher.separate(pool,
+                                       model_profile_id::balanced_four_stem,
+                                       input,
+                                       {},
+                                       [](float, const std::string&) { throw std::runtime_error("Job cancelled"); });
+            }
+            catch (const std::runtime_error&)
+            {
+                cancelled = true;
+            }
+        });
+    std::thread regular(
+        [&]
+        {
+            const auto input = make_marked_buffer(0.2f);
+            succeeded = batcher.separate(pool, model_profile_id::balanced_four_stem, input, {}, {}).has_value();
+        });
+    cancelling.join();
+    regular.join();
+
+    EXPECT_TRUE(cancelled.load());
+    EXPECT_TRUE(succeeded.load());
+}
+
+TEST(inference_batcher_test, runs_batches_of_one_profile_on_separate_sessions_concurrently)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    int in_flight = 0;
+    int peak = 0;
+    auto store = std::make_shared<model_store>(
+        [](model_profile_id) -> std::expected<std::filesystem::path, std::string>
+        { return std::filesystem::path{"stub-weights.bin"}; },
+        [](demucscpp::demucs_model&, const std::filesystem::path&) { return std::expected<void, std::string>{}; });
+    model_session_pool pool(
+        [&, store](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
+        {
+            return std::make_unique<model_session>(
+                *lookup_profile(id),
+                store,
+                [](const demucscpp::demucs_model&, const Eigen::MatrixXf& audio, demucscpp::ProgressCallback)
+                { return echo_stems(audio); },
+                [&](const demucscpp::demucs_model&,
+                    std::span<const Eigen::MatrixXf> inputs,
+                    std::span<const demucscpp::ProgressCallback>)
+                {
+                    // Hold each batch until a second one is running alongside it.
+                    std::unique_lock lock(mutex);
+                    peak = std::max(peak, ++in_flight);
+                    cv.notify_all();
+                    cv.wait_for(lock, std::chrono::seconds{5}, [&] { return peak >= 2; });
+                    --in_flight;
+                    std::vector<Eigen::Tensor3dXf> outputs;
+                    for (const auto& input : inputs)
+                    {
+                        outputs.push_back(echo_stems(input));
+                    }
+                    return outputs;
+                });
+        });
+    inference_batcher batcher({.max_batch_size = 1, .max_wait = std::chrono::milliseconds{0}});
+
+    std::vector<std::thread> callers;
+    std::atomic_int succeeded{0};
+    for (int i = 0; i < 2; ++i)
+    {
+        callers.emplace_back(
+            [&]
+            {
+                const auto input = make_marked_buffer(0.5f);
+                if (batcher.separate(pool, model_profile_id::balanced_four_stem, input, {}, {}).has_value())
+                {
+                    ++succeeded;
+                }
+            });
+    }
+    for (auto& caller : callers)
+    {
+        caller.join();
+    }
+
+    EXPECT_EQ(succeeded.load(), 2);
+    EXPECT_EQ(batcher.batch_count(), 2U);
+    EXPECT_EQ(peak, 2);
+}
+} // namespace stemsmith
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "inference_workspace.h"
+
+namespace stemsmith
+{
+TEST(inference_workspace_test, reuses_returned_buffers)
+{
+    inference_workspace workspace;
+    auto first = workspace.take(1024);
+    EXPECT_TRUE(first.empty());
+    EXPECT_GE(first.capacity(), 1024U);
+    const auto* storage = first.data();
+    EXPECT_EQ(workspace.stats().allocations, 1U);
+
+    workspace.give_back(std::move(first));
+    auto second = workspace.take(512);
+    EXPECT_EQ(second.data(), storage);
+    EXPECT_EQ(workspace.stats().allocations, 1U);
+    EXPECT_EQ(workspace.stats().reuses, 1U);
+}
+
+TEST(inference_workspace_test, picks_smallest_fitting_buffer)
+{
+    inference_workspace workspace;
+    auto large = workspace.take(4096);
+    auto small = workspace.take(256);
+    const auto* small_storage = small.data();
+    workspace.give_back(std::move(large));
+    workspace.give_back(std::move(small));
+
+    const auto fitted = workspace.take(200);
+    EXPECT_EQ(fitted.data(), small_storage);
+}
+
+TEST(inference_workspace_test, tracks_high_water_mark)
+{
+    inference_workspace workspace;
+    auto& input = workspace.input(2, 100);
+    EXPECT_EQ(input.cols(), 100);
+    EXPECT_EQ(&workspace.input(2, 100), &input);
+
+    auto a = workspace.take(1000);
+    auto b = workspace.take(1000);
+    const auto peak = workspace.stats().high_water_bytes;
+    EXPECT_GE(peak, (200 + a.capacity() + b.capacity()) * sizeof(float));
+
+    workspace.give_back(std::move(a));
+    workspace.give_back(std::move(b));
+    (void)workspace.take(1000);
+    EXPECT_EQ(workspace.stats().high_water_bytes, peak);
+}
+
+TEST(inference_workspace_test, caps_pooled_bytes)
+{
+    inference_workspace workspace(4096 * sizeof(float));
+    auto a = workspace.take(2048);
+    auto b = workspace.take(2048);
+    auto c = workspace.take(2048);
+    auto oversized = workspace.take(8192);
+    const auto* c_storage = c.data();
+
+    workspace.give_back(std::move(oversized)); // larger than the cap: freed, not pooled
+    workspace.give_back(std::move(a));
+    workspace.give_back(std::move(b));
+    workspace.give_back(std::move(c)); // evicts `a`, the oldest
+
+    (void)workspace.take(2048);
+    const auto reused = workspace.take(2048);
+    EXPECT_EQ(reused.data(), c_storage);
+    EXPECT_EQ(workspace.stats().reuses, 2U);
+    (void)workspace.take(2048);
+    EXPECT_EQ(workspace.stats().reuses, 2U);
+}
+
+TEST(inference_workspace_test, trim_drops_an_oversized_input)
+{
+    inference_workspace workspace(1000 * sizeof(float));
+    (void)workspace.input(2, 100);
+    workspace.trim();
+    const auto allocations = workspace.stats().allocations;
+    (void)workspace.input(2, 100);
+    EXPECT_EQ(workspace.stats().allocations, allocations); // within the cap: kept
+
+    (void)workspace.input(2, 1000);
+    workspace.trim();
+    (void)workspace.input(2, 1000);
+    EXPECT_EQ(workspace.stats().allocations, allocations + 2);
+}
+} // namespace stemsmith
@@ -61,6 +61,19 @@ TEST(job_catalog_test, reject_duplicate_files)
     EXPECT_NE(dup.error().find("already enqueued"), std::string::npos);
 }
 
+TEST(job_catalog_test, describe_does_not_register_path)
+{
+    const fake_filesystem fs{"/music/a.wav"};
+    job_catalog builder({}, [&fs](const std::filesystem::path& path) { return fs.exists(path); });
+
+    const auto described = builder.describe("/music/./a.wav", {}, "/output/a");
+    ASSERT_TRUE(described.has_value());
+    EXPECT_EQ(described->input_path, std::filesystem::path{"/music/a.wav"});
+    EXPECT_TRUE(builder.empty());
+    EXPECT_TRUE(builder.add_file("/music/a.wav", {}, "/output/a").has_value());
+    EXPECT_FALSE(builder.describe("/music/missing.wav", {}, "/output/b").has_value());
+}
+
 TEST(job_catalog_test, applies_overrides)
 {
     const fake_filesystem fs{"/music/a.wav"};
@@ -69,11 +82,13 @@ TEST(job_catalog_test, applies_overrides)
     job_overrides overrides;
     overrides.profile = model_profile_id::balanced_four_stem;
     overrides.stems_filter = std::vector<std::string>{"vocals", "drums"};
+    overrides.threads = 2;
 
     ASSERT_TRUE(builder.add_file("/music/a.wav", overrides, "/output/a").has_value());
     const auto& [input_path, config, output_dir] = builder.jobs().front();
     EXPECT_EQ(config.profile, model_profile_id::balanced_four_stem);
     EXPECT_EQ(config.stems_filter, overrides.stems_filter);
+    EXPECT_EQ(config.threads, 2U);
     EXPECT_EQ(output_dir, std::filesystem::path{"/output/a"});
 }
 
@@ -74,9 +74,75 @@ TEST(job_config_test, ignores_unknown_keys)
     const auto result = job_template::from_file(fixture_path("job_config/unknown_key.json"));
     ASSERT_TRUE(result.has_value());
 
-    const auto& [profile, stems_filter] = result.value();
+    const auto& [profile, stems_filter, quality, threads, resampler, output] = result.value();
     EXPECT_EQ(profile, model_profile_id::balanced_six_stem);
     EXPECT_TRUE(stems_filter.empty());
+    EXPECT_EQ(quality, job_quality::standard);
+    EXPECT_EQ(threads, 0U);
+    EXPECT_FALSE(resampler.has_value());
+    EXPECT_EQ(output.format, output_format::wav);
+}
+
+TEST(job_config_test, loads_quality_setting)
+{
+    const auto result = job_template::from_file(fixture_path("job_config/draft_quality.json"));
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->quality, job_quality::draft);
+    EXPECT_EQ(quality_key(result->quality), "draft");
+}
+
+TEST(job_config_test, rejects_unknown_quality)
+{
+    const auto result = job_template::from_file(fixture_path("job_config/unknown_quality.json"));
+    ASSERT_FALSE(result.has_value());
+    EXPECT_NE(result.error().find("Unknown quality"), std::string::npos);
+}
+
+TEST(job_config_test, loads_thread_budget)
+{
+    const auto result = job_template::from_file(fixture_path("job_config/thread_budget.json"));
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->threads, 8U);
+}
+
+TEST(job_config_test, rejects_negative_thread_budget)
+{
+    const auto result = job_template::from_file(fixture_path("job_config/negative_threads.json"));
+    ASSERT_FALSE(result.has_value());
+    EXPECT_NE(result.error().find("threads must be a non-negative integer"), std::string::npos);
+}
+
+TEST(job_config_test, loads_resampler_tier)
+{
+    const auto result = job_template::from_file(fixture_path("job_config/fast_resampler.json"));
+    ASSERT_TRUE(result.has_value());
+    ASSERT_TRUE(result->resampler.has_value());
+    EXPECT_EQ(*result->resampler, resample_quality::fast);
+    EXPECT_EQ(resample_quality_key(*result->resampler), "fast");
+}
+
+TEST(job_config_test, rejects_unknown_resampler)
+{
+    const auto result = job_template::from_file(fixture_path("job_config/unknown_resampler.json"));
+    ASSERT_FALSE(result.has_value());
+    EXPECT_NE(result.error().find("Unknown resampler"), std::string::npos);
+}
+
+TEST(job_config_test, loads_flac_output_with_level)
+{
+    const auto result = job_template::from_file(fixture_path("job_config/flac_output.json"));
+    ASSERT_TRUE(result.has_value()) << result.error();
+    EXPECT_EQ(result->output.format, output_format::flac);
+    EXPECT_EQ(result->output.flac_level, 8U);
+    EXPECT_EQ(output_format_key(result->output.format), "flac");
+}
+
+TEST(job_config_test, rejects_out_of_range_flac_level)
+{
+    const auto result = job_template::from_json_string(R"({"format": "flac", "flac_level": 9})");
+    ASSERT_FALSE(result.has_value());
+    EXPECT_NE(result.error().find("flac_level"), std::string::npos);
+    EXPECT_FALSE(job_template::from_json_string(R"({"format": "mp3"})").has_value());
 }
 
 TEST(job_config_test, rejects_unknown_model)
@@ -32,12 +32,14 @@ namespace stemsmith
 TEST(job_runner_test, resolves_future_on_completion)
 {
     std::vector<std::filesystem::path> writes;
-    auto writer = [&](const std::filesystem::path& path, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [&](const std::filesystem::path& path,
+                      const audio_buffer&,
+                      const output_encoding&) -> std::expected<void, std::string>
     {
         writes.push_back(path);
         return {};
     };
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
 
     model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
@@ -82,10 +84,12 @@ TEST(job_runner_test, resolves_future_on_completion)
 
 TEST(job_runner_test, emits_progress_events_in_order)
 {
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
 
-    auto writer = [](const std::filesystem::path&, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [](const std::filesystem::path&,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
     { return {}; };
 
     model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
@@ -123,9 +127,11 @@ TEST(job_runner_test, emits_progress_events_in_order)
 
 TEST(job_runner_test, reports_status_flow)
 {
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
-    auto writer = [](const std::filesystem::path&, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [](const std::filesystem::path&,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
     { return {}; };
 
     model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
@@ -165,10 +171,12 @@ TEST(job_runner_test, reports_status_flow)
 
 TEST(job_runner_test, propagates_engine_errors_to_future)
 {
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
 
-    auto writer = [](const std::filesystem::path&, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [](const std::filesystem::path&,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
     { return std::unexpected("writer failed"); };
 
     model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
@@ -195,9 +203,11 @@ TEST(job_runner_test, propagates_engine_errors_to_future)
 
 TEST(job_runner_test, request_observer_receives_events)
 {
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
-    auto writer = [](const std::filesystem::path&, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [](const std::filesystem::path&,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
     { return {}; };
 
     model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
@@ -239,13 +249,15 @@ TEST(job_runner_test, request_observer_receives_events)
 
 TEST(job_runner_test, handle_observer_receives_events)
 {
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
 
     std::mutex writer_mutex;
     std::condition_variable writer_cv;
     bool allow_write = false;
-    auto writer = [&](const std::filesystem::path&, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [&](const std::filesystem::path&,
+                      const audio_buffer&,
+                      const output_encoding&) -> std::expected<void, std::string>
     {
         std::unique_lock lock(writer_mutex);
         writer_cv.wait(lock, [&] { return allow_write; });
@@ -298,13 +310,15 @@ TEST(job_runner_test, handle_observer_receives_events)
 
 TEST(job_runner_test, handle_cancel_cancels_pending_job)
 {
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
 
     std::mutex writer_mutex;
     std::condition_variable writer_cv;
     bool allow_writes = false;
-    auto writer = [&](const std::filesystem::path&, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [&](const std::filesystem::path&,
+                      const audio_buffer&,
+                      const output_encoding&) -> std::expected<void, std::string>
     {
         std::unique_lock lock(writer_mutex);
         writer_cv.wait(lock, [&] { return allow_writes; });
@@ -394,4 +408,342 @@ TEST(job_runner_test, handle_cancel_cancels_pending_job)
 
     std::filesystem::remove_all(output_root);
 }
+
+TEST(job_runner_test, serves_identical_audio_from_result_cache)
+{
+    std::atomic_int loads{0};
+    auto loader = [&](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    {
+        ++loads;
+        return test::make_buffer(4);
+    };
+    auto writer = [](const std::filesystem::path& path,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << "stem";
+        return {};
+    };
+
+    model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return test::make_stub_session(id); });
+
+    const auto root = std::filesystem::temp_directory_path() / "stemsmith-job-result-cache";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    separation_engine engine(std::move(pool), root / "output", loader, writer);
+    std::vector<job_event> events;
+    job_runner runner(std::move(engine),
+                      job_template{},
+                      1,
+                      [&](const job_descriptor&, const job_event& event) { events.push_back(event); },
+                      std::make_shared<result_cache>(root / "results", 1U << 20));
+
+    // Same audio under two names: the second upload must not be separated again.
+    const auto audio = test::make_buffer(64);
+    ASSERT_TRUE(write_audio_file(root / "first.wav", audio).has_value());
+    ASSERT_TRUE(write_audio_file(root / "second.wav", audio).has_value());
+
+    job_request first;
+    first.input_path = root / "first.wav";
+    const auto first_result = runner.submit(first).value().result().get();
+    ASSERT_EQ(first_result.status, job_status::completed);
+
+    job_request second;
+    second.input_path = root / "second.wav";
+    const auto handle = runner.submit(second);
+    ASSERT_TRUE(handle.has_value());
+    const auto future = handle->result();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds{0}), std::future_status::ready);
+
+    const auto second_result = future.get();
+    EXPECT_EQ(second_result.status, job_status::completed);
+    EXPECT_EQ(second_result.output_dir, root / "output" / "second");
+    EXPECT_EQ(loads.load(), 1);
+    EXPECT_TRUE(std::filesystem::exists(second_result.output_dir / "vocals.wav"));
+    EXPECT_EQ(events.back().status, job_status::completed);
+    EXPECT_EQ(events.back().id, handle->id());
+
+    const auto stats = runner.result_cache_usage();
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->hits, 1U);
+    EXPECT_EQ(stats->misses, 1U);
+}
+
+TEST(job_runner_test, cache_hit_keeps_a_running_job_on_the_same_path_registered)
+{
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    bool allow_writes = true;
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return test::make_buffer(4); };
+    auto writer = [&](const std::filesystem::path& path,
+                      const audio_buffer&,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        std::unique_lock lock(writer_mutex);
+        writer_cv.wait(lock, [&] { return allow_writes; });
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << "stem";
+        return {};
+    };
+
+    model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return test::make_stub_session(id); });
+
+    const auto root = std::filesystem::temp_directory_path() / "stemsmith-job-cache-hit-path";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    separation_engine engine(std::move(pool), root / "output", loader, writer);
+    job_runner runner(std::move(engine),
+                      job_template{},
+                      2,
+                      {},
+                      std::make_shared<result_cache>(root / "results", 1U << 20),
+                      false);
+
+    const auto audio = test::make_buffer(64);
+    ASSERT_TRUE(write_audio_file(root / "seed.wav", audio).has_value());
+    ASSERT_TRUE(write_audio_file(root / "p.wav", audio).has_value());
+
+    // Seed the cache with the default settings.
+    job_request seed;
+    seed.input_path = root / "seed.wav";
+    ASSERT_EQ(runner.submit(seed).value().result().get().status, job_status::completed);
+
+    // A job on P with other settings misses the cache and stays running.
+    {
+        std::lock_guard lock(writer_mutex);
+        allow_writes = false;
+    }
+    job_request running;
+    running.input_path = root / "p.wav";
+    running.stems = std::vector<std::string>{"vocals"};
+    running.output_subdir = "running";
+    auto running_handle = runner.submit(running);
+    ASSERT_TRUE(running_handle.has_value()) << running_handle.error();
+
+    // P with the default settings is served from the cache...
+    job_request cached;
+    cached.input_path = root / "p.wav";
+    cached.output_subdir = "cached";
+    const auto cached_handle = runner.submit(cached);
+    ASSERT_TRUE(cached_handle.has_value()) << cached_handle.error();
+    EXPECT_EQ(cached_handle->result().get().status, job_status::completed);
+
+    // ...without releasing the running job's claim on the path.
+    job_request third;
+    third.input_path = root / "p.wav";
+    third.stems = std::vector<std::string>{"vocals"};
+    third.output_subdir = "third";
+    const auto rejected = runner.submit(third);
+    ASSERT_FALSE(rejected.has_value());
+    EXPECT_NE(rejected.error().find("already enqueued"), std::string::npos);
+
+    {
+        std::lock_guard lock(writer_mutex);
+        allow_writes = true;
+    }
+    writer_cv.notify_all();
+    const auto result = running_handle->result().get();
+    EXPECT_EQ(result.status, job_status::completed);
+    EXPECT_EQ(result.output_dir, root / "output" / "running");
+}
+
+TEST(job_runner_test, coalesces_identical_jobs_in_flight)
+{
+    std::atomic_int loads{0};
+    auto loader = [&](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    {
+        ++loads;
+        return test::make_buffer(4);
+    };
+
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    bool allow_writes = false;
+    auto writer = [&](const std::filesystem::path& path,
+                      const audio_buffer&,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        std::unique_lock lock(writer_mutex);
+        writer_cv.wait(lock, [&] { return allow_writes; });
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << "stem";
+        return {};
+    };
+
+    model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return test::make_stub_session(id); });
+
+    const auto root = std::filesystem::temp_directory_path() / "stemsmith-job-single-flight";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    separation_engine engine(std::move(pool), root / "output", loader, writer);
+    job_runner runner(std::move(engine), job_template{}, 2, {}, {}, true);
+
+    const auto audio = test::make_buffer(64);
+    for (const auto* name : {"a.wav", "b.wav", "c.wav"})
+    {
+        ASSERT_TRUE(write_audio_file(root / name, audio).has_value());
+    }
+
+    std::vector<job_handle> handles;
+    std::mutex events_mutex;
+    std::vector<job_event> follower_events;
+    for (const auto* name : {"a.wav", "b.wav", "c.wav"})
+    {
+        job_request request;
+        request.input_path = root / name;
+        request.observer.callback = [&](const job_descriptor& job, const job_event& event)
+        {
+            if (job.input_path.filename() == "b.wav")
+            {
+                std::lock_guard lock(events_mutex);
+                follower_events.push_back(event);
+            }
+        };
+        auto handle = runner.submit(request);
+        ASSERT_TRUE(handle.has_value()) << handle.error();
+        handles.push_back(std::move(handle.value()));
+    }
+
+    // The same path again attaches as well instead of being rejected.
+    job_request again;
+    again.input_path = root / "a.wav";
+    again.output_subdir = "again";
+    auto again_handle = runner.submit(again);
+    ASSERT_TRUE(again_handle.has_value()) << again_handle.error();
+
+    ASSERT_TRUE(handles[2].cancel("not needed").has_value());
+    EXPECT_EQ(handles[2].result().get().status, job_status::cancelled);
+
+    {
+        std::lock_guard lock(writer_mutex);
+        allow_writes = true;
+    }
+    writer_cv.notify_all();
+
+    for (const auto& handle : {handles[0], handles[1], again_handle.value()})
+    {
+        const auto result = handle.result().get();
+        EXPECT_EQ(result.status, job_status::completed);
+        EXPECT_TRUE(std::filesystem::exists(result.output_dir / "vocals.wav")) << result.output_dir;
+    }
+    EXPECT_EQ(handles[1].result().get().output_dir, root / "output" / "b");
+    EXPECT_EQ(again_handle->result().get().output_dir, root / "output" / "again");
+    EXPECT_EQ(loads.load(), 1);
+
+    std::lock_guard lock(events_mutex);
+    ASSERT_FALSE(follower_events.empty());
+    EXPECT_EQ(follower_events.front().status, job_status::queued);
+    EXPECT_EQ(follower_events.back().status, job_status::completed);
+    EXPECT_TRUE(std::ranges::all_of(follower_events,
+                                    [&](const job_event& event) { return event.id == handles[1].id(); }));
+}
+
+TEST(job_runner_test, runs_identical_jobs_separately_without_coalescing)
+{
+    std::atomic_int loads{0};
+    auto loader = [&](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    {
+        ++loads;
+        return test::make_buffer(4);
+    };
+    auto writer = [](const std::filesystem::path& path,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << "stem";
+        return {};
+    };
+
+    model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return test::make_stub_session(id); });
+
+    const auto root = std::filesystem::temp_directory_path() / "stemsmith-job-no-coalesce";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    separation_engine engine(std::move(pool), root / "output", loader, writer);
+    job_runner runner(std::move(engine), job_template{}, 2, {}, {}, false);
+
+    const auto audio = test::make_buffer(64);
+    std::vector<job_handle> handles;
+    for (const auto* name : {"a.wav", "b.wav"})
+    {
+        ASSERT_TRUE(write_audio_file(root / name, audio).has_value());
+        job_request request;
+        request.input_path = root / name;
+        auto handle = runner.submit(request);
+        ASSERT_TRUE(handle.has_value()) << handle.error();
+        handles.push_back(std::move(handle.value()));
+    }
+
+    for (const auto& handle : handles)
+    {
+        EXPECT_EQ(handle.result().get().status, job_status::completed);
+    }
+    EXPECT_EQ(loads.load(), 2);
+}
+
+TEST(job_runner_test, cancelling_leader_keeps_attached_jobs_running)
+{
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    bool allow_writes = false;
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return test::make_buffer(4); };
+    auto writer = [&](const std::filesystem::path& path,
+                      const audio_buffer&,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        std::unique_lock lock(writer_mutex);
+        writer_cv.wait(lock, [&] { return allow_writes; });
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << "stem";
+        return {};
+    };
+
+    model_session_pool pool([](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return test::make_stub_session(id); });
+
+    const auto root = std::filesystem::temp_directory_path() / "stemsmith-job-single-flight-cancel";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    separation_engine engine(std::move(pool), root / "output", loader, writer);
+    job_runner runner(std::move(engine), job_template{}, 1, {}, {}, true);
+
+    const auto audio = test::make_buffer(64);
+    ASSERT_TRUE(write_audio_file(root / "leader.wav", audio).has_value());
+    ASSERT_TRUE(write_audio_file(root / "follower.wav", audio).has_value());
+
+    job_request leader_request;
+    leader_request.input_path = root / "leader.wav";
+    const auto leader = runner.submit(leader_request).value();
+    job_request follower_request;
+    follower_request.input_path = root / "follower.wav";
+    const auto follower = runner.submit(follower_request).value();
+
+    ASSERT_TRUE(leader.cancel("leader left").has_value());
+    const auto leader_result = leader.result().get();
+    EXPECT_EQ(leader_result.status, job_status::cancelled);
+    EXPECT_EQ(leader_result.error, std::optional<std::string>{"leader left"});
+
+    {
+        std::lock_guard lock(writer_mutex);
+        allow_writes = true;
+    }
+    writer_cv.notify_all();
+
+    const auto follower_result = follower.result().get();
+    EXPECT_EQ(follower_result.status, job_status::completed);
+    EXPECT_TRUE(std::filesystem::exists(follower_result.output_dir / "vocals.wav"));
+}
 } // namespace stemsmith
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
@@ -43,6 +44,25 @@ TEST(model_cache_test, load_default_manifest)
     EXPECT_NE(nullptr, manifest->find(model_profile_id::balanced_six_stem));
 }
 
+TEST(model_cache_test, manifest_rejects_unsupported_precision)
+{
+    temp_dir dir;
+    const auto manifest_path = dir.path / "manifest.json";
+    {
+        std::ofstream out(manifest_path);
+        out << R"({"models": [{"profile": "balanced-four-stem", "filename": "w.bin", "url": "http://x/w.bin",
+                   "sha256": "00", "precision": "int8"}]})";
+    }
+
+    const auto manifest = model_manifest::from_file(manifest_path);
+    ASSERT_FALSE(manifest.has_value());
+    EXPECT_NE(manifest.error().find("int8"), std::string::npos);
+
+    const auto defaults = model_manifest::load_default();
+    ASSERT_TRUE(defaults.has_value());
+    EXPECT_EQ(defaults->find(model_profile_id::balanced_six_stem)->precision, "f16");
+}
+
 TEST(model_cache_test, download_and_cache_weights)
 {
     const auto profile = lookup_profile(model_profile_id::balanced_four_stem);
@@ -135,4 +155,46 @@ TEST(model_cache_test, ensure_ready_replaces_corrupted_cache_entries)
     const std::string stored{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
     EXPECT_EQ(stored, expected_payload);
 }
+
+TEST(model_cache_test, ensure_ready_trusts_verification_stamp_until_file_changes)
+{
+    const auto profile = lookup_profile(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(profile.has_value());
+    const std::string payload = "fake-weights";
+    model_manifest manifest({model_manifest_entry{model_profile_id::balanced_four_stem,
+                                                  std::string{profile->key},
+                                                  "ggml-model-test.bin",
+                                                  "http://example.invalid/ggml-model-test.bin",
+                                                  payload.size(),
+                                                  "bf6875a563be64dafa0c8e16f4b6093f55e15ba38f5c7a8844eaa61141dc805e"}});
+
+    auto fetcher = std::make_shared<test::fake_fetcher>(payload);
+    temp_dir dir;
+    model_cache cache(dir.path, fetcher, std::move(manifest));
+
+    const auto first = cache.ensure_ready(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(first.has_value());
+    auto stamp = first->weights_path;
+    stamp += ".verified";
+    EXPECT_TRUE(std::filesystem::exists(stamp));
+
+    // Same size and mtime: the stamp is trusted and the file is not rehashed.
+    const auto mtime = std::filesystem::last_write_time(first->weights_path);
+    {
+        std::ofstream out(first->weights_path, std::ios::binary | std::ios::trunc);
+        out << "XXXX-weights";
+    }
+    std::filesystem::last_write_time(first->weights_path, mtime);
+    const auto stamped = cache.ensure_ready(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(stamped.has_value());
+    EXPECT_TRUE(stamped->was_cached);
+    EXPECT_EQ(fetcher->call_count, 1U);
+
+    // A new mtime invalidates the stamp, so the checksum catches the corruption.
+    std::filesystem::last_write_time(first->weights_path, mtime + std::chrono::hours{1});
+    const auto rehashed = cache.ensure_ready(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(rehashed.has_value());
+    EXPECT_FALSE(rehashed->was_cached);
+    EXPECT_EQ(fetcher->call_count, 2U);
+}
 } // namespace stemsmith
@@ -61,6 +61,31 @@ TEST(model_session_pool_test, recycles_sessions_when_handles_destroyed)
     EXPECT_EQ(factory_calls, 2);
 }
 
+TEST(model_session_pool_test, warm_preloads_idle_sessions)
+{
+    int factory_calls = 0;
+    model_session_pool pool(
+        [&](model_profile_id id)
+        {
+            ++factory_calls;
+            return test::make_stub_session(id);
+        });
+
+    ASSERT_TRUE(pool.warm(model_profile_id::balanced_four_stem, 2).has_value());
+    EXPECT_EQ(factory_calls, 2);
+    EXPECT_EQ(pool.idle_count(model_profile_id::balanced_four_stem), 2U);
+
+    // Already warm sessions are reused rather than constructed again.
+    ASSERT_TRUE(pool.warm(model_profile_id::balanced_four_stem, 2).has_value());
+    EXPECT_EQ(factory_calls, 2);
+
+    const auto first = pool.acquire(model_profile_id::balanced_four_stem);
+    const auto second = pool.acquire(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(factory_calls, 2);
+}
+
 TEST(model_session_pool_test, propagates_factory_errors)
 {
     model_session_pool pool([](model_profile_id) -> std::expected<std::unique_ptr<model_session>, std::string>
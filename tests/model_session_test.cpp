@@ -80,6 +80,79 @@ TEST(model_session_test, separates_requested_stems)
     }
 }
 
+TEST(model_session_test, maps_either_layout_and_returns_planar_stems)
+{
+    const auto profile_opt = lookup_profile(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(profile_opt.has_value());
+
+    std::vector<bool> inputs_matched;
+    auto session = model_session(
+        profile_opt.value(),
+        []() -> std::expected<std::filesystem::path, std::string> { return std::filesystem::path{"unused.bin"}; },
+        [](demucscpp::demucs_model&, const std::filesystem::path&) { return std::expected<void, std::string>{}; },
+        [&](const demucscpp::demucs_model&, const Eigen::MatrixXf& audio, demucscpp::ProgressCallback)
+        {
+            bool matched = audio.rows() == 2 && audio.cols() == 5;
+            for (Eigen::Index f = 0; matched && f < audio.cols(); ++f)
+            {
+                matched = audio(0, f) == static_cast<float>(f) && audio(1, f) == static_cast<float>(f + 1);
+            }
+            inputs_matched.push_back(matched);
+            return make_tensor(4, 5);
+        });
+
+    const auto interleaved = make_audio_buffer(5);
+    auto planar_input = interleaved;
+    planar_input.layout = sample_layout::planar;
+    for (std::size_t f = 0; f < 5; ++f)
+    {
+        planar_input.samples[planar_input.index(f, 0)] = static_cast<float>(f);
+        planar_input.samples[planar_input.index(f, 1)] = static_cast<float>(f + 1);
+    }
+
+    const std::array<std::string_view, 1> filter{"bass"};
+    const audio_buffer& planar = planar_input;
+    for (const auto* input : {&interleaved, &planar})
+    {
+        const auto result = session.separate(*input, filter);
+        ASSERT_TRUE(result.has_value()) << result.error();
+        const auto& stem = result->stems[0].second;
+        EXPECT_EQ(stem.layout, sample_layout::planar);
+        for (std::size_t ch = 0; ch < 2; ++ch)
+        {
+            for (std::size_t f = 0; f < 5; ++f)
+            {
+                // "bass" is target 1 in the four-stem profile.
+                EXPECT_FLOAT_EQ(stem.samples[stem.index(f, ch)], static_cast<float>(1 + ch + f));
+            }
+        }
+    }
+    EXPECT_EQ(inputs_matched, (std::vector<bool>{true, true}));
+}
+
+TEST(model_session_test, steady_state_reuses_workspace)
+{
+    const auto profile_opt = lookup_profile(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(profile_opt.has_value());
+    auto session = make_session(profile_opt.value(), make_tensor(4, 64));
+    const auto input = make_audio_buffer(64);
+
+    auto warmup = session.separate(input);
+    ASSERT_TRUE(warmup.has_value());
+    session.recycle(std::move(warmup.value()));
+    const auto warm = session.workspace_usage();
+    EXPECT_GT(warm.high_water_bytes, 0U);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        auto result = session.separate(input);
+        ASSERT_TRUE(result.has_value());
+        session.recycle(std::move(result.value()));
+    }
+    EXPECT_EQ(session.workspace_usage().allocations, warm.allocations);
+    EXPECT_EQ(session.workspace_usage().high_water_bytes, warm.high_water_bytes);
+}
+
 TEST(model_session_test, rejects_unknown_stem_request)
 {
     const auto profile_opt = lookup_profile(model_profile_id::balanced_four_stem);
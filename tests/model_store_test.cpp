@@ -0,0 +1,100 @@
+#include <expected>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+
+#include "model_session.h"
+#include "model_store.h"
+#include "support/fake_session.h"
+
+namespace
+{
+using stemsmith::model_profile_id;
+using stemsmith::model_store;
+
+std::shared_ptr<model_store> make_counting_store(int& loads)
+{
+    return std::make_shared<model_store>(
+        [](model_profile_id) -> std::expected<std::filesystem::path, std::string>
+        { return std::filesystem::path{"stub-weights.bin"}; },
+        [&loads](demucscpp::demucs_model&, const std::filesystem::path&) -> std::expected<void, std::string>
+        {
+            ++loads;
+            return {};
+        });
+}
+} // namespace
+
+namespace stemsmith
+{
+TEST(model_store_test, shares_weights_between_sessions_of_a_profile)
+{
+    int loads = 0;
+    const auto store = make_counting_store(loads);
+
+    const auto first = store->acquire(model_profile_id::balanced_four_stem);
+    const auto second = store->acquire(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(first->get(), second->get());
+    EXPECT_EQ(loads, 1);
+    EXPECT_EQ(store->resident_count(), 1U);
+
+    const auto other = store->acquire(model_profile_id::balanced_six_stem);
+    ASSERT_TRUE(other.has_value());
+    EXPECT_NE(other->get(), first->get());
+    EXPECT_EQ(loads, 2);
+}
+
+TEST(model_store_test, releases_weights_with_last_borrower)
+{
+    int loads = 0;
+    const auto store = make_counting_store(loads);
+
+    {
+        const auto model = store->acquire(model_profile_id::balanced_four_stem);
+        ASSERT_TRUE(model.has_value());
+        EXPECT_EQ(store->resident_count(), 1U);
+    }
+
+    EXPECT_EQ(store->resident_count(), 0U);
+    ASSERT_TRUE(store->acquire(model_profile_id::balanced_four_stem).has_value());
+    EXPECT_EQ(loads, 2);
+    EXPECT_EQ(store->load_count(), 2U);
+}
+
+TEST(model_store_test, sessions_borrow_from_shared_store)
+{
+    int loads = 0;
+    const auto store = make_counting_store(loads);
+    const auto profile = lookup_profile(model_profile_id::balanced_four_stem);
+    ASSERT_TRUE(profile.has_value());
+
+    auto inference = [](const demucscpp::demucs_model&, const Eigen::MatrixXf& audio, demucscpp::ProgressCallback)
+    {
+        Eigen::Tensor3dXf tensor(4, 2, audio.cols());
+        tensor.setZero();
+        return tensor;
+    };
+
+    model_session first(*profile, store, inference);
+    model_session second(*profile, store, inference);
+    ASSERT_TRUE(first.separate(test::make_buffer(4)).has_value());
+    ASSERT_TRUE(second.separate(test::make_buffer(4)).has_value());
+    EXPECT_EQ(loads, 1);
+}
+
+TEST(model_store_test, propagates_loader_errors)
+{
+    model_store store([](model_profile_id) -> std::expected<std::filesystem::path, std::string>
+                      { return std::filesystem::path{"stub-weights.bin"}; },
+                      [](demucscpp::demucs_model&, const std::filesystem::path&) -> std::expected<void, std::string>
+                      { return std::unexpected("bad weights"); });
+
+    const auto model = store.acquire(model_profile_id::balanced_four_stem);
+    ASSERT_FALSE(model.has_value());
+    EXPECT_NE(model.error().find("bad weights"), std::string::npos);
+    EXPECT_EQ(store.resident_count(), 0U);
+}
+} // namespace stemsmith
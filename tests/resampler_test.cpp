@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <numbers>
+#include <vector>
+
+#include "resampler.h"
+
+namespace
+{
+constexpr int kTarget = 44100;
+
+std::vector<float> stereo_sine(int rate, double frequency, std::size_t frames)
+{
+    std::vector<float> samples(2 * frames);
+    for (std::size_t i = 0; i < frames; ++i)
+    {
+        const auto value = 0.5 * std::sin(2.0 * std::numbers::pi * frequency * static_cast<double>(i) / rate);
+        samples[2 * i] = static_cast<float>(value);
+        samples[2 * i + 1] = static_cast<float>(-value);
+    }
+    return samples;
+}
+
+std::vector<float> polyphase(const std::vector<float>& input, int rate, stemsmith::resample_quality quality)
+{
+    stemsmith::polyphase_resampler resampler(rate, kTarget, quality, 2);
+    std::vector<float> out;
+    resampler.process(input, true, out);
+    return out;
+}
+
+// THD+N of the left channel: power left after removing the best-fitting fundamental (any phase, so
+// converter delay does not count as distortion), relative to the fundamental. Edges are skipped.
+double thd_n_db(const std::vector<float>& output, double frequency)
+{
+    const auto frames = output.size() / 2;
+    double ss = 0.0;
+    double cc = 0.0;
+    double sc = 0.0;
+    double xs = 0.0;
+    double xc = 0.0;
+    for (std::size_t i = frames / 10; i < frames - frames / 10; ++i)
+    {
+        const auto w = 2.0 * std::numbers::pi * frequency * static_cast<double>(i) / kTarget;
+        const auto s = std::sin(w);
+        const auto c = std::cos(w);
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        xs += output[2 * i] * s;
+        xc += output[2 * i] * c;
+    }
+    const auto det = ss * cc - sc * sc;
+    const auto a = (xs * cc - xc * sc) / det;
+    const auto b = (xc * ss - xs * sc) / det;
+
+    double fundamental = 0.0;
+    double residual = 0.0;
+    for (std::size_t i = frames / 10; i < frames - frames / 10; ++i)
+    {
+        const auto w = 2.0 * std::numbers::pi * frequency * static_cast<double>(i) / kTarget;
+        const auto fit = a * std::sin(w) + b * std::cos(w);
+        fundamental += fit * fit;
+        residual += (output[2 * i] - fit) * (output[2 * i] - fit);
+    }
+    return 10.0 * std::log10(residual / fundamental);
+}
+
+double rms_db(const std::vector<float>& output)
+{
+    double sum = 0.0;
+    const auto frames = output.size() / 2;
+    for (std::size_t i = frames / 10; i < frames - frames / 10; ++i)
+    {
+        sum += output[2 * i] * output[2 * i];
+    }
+    return 10.0 * std::log10(sum / static_cast<double>(frames - frames / 5) / 0.125); // relative to the input sine
+}
+} // namespace
+
+namespace stemsmith
+{
+TEST(resampler_test, polyphase_path_covers_rational_rates_below_best)
+{
+    EXPECT_TRUE(polyphase_resampler::supports(48000, kTarget, resample_quality::medium));
+    EXPECT_TRUE(polyphase_resampler::supports(96000, kTarget, resample_quality::fast));
+    EXPECT_FALSE(polyphase_resampler::supports(48000, kTarget, resample_quality::best));
+    EXPECT_FALSE(polyphase_resampler::supports(kTarget, kTarget, resample_quality::fast));
+    EXPECT_FALSE(polyphase_resampler::supports(44101, kTarget, resample_quality::fast)); // 44100 phases
+}
+
+TEST(resampler_test, thd_n_of_a_1khz_tone_matches_the_tier)
+{
+    for (const int rate : {48000, 96000})
+    {
+        const auto input = stereo_sine(rate, 1000.0, static_cast<std::size_t>(rate) / 2);
+        const auto medium = polyphase(input, rate, resample_quality::medium);
+        const auto fast = polyphase(input, rate, resample_quality::fast);
+
+        const auto expected_frames = static_cast<double>(input.size() / 2) * kTarget / rate;
+        EXPECT_NEAR(static_cast<double>(medium.size() / 2), expected_frames, 1.0);
+        EXPECT_LT(thd_n_db(medium, 1000.0), -75.0) << rate;
+        EXPECT_LT(thd_n_db(fast, 1000.0), -55.0) << rate;
+        for (std::size_t i = 0; i < medium.size(); i += 2)
+        {
+            ASSERT_FLOAT_EQ(medium[i], -medium[i + 1]);
+        }
+    }
+}
+
+TEST(resampler_test, rejects_content_above_the_target_nyquist)
+{
+    // 30 kHz cannot be represented at 44.1 kHz and must not fold back to 14.1 kHz.
+    const auto input = stereo_sine(96000, 30000.0, 48000);
+    EXPECT_LT(rms_db(polyphase(input, 96000, resample_quality::medium)), -75.0);
+    EXPECT_LT(rms_db(polyphase(input, 96000, resample_quality::fast)), -55.0);
+}
+
+TEST(resampler_test, chunked_input_matches_a_single_call)
+{
+    const auto input = stereo_sine(48000, 440.0, 10007);
+    const auto whole = polyphase(input, 48000, resample_quality::medium);
+
+    polyphase_resampler resampler(48000, kTarget, resample_quality::medium, 2);
+    std::vector<float> chunked;
+    for (std::size_t offset = 0; offset < input.size(); offset += 2 * 1000)
+    {
+        const auto end = std::min(input.size(), offset + 2 * 1000);
+        resampler.process({input.data() + offset, end - offset}, end == input.size(), chunked);
+    }
+    ASSERT_EQ(chunked.size(), whole.size());
+    for (std::size_t i = 0; i < whole.size(); ++i)
+    {
+        ASSERT_FLOAT_EQ(chunked[i], whole[i]) << i;
+    }
+}
+} // namespace stemsmith
@@ -0,0 +1,165 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "audio_io.h"
+#include "result_cache.h"
+#include "separation_engine.h"
+
+namespace
+{
+std::filesystem::path fresh_dir(const std::string& name)
+{
+    const auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+std::filesystem::path write_tone(const std::filesystem::path& path, float amplitude)
+{
+    stemsmith::audio_buffer buffer;
+    buffer.sample_rate = 44100;
+    buffer.channels = 2;
+    buffer.samples.assign(2 * 1000, amplitude);
+    EXPECT_TRUE(stemsmith::write_audio_file(path, buffer).has_value());
+    return path;
+}
+
+void write_stems(const std::filesystem::path& dir, std::size_t bytes)
+{
+    std::filesystem::create_directories(dir);
+    for (const auto* name : {"vocals.wav", "drums.wav"})
+    {
+        std::ofstream out(dir / name, std::ios::binary);
+        out << std::string(bytes / 2, 'x');
+    }
+}
+} // namespace
+
+namespace stemsmith
+{
+TEST(result_cache_test, key_depends_on_audio_and_settings_not_file_name)
+{
+    const auto dir = fresh_dir("stemsmith-result-key");
+    const auto a = write_tone(dir / "a.wav", 0.25f);
+    const auto b = write_tone(dir / "b.wav", 0.25f);
+    const auto louder = write_tone(dir / "c.wav", 0.5f);
+
+    const job_template config{};
+    const auto key_a = result_cache::key_for(a, config);
+    ASSERT_TRUE(key_a.has_value()) << key_a.error();
+    EXPECT_EQ(key_a.value(), result_cache::key_for(b, config).value());
+    EXPECT_NE(key_a.value(), result_cache::key_for(louder, config).value());
+
+    auto draft = config;
+    draft.quality = job_quality::draft;
+    EXPECT_NE(key_a.value(), result_cache::key_for(a, draft).value());
+
+    auto vocals_only = config;
+    vocals_only.stems_filter = {"vocals"};
+    EXPECT_NE(key_a.value(), result_cache::key_for(a, vocals_only).value());
+
+    auto four_stem = config;
+    four_stem.profile = model_profile_id::balanced_four_stem;
+    EXPECT_NE(key_a.value(), result_cache::key_for(a, four_stem).value());
+
+    auto fast = config;
+    fast.resampler = resample_quality::fast;
+    EXPECT_NE(key_a.value(), result_cache::key_for(a, fast).value());
+
+    auto threads = config;
+    threads.threads = 3;
+    EXPECT_EQ(key_a.value(), result_cache::key_for(a, threads).value());
+}
+
+TEST(result_cache_test, key_depends_on_engine_output_settings)
+{
+    const auto dir = fresh_dir("stemsmith-result-engine-key");
+    const auto a = write_tone(dir / "a.wav", 0.25f);
+    const job_template config{};
+    const engine_options defaults{};
+    const auto key = result_cache::key_for(a, config, output_settings_key(defaults)).value();
+
+    const auto key_with = [&](engine_options options)
+    { return result_cache::key_for(a, config, output_settings_key(options)).value(); };
+    EXPECT_NE(key, key_with({.segment_parallelism = 4}));
+    EXPECT_NE(key, key_with({.segment_seconds = 10.0}));
+    EXPECT_NE(key, key_with({.segment_overlap_seconds = 2.0}));
+    EXPECT_NE(key, key_with({.streaming = true}));
+    EXPECT_NE(key, key_with({.silence_threshold_db = -60.0}));
+    EXPECT_EQ(key, key_with({.compute_threads = 3, .inference_slots = 2}));
+}
+
+TEST(result_cache_test, restores_stored_stems_and_counts_hits)
+{
+    const auto root = fresh_dir("stemsmith-result-cache");
+    const auto job_dir = fresh_dir("stemsmith-result-job");
+    const auto restored_dir = std::filesystem::temp_directory_path() / "stemsmith-result-restored";
+    std::filesystem::remove_all(restored_dir);
+    write_stems(job_dir, 100);
+
+    result_cache cache(root, 1000);
+    EXPECT_FALSE(cache.restore("abc", restored_dir).value());
+    ASSERT_TRUE(cache.store("abc", job_dir).has_value());
+    ASSERT_TRUE(cache.restore("abc", restored_dir).value());
+
+    EXPECT_EQ(std::filesystem::file_size(restored_dir / "vocals.wav"), 50U);
+    EXPECT_EQ(std::filesystem::file_size(restored_dir / "drums.wav"), 50U);
+
+    // Rewriting the job's own output must not reach the cached copy.
+    write_stems(job_dir, 10);
+    EXPECT_EQ(std::filesystem::file_size(root / "abc" / "vocals.wav"), 50U);
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1U);
+    EXPECT_EQ(stats.misses, 1U);
+    EXPECT_EQ(stats.entries, 1U);
+    EXPECT_EQ(stats.bytes, 100U);
+}
+
+TEST(result_cache_test, evicts_least_recently_used_over_budget)
+{
+    const auto root = fresh_dir("stemsmith-result-evict");
+    const auto out = std::filesystem::temp_directory_path() / "stemsmith-result-evict-out";
+    result_cache cache(root, 250);
+
+    for (const auto* key : {"one", "two"})
+    {
+        const auto job_dir = fresh_dir(std::string{"stemsmith-result-evict-"} + key);
+        write_stems(job_dir, 100);
+        ASSERT_TRUE(cache.store(key, job_dir).has_value());
+    }
+    ASSERT_TRUE(cache.restore("one", out).value()); // "two" is now the least recently used
+
+    const auto job_dir = fresh_dir("stemsmith-result-evict-three");
+    write_stems(job_dir, 100);
+    ASSERT_TRUE(cache.store("three", job_dir).has_value());
+
+    EXPECT_TRUE(cache.restore("one", out).value());
+    EXPECT_FALSE(cache.restore("two", out).value());
+    EXPECT_TRUE(cache.restore("three", out).value());
+    EXPECT_FALSE(std::filesystem::exists(root / "two"));
+    EXPECT_EQ(cache.stats().evictions, 1U);
+    EXPECT_EQ(cache.stats().bytes, 200U);
+}
+
+TEST(result_cache_test, reloads_entries_from_disk)
+{
+    const auto root = fresh_dir("stemsmith-result-reload");
+    const auto job_dir = fresh_dir("stemsmith-result-reload-job");
+    write_stems(job_dir, 100);
+    {
+        result_cache cache(root, 1000);
+        ASSERT_TRUE(cache.store("kept", job_dir).has_value());
+    }
+    std::filesystem::create_directories(root / ".staging-7"); // interrupted store
+
+    result_cache reopened(root, 1000);
+    EXPECT_EQ(reopened.stats().entries, 1U);
+    EXPECT_EQ(reopened.stats().bytes, 100U);
+    EXPECT_FALSE(std::filesystem::exists(root / ".staging-7"));
+    EXPECT_TRUE(reopened.restore("kept", std::filesystem::temp_directory_path() / "stemsmith-result-reload-out").value());
+}
+} // namespace stemsmith
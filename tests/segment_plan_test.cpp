@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "segment_plan.h"
+#include "support/fake_session.h"
+
+namespace stemsmith
+{
+TEST(segment_plan_test, short_track_is_a_single_segment)
+{
+    const auto segments = plan_segments(100, 400, 20);
+    ASSERT_EQ(segments.size(), 1U);
+    EXPECT_EQ(segments[0].offset, 0U);
+    EXPECT_EQ(segments[0].length, 100U);
+    EXPECT_FALSE(segments[0].fade_in);
+    EXPECT_FALSE(segments[0].fade_out);
+}
+
+TEST(segment_plan_test, segments_cover_track_with_fixed_overlap)
+{
+    const auto segments = plan_segments(1000, 300, 50);
+    ASSERT_GE(segments.size(), 2U);
+    EXPECT_EQ(segments.front().offset, 0U);
+    EXPECT_EQ(segments.back().offset + segments.back().length, 1000U);
+    EXPECT_FALSE(segments.front().fade_in);
+    EXPECT_FALSE(segments.back().fade_out);
+
+    for (std::size_t i = 1; i < segments.size(); ++i)
+    {
+        const auto& previous = segments[i - 1];
+        EXPECT_EQ(previous.offset + previous.length - segments[i].offset, 50U);
+        EXPECT_GT(segments[i].length, 50U);
+    }
+}
+
+TEST(segment_plan_test, crossfade_weights_sum_to_one)
+{
+    constexpr std::size_t overlap = 16;
+    const auto segments = plan_segments(500, 120, overlap);
+    std::vector<float> coverage(500, 0.0f);
+    for (const auto& segment : segments)
+    {
+        for (std::size_t i = 0; i < segment.length; ++i)
+        {
+            coverage[segment.offset + i] += crossfade_weight(segment, i, overlap);
+        }
+    }
+
+    for (const auto weight : coverage)
+    {
+        EXPECT_NEAR(weight, 1.0f, 1e-6f);
+    }
+}
+
+TEST(segment_plan_test, overlap_add_reconstructs_source)
+{
+    constexpr std::size_t overlap = 8;
+    auto source = test::make_buffer(257);
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        source.samples[i] = static_cast<float>(i % 17) / 17.0f - 0.5f;
+    }
+
+    auto target = test::make_buffer(source.frame_count());
+    for (const auto& segment : plan_segments(source.frame_count(), 64, overlap))
+    {
+        overlap_add(target, slice_segment(source, segment), segment, overlap);
+    }
+
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        EXPECT_NEAR(target.samples[i], source.samples[i], 1e-6f);
+    }
+}
+TEST(segment_plan_test, silence_detection_uses_short_blocks)
+{
+    auto buffer = test::make_buffer(8192);
+    EXPECT_TRUE(is_silent(buffer, {0, 8192}, -60.0));
+
+    // -40 dBFS hiss is silence at a -30 dB threshold but not at -50 dB.
+    for (auto& sample : buffer.samples)
+    {
+        sample = 0.01f;
+    }
+    EXPECT_TRUE(is_silent(buffer, {0, 8192}, -30.0));
+    EXPECT_FALSE(is_silent(buffer, {0, 8192}, -50.0));
+
+    // A short burst still counts as content even though the segment's average energy is tiny.
+    std::ranges::fill(buffer.samples, 0.0f);
+    for (std::size_t frame = 5000; frame < 5100; ++frame)
+    {
+        buffer.samples[frame * 2] = 0.5f;
+    }
+    EXPECT_FALSE(is_silent(buffer, {0, 8192}, -30.0));
+    EXPECT_TRUE(is_silent(buffer, {0, 4096}, -30.0));
+    EXPECT_FALSE(is_silent(buffer, {4096, 4096}, -30.0));
+
+    buffer.layout = sample_layout::planar; // the same samples now read as right-channel frames 1808..2006
+    EXPECT_FALSE(is_silent(buffer, {1536, 1024}, -30.0));
+    EXPECT_TRUE(is_silent(buffer, {2048, 1024}, -30.0));
+}
+} // namespace stemsmith
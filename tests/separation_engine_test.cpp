@@ -1,26 +1,64 @@
+#include <algorithm>
 #include <expected>
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "audio_stream.h"
 #include "job_catalog.h"
 #include "model_session_pool.h"
 #include "separation_engine.h"
 #include "support/fake_session.h"
 
+namespace
+{
+// Each stem echoes the input, so a correct crossfade reproduces the source exactly.
+std::expected<std::unique_ptr<stemsmith::model_session>, std::string> make_echo_session(stemsmith::model_profile_id id)
+{
+    return std::make_unique<stemsmith::model_session>(
+        *stemsmith::lookup_profile(id),
+        []() -> std::expected<std::filesystem::path, std::string> { return std::filesystem::path{"stub.bin"}; },
+        [](demucscpp::demucs_model&, const std::filesystem::path&) { return std::expected<void, std::string>{}; },
+        [](const demucscpp::demucs_model&, const Eigen::MatrixXf& audio, const demucscpp::ProgressCallback& cb)
+        {
+            if (cb)
+            {
+                cb(0.5f, "stub");
+            }
+            Eigen::Tensor3dXf tensor(4, 2, audio.cols());
+            for (Eigen::Index stem = 0; stem < 4; ++stem)
+            {
+                for (Eigen::Index ch = 0; ch < 2; ++ch)
+                {
+                    for (Eigen::Index frame = 0; frame < audio.cols(); ++frame)
+                    {
+                        tensor(stem, ch, frame) = audio(ch, frame);
+                    }
+                }
+            }
+            return tensor;
+        });
+}
+} // namespace
+
 namespace stemsmith
 {
 TEST(separation_engine_test, processes_job_and_writes_stems)
 {
     std::vector<std::pair<std::filesystem::path, audio_buffer>> writes;
-    auto writer = [&](const std::filesystem::path& path, const audio_buffer& buffer) -> std::expected<void, std::string>
+    auto writer = [&](const std::filesystem::path& path,
+                      const audio_buffer& buffer,
+                      const output_encoding&) -> std::expected<void, std::string>
     {
         writes.emplace_back(path, buffer);
         return {};
     };
 
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return test::make_buffer(4); };
 
     model_session_pool pool(
@@ -48,10 +86,12 @@ TEST(separation_engine_test, propagates_loader_errors)
     model_session_pool pool([](model_profile_id) -> std::expected<std::unique_ptr<model_session>, std::string>
                             { return test::make_stub_session(model_profile_id::balanced_four_stem); });
 
-    auto loader = [](const std::filesystem::path&) -> std::expected<audio_buffer, std::string>
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
     { return std::unexpected("fail"); };
 
-    auto writer = [](const std::filesystem::path&, const audio_buffer&) -> std::expected<void, std::string>
+    auto writer = [](const std::filesystem::path&,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
     { return {}; };
 
     separation_engine engine(std::move(pool), std::filesystem::path{"out"}, loader, writer);
@@ -63,4 +103,397 @@ TEST(separation_engine_test, propagates_loader_errors)
     ASSERT_FALSE(result.has_value());
     EXPECT_NE(result.error().find("fail"), std::string::npos);
 }
+
+TEST(separation_engine_test, segmented_path_matches_serial_output)
+{
+    auto source = test::make_buffer(5000);
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        source.samples[i] = static_cast<float>((i * 7) % 23) / 23.0f - 0.5f;
+    }
+    auto loader = [&](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return source; };
+
+    std::vector<audio_buffer> writes;
+    auto writer = [&](const std::filesystem::path&,
+                      const audio_buffer& buffer,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        writes.push_back(buffer);
+        return {};
+    };
+
+    engine_options options;
+    options.segment_parallelism = 3;
+    options.segment_seconds = 1000.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+    options.segment_overlap_seconds = 100.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+
+    const auto output_root = std::filesystem::temp_directory_path() / "stemsmith-sep-segmented";
+    separation_engine engine(model_session_pool(make_echo_session), output_root, loader, writer, options);
+
+    job_descriptor job;
+    job.input_path = std::filesystem::path{"/music/long.wav"};
+    job.config.profile = model_profile_id::balanced_four_stem;
+    job.config.stems_filter = {"vocals"};
+
+    std::vector<float> progress;
+    const auto result = engine.process(job, [&](float pct, const std::string&) { progress.push_back(pct); });
+    ASSERT_TRUE(result.has_value()) << result.error();
+    ASSERT_EQ(writes.size(), 1U);
+    const auto written = to_interleaved(writes[0]);
+    ASSERT_EQ(written.samples.size(), source.samples.size());
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        ASSERT_NEAR(written.samples[i], source.samples[i], 1e-5f);
+    }
+
+    ASSERT_FALSE(progress.empty());
+    EXPECT_FLOAT_EQ(progress.back(), 1.0f);
+    std::filesystem::remove_all(output_root);
+}
+
+TEST(separation_engine_test, segmented_path_propagates_cancellation)
+{
+    model_session_pool pool([](model_profile_id profile_id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return test::make_stub_session(profile_id); });
+
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return test::make_buffer(4000); };
+    auto writer = [](const std::filesystem::path&,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
+    { return {}; };
+
+    engine_options options;
+    options.segment_parallelism = 2;
+    options.segment_seconds = 1000.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+    separation_engine engine(std::move(pool), std::filesystem::path{"out"}, loader, writer, options);
+
+    job_descriptor job;
+    job.input_path = std::filesystem::path{"/music/long.wav"};
+    EXPECT_THROW((void)engine.process(job, [](float, const std::string&) { throw std::runtime_error("Job cancelled"); }),
+                 std::runtime_error);
+}
+
+TEST(separation_engine_test, streaming_path_appends_segments_to_stem_files)
+{
+    const auto root = std::filesystem::temp_directory_path() / "stemsmith-sep-streaming";
+    std::filesystem::remove_all(root);
+    const auto input_path = root / "long.wav";
+
+    std::vector<float> source(2 * 5000);
+    for (std::size_t i = 0; i < source.size(); ++i)
+    {
+        source[i] = static_cast<float>((i * 7) % 23) / 23.0f - 0.5f;
+    }
+    {
+        auto writer = wav_stream_writer::create(input_path, demucscpp::SUPPORTED_SAMPLE_RATE, 2);
+        ASSERT_TRUE(writer.has_value());
+        ASSERT_TRUE(writer->append(source).has_value());
+        ASSERT_TRUE(writer->finalize().has_value());
+    }
+
+    engine_options options;
+    options.streaming = true;
+    options.segment_seconds = 1000.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+    options.segment_overlap_seconds = 100.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return std::unexpected("loader must not be used when streaming"); };
+    auto writer = [](const std::filesystem::path&,
+                     const audio_buffer&,
+                     const output_encoding&) -> std::expected<void, std::string>
+    { return std::unexpected("writer must not be used when streaming"); };
+    separation_engine engine(model_session_pool(make_echo_session), root / "out", loader, writer, options);
+
+    job_descriptor job;
+    job.input_path = input_path;
+    job.config.profile = model_profile_id::balanced_four_stem;
+    job.config.stems_filter = {"drums", "bass"};
+
+    float last_progress = 0.0f;
+    const auto result = engine.process(job,
+                                       [&](float pct, const std::string&)
+                                       {
+                                           EXPECT_GE(pct, last_progress);
+                                           last_progress = pct;
+                                       });
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    for (const auto* stem : {"drums.wav", "bass.wav"})
+    {
+        auto reader = audio_stream_reader::open(*result / stem);
+        ASSERT_TRUE(reader.has_value()) << reader.error();
+        audio_buffer decoded;
+        ASSERT_TRUE(reader->read(decoded, 10000).has_value());
+        ASSERT_EQ(decoded.samples.size(), source.size());
+        for (std::size_t i = 0; i < source.size(); ++i)
+        {
+            ASSERT_NEAR(decoded.samples[i], source[i], 1e-5f);
+        }
+    }
+    EXPECT_FLOAT_EQ(last_progress, 1.0f);
+    std::filesystem::remove_all(root);
+}
+
+TEST(separation_engine_test, streaming_path_encodes_stems_in_the_job_format)
+{
+    const auto root = std::filesystem::temp_directory_path() / "stemsmith-sep-streaming-flac";
+    std::filesystem::remove_all(root);
+    const auto input_path = root / "long.wav";
+
+    std::vector<float> source(2 * 5000);
+    for (std::size_t i = 0; i < source.size(); ++i)
+    {
+        source[i] = static_cast<float>((i * 7) % 23) / 23.0f - 0.5f;
+    }
+    {
+        auto writer = wav_stream_writer::create(input_path, demucscpp::SUPPORTED_SAMPLE_RATE, 2);
+        ASSERT_TRUE(writer.has_value());
+        ASSERT_TRUE(writer->append(source).has_value());
+        ASSERT_TRUE(writer->finalize().has_value());
+    }
+
+    engine_options options;
+    options.streaming = true;
+    options.segment_seconds = 1000.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+    options.segment_overlap_seconds = 100.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return std::unexpected("loader must not be used when streaming"); };
+    separation_engine engine(model_session_pool(make_echo_session), root / "out", loader, write_audio_file, options);
+
+    job_descriptor job;
+    job.input_path = input_path;
+    job.config.profile = model_profile_id::balanced_four_stem;
+    job.config.stems_filter = {"vocals"};
+    job.config.output = {output_format::flac, 5};
+    const auto result = engine.process(job);
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    EXPECT_FALSE(std::filesystem::exists(*result / "vocals.wav"));
+    const auto decoded = load_audio_file(*result / "vocals.flac");
+    ASSERT_TRUE(decoded.has_value()) << decoded.error();
+    ASSERT_EQ(decoded->samples.size(), source.size());
+    for (std::size_t i = 0; i < source.size(); ++i)
+    {
+        ASSERT_NEAR(decoded->samples[i], source[i], 1e-5f);
+    }
+    std::filesystem::remove_all(root);
+}
+
+TEST(separation_engine_test, silent_segments_skip_inference)
+{
+    auto source = test::make_buffer(5000);
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        const auto frame = i / 2;
+        source.samples[i] = frame >= 1000 && frame < 3000 ? 0.0f : static_cast<float>((i * 7) % 23) / 23.0f - 0.5f;
+    }
+    auto loader = [&](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return source; };
+
+    std::vector<audio_buffer> writes;
+    auto writer = [&](const std::filesystem::path&,
+                      const audio_buffer& buffer,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        writes.push_back(buffer);
+        return {};
+    };
+
+    engine_options options;
+    options.segment_seconds = 1000.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+    options.segment_overlap_seconds = 100.0 / demucscpp::SUPPORTED_SAMPLE_RATE;
+    options.silence_threshold_db = -60.0;
+
+    const auto output_root = std::filesystem::temp_directory_path() / "stemsmith-sep-silence";
+    separation_engine engine(model_session_pool(make_echo_session), output_root, loader, writer, options);
+
+    job_descriptor job;
+    job.input_path = std::filesystem::path{"/music/podcast.wav"};
+    job.config.profile = model_profile_id::balanced_four_stem;
+    job.config.stems_filter = {"vocals"};
+
+    std::size_t skipped = 0;
+    const auto result = engine.process(job,
+                                       [&](float, const std::string& message)
+                                       {
+                                           if (message == "Silent segment skipped")
+                                           {
+                                               ++skipped;
+                                           }
+                                       });
+    ASSERT_TRUE(result.has_value()) << result.error();
+    EXPECT_EQ(skipped, 1U); // only [1800, 2800) lies entirely inside the silent stretch
+
+    ASSERT_EQ(writes.size(), 1U);
+    const auto written = to_interleaved(writes[0]);
+    ASSERT_EQ(written.samples.size(), source.samples.size());
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        ASSERT_NEAR(written.samples[i], source.samples[i], 1e-5f);
+    }
+    std::filesystem::remove_all(output_root);
+}
+
+TEST(separation_engine_test, silent_track_writes_zeroed_stems_without_a_session)
+{
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return test::make_buffer(3000); };
+    std::vector<std::pair<std::filesystem::path, audio_buffer>> writes;
+    auto writer = [&](const std::filesystem::path& path,
+                      const audio_buffer& buffer,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        writes.emplace_back(path, buffer);
+        return {};
+    };
+
+    engine_options options;
+    options.silence_threshold_db = -60.0;
+    model_session_pool pool([](model_profile_id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return std::unexpected("model must not be loaded for silence"); });
+    separation_engine engine(std::move(pool), std::filesystem::temp_directory_path() / "stemsmith-sep-silent-track",
+                             loader, writer, options);
+
+    job_descriptor job;
+    job.input_path = std::filesystem::path{"/music/silence.wav"};
+    job.config.profile = model_profile_id::balanced_four_stem;
+
+    const auto result = engine.process(job);
+    ASSERT_TRUE(result.has_value()) << result.error();
+    const auto profile = lookup_profile(model_profile_id::balanced_four_stem);
+    ASSERT_EQ(writes.size(), profile->stem_count);
+    for (std::size_t i = 0; i < writes.size(); ++i)
+    {
+        EXPECT_EQ(writes[i].first.filename().string(), std::string{profile->stems[i]} + ".wav");
+    }
+    for (const auto& [path, buffer] : writes)
+    {
+        EXPECT_EQ(buffer.frame_count(), 3000U);
+        EXPECT_TRUE(std::ranges::all_of(buffer.samples, [](float sample) { return sample == 0.0f; }));
+    }
+}
+
+TEST(separation_engine_test, pipelined_engine_writes_stems_on_the_encode_pool)
+{
+    auto loader = [](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return test::make_buffer(4); };
+    std::mutex writes_mutex;
+    std::vector<std::filesystem::path> writes;
+    std::vector<std::thread::id> writer_threads;
+    auto writer = [&](const std::filesystem::path& path,
+                      const audio_buffer&,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        std::lock_guard lock(writes_mutex);
+        writes.push_back(path.filename());
+        writer_threads.push_back(std::this_thread::get_id());
+        if (path.filename() == "bass.wav")
+        {
+            return std::unexpected("disk full");
+        }
+        return {};
+    };
+
+    engine_options options;
+    options.inference_slots = 1;
+    options.encode_threads = 2;
+    model_session_pool pool([](model_profile_id profile_id) -> std::expected<std::unique_ptr<model_session>, std::string>
+                            { return test::make_stub_session(profile_id); });
+    separation_engine engine(std::move(pool), std::filesystem::temp_directory_path() / "stemsmith-sep-pipelined",
+                             loader, writer, options);
+
+    job_descriptor job;
+    job.input_path = std::filesystem::path{"/music/song.wav"};
+    job.config.profile = model_profile_id::balanced_four_stem;
+    job.config.stems_filter = {"vocals", "drums"};
+
+    std::vector<std::string> messages;
+    const auto result = engine.process(job, [&](float, const std::string& message) { messages.push_back(message); });
+    ASSERT_TRUE(result.has_value()) << result.error();
+    ASSERT_FALSE(messages.empty());
+    EXPECT_EQ(messages.front(), "Waiting for inference");
+    std::ranges::sort(writes);
+    EXPECT_EQ(writes, (std::vector<std::filesystem::path>{"drums.wav", "vocals.wav"}));
+    EXPECT_TRUE(std::ranges::none_of(writer_threads, [](auto id) { return id == std::this_thread::get_id(); }));
+
+    // Every stem is still attempted when one write fails, and the failure is reported.
+    writes.clear();
+    job.config.stems_filter = {"vocals", "bass", "drums"};
+    const auto failed = engine.process(job);
+    ASSERT_FALSE(failed.has_value());
+    EXPECT_EQ(failed.error(), "disk full");
+    EXPECT_EQ(writes.size(), 3U);
+}
+
+TEST(separation_engine_test, max_quality_averages_shifted_passes)
+{
+    EXPECT_EQ(settings_for(job_quality::standard).shifts, 1U);
+    EXPECT_LT(settings_for(job_quality::draft).overlap_scale, settings_for(job_quality::standard).overlap_scale);
+    ASSERT_EQ(settings_for(job_quality::max).shifts, 2U);
+
+    std::size_t passes = 0;
+    model_session_pool pool(
+        [&passes](model_profile_id id) -> std::expected<std::unique_ptr<model_session>, std::string>
+        {
+            return std::make_unique<model_session>(
+                *lookup_profile(id),
+                []() -> std::expected<std::filesystem::path, std::string> { return std::filesystem::path{"stub.bin"}; },
+                [](demucscpp::demucs_model&, const std::filesystem::path&)
+                { return std::expected<void, std::string>{}; },
+                [&passes](const demucscpp::demucs_model&, const Eigen::MatrixXf& audio, demucscpp::ProgressCallback)
+                {
+                    ++passes;
+                    Eigen::Tensor3dXf tensor(4, 2, audio.cols());
+                    for (Eigen::Index stem = 0; stem < 4; ++stem)
+                    {
+                        for (Eigen::Index ch = 0; ch < 2; ++ch)
+                        {
+                            for (Eigen::Index frame = 0; frame < audio.cols(); ++frame)
+                            {
+                                tensor(stem, ch, frame) = audio(ch, frame);
+                            }
+                        }
+                    }
+                    return tensor;
+                });
+        });
+
+    auto source = test::make_buffer(300);
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        source.samples[i] = static_cast<float>(i % 11) / 11.0f;
+    }
+    auto loader = [&](const std::filesystem::path&, resample_quality) -> std::expected<audio_buffer, std::string>
+    { return source; };
+    std::vector<audio_buffer> writes;
+    auto writer = [&](const std::filesystem::path&,
+                      const audio_buffer& buffer,
+                      const output_encoding&) -> std::expected<void, std::string>
+    {
+        writes.push_back(buffer);
+        return {};
+    };
+
+    const auto output_root = std::filesystem::temp_directory_path() / "stemsmith-sep-quality";
+    separation_engine engine(std::move(pool), output_root, loader, writer);
+
+    job_descriptor job;
+    job.input_path = std::filesystem::path{"/music/preview.wav"};
+    job.config.profile = model_profile_id::balanced_four_stem;
+    job.config.stems_filter = {"vocals"};
+    job.config.quality = job_quality::max;
+
+    ASSERT_TRUE(engine.process(job).has_value());
+    EXPECT_EQ(passes, 2U);
+    ASSERT_EQ(writes.size(), 1U);
+    const auto written = to_interleaved(writes[0]);
+    ASSERT_EQ(written.samples.size(), source.samples.size());
+    for (std::size_t i = 0; i < source.samples.size(); ++i)
+    {
+        ASSERT_NEAR(written.samples[i], source.samples[i], 1e-6f);
+    }
+    std::filesystem::remove_all(output_root);
+}
 } // namespace stemsmith
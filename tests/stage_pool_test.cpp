@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <latch>
+#include <thread>
+#include <vector>
+
+#include "stage_pool.h"
+
+namespace stemsmith
+{
+TEST(stage_pool_test, runs_tasks_and_returns_results)
+{
+    stage_pool pool(3, 4);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 10; ++i)
+    {
+        results.push_back(pool.submit([i] { return i * i; }));
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(results[i].get(), i * i);
+    }
+    EXPECT_EQ(pool.thread_count(), 3U);
+}
+
+TEST(stage_pool_test, submit_blocks_while_queue_is_full)
+{
+    stage_pool pool(1, 1);
+    std::latch release(1);
+    std::latch running(1);
+    auto busy = pool.submit(
+        [&]
+        {
+            running.count_down();
+            release.wait();
+        });
+    running.wait();
+    auto queued = pool.submit([] {}); // fills the single queue slot
+
+    std::atomic_bool submitted{false};
+    std::thread producer(
+        [&]
+        {
+            auto blocked = pool.submit([] {});
+            submitted = true;
+            blocked.get();
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(submitted.load());
+
+    release.count_down();
+    producer.join();
+    EXPECT_TRUE(submitted.load());
+    busy.get();
+    queued.get();
+}
+
+TEST(stage_pool_test, slot_gate_caps_concurrent_holders)
+{
+    slot_gate gate(2);
+    std::atomic_size_t inside{0};
+    std::atomic_size_t peak{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 6; ++i)
+    {
+        threads.emplace_back(
+            [&]
+            {
+                const slot_gate::lease lease(gate);
+                const auto now = ++inside;
+                auto seen = peak.load();
+                while (now > seen && !peak.compare_exchange_weak(seen, now))
+                {
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                --inside;
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(peak.load(), 2U);
+    EXPECT_EQ(gate.in_use(), 0U);
+}
+} // namespace stemsmith
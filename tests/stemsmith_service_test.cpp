@@ -1,7 +1,9 @@
+#include <chrono>
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include "stemsmith/stemsmith.h"
 #include "support/fake_fetcher.h"
@@ -51,4 +53,68 @@ TEST(stemsmith_service_test, creates_runner_with_cache)
     EXPECT_TRUE(weight_progress_called);
     EXPECT_TRUE(svc->purge_models().has_value());
 }
+
+TEST(stemsmith_service_test, foreground_warmup_failure_fails_create)
+{
+    const auto cache_root = std::filesystem::temp_directory_path() / "stemsmith-service-warmup-cache";
+    const auto output_root = std::filesystem::temp_directory_path() / "stemsmith-service-warmup-output";
+    std::filesystem::remove_all(cache_root);
+    std::filesystem::remove_all(output_root);
+
+    runtime_config runtime;
+    runtime.cache.root = cache_root;
+    runtime.cache.fetcher = std::make_shared<test::fake_fetcher>("not-the-weights");
+    runtime.output_root = output_root;
+    runtime.worker_count = 1;
+    runtime.warmup.profiles = {model_profile_id::balanced_four_stem};
+
+    const auto service_result = service::create(std::move(runtime));
+    ASSERT_FALSE(service_result.has_value());
+    EXPECT_NE(service_result.error().find("warm-up"), std::string::npos);
+}
+
+TEST(stemsmith_service_test, background_warmup_reports_readiness)
+{
+    const auto cache_root = std::filesystem::temp_directory_path() / "stemsmith-service-bg-cache";
+    const auto output_root = std::filesystem::temp_directory_path() / "stemsmith-service-bg-output";
+    std::filesystem::remove_all(cache_root);
+    std::filesystem::remove_all(output_root);
+
+    runtime_config runtime;
+    runtime.cache.root = cache_root;
+    runtime.cache.fetcher = std::make_shared<test::fake_fetcher>("not-the-weights");
+    runtime.output_root = output_root;
+    runtime.worker_count = 1;
+    runtime.warmup.profiles = {model_profile_id::balanced_four_stem};
+    runtime.warmup.background = true;
+
+    auto service_result = service::create(std::move(runtime));
+    ASSERT_TRUE(service_result.has_value());
+    const auto svc = std::move(service_result.value());
+
+    for (int attempt = 0; attempt < 100 && !svc->warmup_error(); ++attempt)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    EXPECT_FALSE(svc->ready());
+    EXPECT_TRUE(svc->warmup_error().has_value());
+}
+
+TEST(stemsmith_service_test, ready_without_warmup)
+{
+    const auto cache_root = std::filesystem::temp_directory_path() / "stemsmith-service-ready-cache";
+    const auto output_root = std::filesystem::temp_directory_path() / "stemsmith-service-ready-output";
+
+    runtime_config runtime;
+    runtime.cache.root = cache_root;
+    runtime.cache.fetcher = std::make_shared<test::fake_fetcher>("payload");
+    runtime.output_root = output_root;
+    runtime.worker_count = 1;
+
+    const auto service_result = service::create(std::move(runtime));
+    ASSERT_TRUE(service_result.has_value());
+    EXPECT_TRUE(service_result.value()->ready());
+    EXPECT_FALSE(service_result.value()->warmup_error().has_value());
+}
 } // namespace stemsmith
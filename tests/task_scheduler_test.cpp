@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "task_scheduler.h"
+
+namespace stemsmith
+{
+TEST(task_scheduler_test, parallel_for_visits_every_index_once)
+{
+    task_scheduler scheduler(4);
+    std::vector<std::atomic_int> visits(257);
+    scheduler.parallel_for(visits.size(), 4, [&](std::size_t index) { ++visits[index]; });
+    EXPECT_TRUE(std::ranges::all_of(visits, [](const std::atomic_int& count) { return count == 1; }));
+}
+
+TEST(task_scheduler_test, parallel_for_respects_parallelism)
+{
+    task_scheduler scheduler(8);
+    std::atomic_int running{0};
+    std::atomic_int peak{0};
+    scheduler.parallel_for(32,
+                           2,
+                           [&](std::size_t)
+                           {
+                               const auto now = ++running;
+                               int seen = peak.load();
+                               while (now > seen && !peak.compare_exchange_weak(seen, now))
+                               {
+                               }
+                               std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                               --running;
+                           });
+    EXPECT_LE(peak.load(), 2);
+}
+
+TEST(task_scheduler_test, nested_parallel_for_completes_on_saturated_pool)
+{
+    task_scheduler scheduler(2);
+    std::atomic_int leaves{0};
+    scheduler.parallel_for(4,
+                           4,
+                           [&](std::size_t)
+                           { scheduler.parallel_for(8, 4, [&](std::size_t) { ++leaves; }); });
+    EXPECT_EQ(leaves.load(), 32);
+}
+
+TEST(task_scheduler_test, parallel_for_rethrows_first_exception)
+{
+    task_scheduler scheduler(3);
+    EXPECT_THROW(scheduler.parallel_for(16,
+                                        3,
+                                        [](std::size_t index)
+                                        {
+                                            if (index == 5)
+                                            {
+                                                throw std::runtime_error("Job cancelled");
+                                            }
+                                        }),
+                 std::runtime_error);
+}
+
+TEST(task_scheduler_test, submitted_tasks_run_on_scheduler_threads)
+{
+    task_scheduler scheduler(2);
+    EXPECT_EQ(scheduler.thread_count(), 2U);
+    std::promise<std::thread::id> ran_on;
+    scheduler.submit([&] { ran_on.set_value(std::this_thread::get_id()); });
+    EXPECT_NE(ran_on.get_future().get(), std::this_thread::get_id());
+}
+} // namespace stemsmith
@@ -0,0 +1,167 @@
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string_view>
+#include <vector>
+
+#include "wav_format.h"
+
+namespace
+{
+struct byte_writer
+{
+    std::vector<unsigned char> bytes;
+
+    void tag(std::string_view id)
+    {
+        bytes.insert(bytes.end(), id.begin(), id.end());
+    }
+
+    void u16(std::uint16_t v)
+    {
+        put(v, 2);
+    }
+
+    void u32(std::uint32_t v)
+    {
+        put(v, 4);
+    }
+
+    void u64(std::uint64_t v)
+    {
+        put(v, 8);
+    }
+
+    void put(std::uint64_t v, int size)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            bytes.push_back(static_cast<unsigned char>((v >> (8 * i)) & 0xFF));
+        }
+    }
+};
+
+void write_fmt(byte_writer& out, std::uint16_t tag, std::uint16_t channels, std::uint16_t bits, bool extensible)
+{
+    out.tag("fmt ");
+    out.u32(extensible ? 40 : 16);
+    out.u16(extensible ? stemsmith::wav_format_extensible : tag);
+    out.u16(channels);
+    out.u32(48000);
+    out.u32(48000U * channels * (bits / 8));
+    out.u16(static_cast<std::uint16_t>(channels * (bits / 8)));
+    out.u16(bits);
+    if (extensible)
+    {
+        out.u16(22);
+        out.u16(bits);
+        out.u32(3); // channel mask
+        out.u16(tag);
+        out.bytes.insert(out.bytes.end(), 14, 0); // rest of the sub-format GUID
+    }
+}
+} // namespace
+
+namespace stemsmith
+{
+TEST(wav_format_test, parses_extensible_riff_and_skips_unknown_chunks)
+{
+    byte_writer out;
+    out.tag("RIFF");
+    out.u32(0);
+    out.tag("WAVE");
+    out.tag("LIST");
+    out.u32(3); // odd-sized chunks are padded to an even length
+    out.bytes.insert(out.bytes.end(), 4, 0);
+    write_fmt(out, wav_format_pcm, 2, 24, true);
+    out.tag("data");
+    out.u32(1000); // longer than the file: clamped to whole frames actually present
+    out.bytes.insert(out.bytes.end(), 14, 0);
+
+    const auto layout = parse_wav_header(out.bytes);
+    ASSERT_TRUE(layout.has_value());
+    EXPECT_EQ(layout->format.format_tag, wav_format_pcm);
+    EXPECT_EQ(layout->format.bits_per_sample, 24);
+    EXPECT_EQ(layout->format.channels, 2U);
+    EXPECT_EQ(layout->format.sample_rate, 48000);
+    EXPECT_EQ(layout->data_offset, out.bytes.size() - 14);
+    EXPECT_EQ(layout->data_bytes, 12U);
+    EXPECT_TRUE(is_native_wav(layout->format));
+}
+
+TEST(wav_format_test, takes_rf64_data_size_from_ds64)
+{
+    byte_writer out;
+    out.tag("RF64");
+    out.u32(0xFFFFFFFF);
+    out.tag("WAVE");
+    out.tag("ds64");
+    out.u32(28);
+    out.u64(0);  // RIFF size
+    out.u64(16); // data size
+    out.u64(4);  // sample count
+    out.u32(0);  // table length
+    write_fmt(out, wav_format_float, 1, 32, false);
+    out.tag("data");
+    out.u32(0xFFFFFFFF);
+    out.bytes.insert(out.bytes.end(), 24, 0);
+
+    const auto layout = parse_wav_header(out.bytes);
+    ASSERT_TRUE(layout.has_value());
+    EXPECT_EQ(layout->format.format_tag, wav_format_float);
+    EXPECT_EQ(layout->data_bytes, 16U);
+}
+
+TEST(wav_format_test, rejects_other_containers_and_formats)
+{
+    byte_writer out;
+    out.tag("fLaC");
+    out.bytes.insert(out.bytes.end(), 40, 0);
+    EXPECT_FALSE(parse_wav_header(out.bytes).has_value());
+
+    EXPECT_FALSE(is_native_wav({wav_format_pcm, 8, 2, 44100}));
+    EXPECT_FALSE(is_native_wav({wav_format_float, 64, 2, 44100}));
+    EXPECT_FALSE(is_native_wav({wav_format_pcm, 16, 6, 44100}));
+    EXPECT_FALSE(is_native_wav({0x55, 16, 2, 44100})); // MP3 in a WAV wrapper
+}
+
+TEST(wav_format_test, decodes_every_native_format_to_stereo)
+{
+    // 19 frames exercise both the vector loops and their scalar tails.
+    constexpr std::size_t frames = 19;
+    for (const std::size_t channels : {std::size_t{1}, std::size_t{2}})
+    {
+        for (const std::uint16_t bits : {std::uint16_t{16}, std::uint16_t{24}, std::uint16_t{32}})
+        {
+            const wav_format format{wav_format_pcm, bits, channels, 44100};
+            byte_writer raw;
+            std::vector<float> expected;
+            for (std::size_t i = 0; i < frames * channels; ++i)
+            {
+                // A 16-bit value shifted to the top of a wider sample decodes to the same float.
+                const auto value = static_cast<std::int32_t>(i * 977) - 9000;
+                raw.put(static_cast<std::uint32_t>(value) << (bits - 16), bits / 8);
+                expected.push_back(static_cast<float>(value) / 32768.0f);
+            }
+
+            std::vector<float> out(2 * frames, -99.0f);
+            decode_to_stereo(raw.bytes.data(), format, frames, out.data());
+            for (std::size_t f = 0; f < frames; ++f)
+            {
+                for (std::size_t ch = 0; ch < 2; ++ch)
+                {
+                    const auto source = expected[f * channels + (channels == 2 ? ch : 0)];
+                    EXPECT_FLOAT_EQ(out[2 * f + ch], source) << "bits " << bits << " channels " << channels;
+                }
+            }
+        }
+    }
+
+    std::vector<float> samples{0.5f, -0.25f, 1.0f, 0.0f};
+    std::vector<unsigned char> raw(samples.size() * sizeof(float));
+    std::memcpy(raw.data(), samples.data(), raw.size());
+    std::vector<float> out(4);
+    decode_to_stereo(raw.data(), {wav_format_float, 32, 2, 44100}, 2, out.data());
+    EXPECT_EQ(out, samples);
+}
+} // namespace stemsmith
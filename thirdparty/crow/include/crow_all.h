@@ -2675,6 +2675,8 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         query_string url_params; ///< The parameters associated with the request. (everything after the `?` in the URL)
         ci_map headers;
         std::string body;
+        /// When set (by a headers handler), receives the body in chunks as it is read instead of `body`. (stemsmith patch)
+        std::function<void(const char*, size_t)> body_sink;
         std::string remote_ip_address; ///< The IP address from which the request was sent.
         unsigned char http_ver_major, http_ver_minor;
         bool keep_alive,    ///< Whether or not the server should send a `connection: Keep-Alive` header to the client.
@@ -5420,6 +5422,11 @@ namespace crow
         static int on_body(http_parser* self_, const char* at, size_t length)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
+            if (self->req.body_sink)
+            {
+                self->req.body_sink(at, length);
+                return 0;
+            }
             self->req.body.insert(self->req.body.end(), at, at + length);
             return 0;
         }
@@ -9670,6 +9677,20 @@ namespace crow
 
         void handle_header()
         {
+            // stemsmith patch: a headers handler may reject the request before its body is read. The response
+            // goes out now (ahead of any 100 Continue) and the connection closes instead of reading the body.
+            if (routing_handle_result_->rule_index && !handler_->handle_headers(req_, res))
+            {
+                header_rejected_ = true;
+                close_connection_ = true;
+                add_keep_alive_ = false;
+                need_to_call_after_handlers_ = false;
+                req_.body_sink = [](const char*, size_t) {};
+                res.set_header("Connection", "close");
+                complete_request();
+                return;
+            }
+
             // HTTP 1.1 Expect: 100-continue
             if (req_.http_ver_major == 1 && req_.http_ver_minor == 1 && get_header_value(req_.headers, "expect") == "100-continue")
             {
@@ -9683,6 +9704,10 @@ namespace crow
 
         void handle()
         {
+            if (header_rejected_)
+            {
+                return; // stemsmith patch: already answered from handle_header()
+            }
             // TODO(EDev): cancel_deadline_timer should be looked into, it might be a good idea to add it to handle_url() and then restart the timer once everything passes
             cancel_deadline_timer();
             bool is_invalid_request = false;
@@ -10158,6 +10183,7 @@ namespace crow
         detail::task_timer::identifier_type task_id_{};
 
         bool continue_requested{};
+        bool header_rejected_{}; ///< stemsmith patch: answered from handle_header(), the body is discarded
         bool need_to_call_after_handlers_{};
         bool need_to_start_read_after_complete_{};
         bool add_keep_alive_{};
@@ -14626,6 +14652,25 @@ namespace crow
             return router_.handle_initial(req, res);
         }
 
+        /// \brief Run the headers handler on a routed request whose body has not been read yet (stemsmith patch)
+        ///
+        /// Returns false when the handler rejected the request; `res` then holds the response.
+        bool handle_headers(request& req, response& res)
+        {
+            return !headers_handler_ || headers_handler_(req, res);
+        }
+
+        /// \brief Set a function that sees each routed request once its headers are parsed, before the body is read
+        /// (stemsmith patch)
+        ///
+        /// It may set `request::body_sink` to consume the body as it arrives, or fill in `res` and return false to
+        /// reject the request; the response is then sent right away and the connection closed without reading the body.
+        self_t& headers_handler(std::function<bool(request&, response&)> handler)
+        {
+            headers_handler_ = std::move(handler);
+            return *this;
+        }
+
         /// \brief Process the fully parsed request and generate a response for it
         void handle(request& req, response& res, std::unique_ptr<routing_handle_result>& found)
         {
@@ -15212,6 +15257,7 @@ namespace crow
         std::string bindaddr_ = "0.0.0.0";
         bool use_unix_ = false;
         size_t res_stream_threshold_ = 1048576;
+        std::function<bool(request&, response&)> headers_handler_; // stemsmith patch, see headers_handler()
         Router router_;
         bool static_routes_added_{false};
 